@@ -132,12 +132,92 @@ Account::Account():ItemBase(&AccountModel::instance()),d_ptr(new AccountPrivate(
 ///Build an account from it'id
 Account* Account::buildExistingAccountFromId(const QByteArray& _accountId)
 {
+   return AccountPrivate::buildFromDaemonState(AccountPrivate::fetchDaemonStates({_accountId}).first());
+} //buildExistingAccountFromId
+
+/**
+ * Query the daemon for everything needed to build the "ids" accounts.
+ *
+ * Over D-Bus, all the queries are sent before waiting for the first reply,
+ * so the daemon handles them while the previous replies are transferred.
+ */
+QVector<AccountPrivate::DaemonState> AccountPrivate::fetchDaemonStates(const QList<QByteArray>& ids)
+{
+   ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
+   PresenceManagerInterface&      presenceManager      = PresenceManager::instance();
+
+   QVector<DaemonState> ret(ids.size());
+
+#ifdef ENABLE_LIBWRAP
+   //The daemon is in the same process, there is no round trip to save
+   for (int i = 0; i < ids.size(); i++) {
+      DaemonState& s = ret[i];
+      s.id              = ids[i];
+      s.details         = configurationManager.getAccountDetails        (ids[i]);
+      s.volatileDetails = configurationManager.getVolatileAccountDetails(ids[i]);
+      s.trustRequests   = configurationManager.getTrustRequests         (ids[i]);
+      s.contacts        = configurationManager.getContacts              (ids[i]);
+      s.subscriptions   = presenceManager.getSubscriptions              (ids[i]);
+   }
+#else //ENABLE_LIBWRAP
+   QVector<QDBusPendingReply<MapStringString>>       details, volatileDetails;
+   QVector<QDBusPendingReply<VectorMapStringString>> trustRequests, contacts, subscriptions;
+
+   for (const QByteArray& id : ids) {
+      details         << configurationManager.getAccountDetails        (id);
+      volatileDetails << configurationManager.getVolatileAccountDetails(id);
+      trustRequests   << configurationManager.getTrustRequests         (id);
+      contacts        << configurationManager.getContacts              (id);
+      subscriptions   << presenceManager.getSubscriptions              (id);
+   }
+
+   for (int i = 0; i < ids.size(); i++) {
+      DaemonState& s = ret[i];
+      s.id = ids[i];
+
+      details        [i].waitForFinished();
+      volatileDetails[i].waitForFinished();
+      trustRequests  [i].waitForFinished();
+      contacts       [i].waitForFinished();
+      subscriptions  [i].waitForFinished();
+
+      if (details[i].isValid())
+         s.details = details[i].value();
+
+      if (volatileDetails[i].isValid())
+         s.volatileDetails = volatileDetails[i].value();
+
+      if (trustRequests[i].isValid())
+         s.trustRequests = trustRequests[i].value();
+
+      if (contacts[i].isValid())
+         s.contacts = contacts[i].value();
+
+      if (subscriptions[i].isValid())
+         s.subscriptions = subscriptions[i].value();
+   }
+#endif //ENABLE_LIBWRAP
+
+   return ret;
+}
+
+///Build an existing account without querying the daemon
+Account* AccountPrivate::buildFromDaemonState(const DaemonState& state)
+{
+   const QByteArray& _accountId = state.id;
+
 //    qDebug() << "Building an account from id: " << _accountId;
    Account* a = new Account();
    a->d_ptr->m_AccountId = _accountId;
    a->d_ptr->setObjectName(_accountId);
    a->d_ptr->m_RemoteEnabledState = true;
 
+   a->d_ptr->m_hPrefetchedDetails   = state.details;
+   a->d_ptr->m_HasPrefetchedDetails = true;
+
+   if (!state.volatileDetails.isEmpty())
+      a->d_ptr->setVolatileDetails(state.volatileDetails);
+
    a->performAction(Account::EditAction::RELOAD);
 
    //If a placeholder exist for this account, upgrade it
@@ -146,8 +226,7 @@ Account* Account::buildExistingAccountFromId(const QByteArray& _accountId)
 
    //Load the pending trust requests
    if (a->protocol() == Account::Protocol::RING) {
-      const VectorMapStringString& pending_tr {ConfigurationManager::instance().getTrustRequests(a->id())};
-      for (const auto& tr_info : pending_tr) {
+      for (const auto& tr_info : state.trustRequests) {
          auto payload = tr_info[DRing::Account::TrustRequest::PAYLOAD].toUtf8();
          auto ringID = tr_info[DRing::Account::TrustRequest::FROM];
          auto timeReceived = tr_info[DRing::Account::TrustRequest::RECEIVED].toInt();
@@ -165,12 +244,9 @@ Account* Account::buildExistingAccountFromId(const QByteArray& _accountId)
       emit a->contactRequestAccepted(r);
    });
 
-   // Load the contacts associated from the daemon and create the cms.
-   const auto account_contacts = static_cast<QVector<QMap<QString, QString>>>(ConfigurationManager::instance()
-                                                                                          .getContacts(a->id().data()));
-
+   // Create the cms of the contacts associated with the account
    if (a->protocol() == Account::Protocol::RING) {
-      for (auto contact_info : account_contacts) {
+      for (auto contact_info : state.contacts) {
           auto cm = PhoneDirectoryModel::instance().getNumber(contact_info["id"], a);
           if (contact_info["banned"] IS_TRUE) {
              a->bannedContactModel()->add(cm);
@@ -182,8 +258,7 @@ Account* Account::buildExistingAccountFromId(const QByteArray& _accountId)
    }
 
    //Load the tracked buddies
-   const VectorMapStringString subscriptions = PresenceManager::instance().getSubscriptions(a->id());
-   foreach(auto subscription, subscriptions){
+   foreach(auto subscription, state.subscriptions){
        ContactMethod* tracked_buddy = PhoneDirectoryModel::instance().getNumber(subscription[DRing::Presence::BUDDY_KEY], a);
        bool tracked_buddy_present = subscription[DRing::Presence::STATUS_KEY].compare(DRing::Presence::ONLINE_KEY) == 0;
        tracked_buddy->setTracked(true);
@@ -191,7 +266,7 @@ Account* Account::buildExistingAccountFromId(const QByteArray& _accountId)
    }
 
    return a;
-} //buildExistingAccountFromId
+}
 
 ///Build an account from it's name / alias
 Account* Account::buildNewAccountFromAlias(Account::Protocol proto, const QString& alias)
@@ -433,13 +508,9 @@ const QString Account::alias() const
 ///Return the model index of this item
 QModelIndex Account::index() const
 {
-   //There is usually < 5 accounts, the loop may be faster than a hash for most users
-   for (int i=0;i < AccountModel::instance().size();i++) {
-      if (this == AccountModel::instance()[i]) {
-         return AccountModel::instance().index(i,0);
-      }
-   }
-   return QModelIndex();
+   const int row = AccountModel::instance().d_ptr->rowOf(this);
+
+   return row == -1 ? QModelIndex() : AccountModel::instance().index(row,0);
 }
 
 ///Return status color name
@@ -699,8 +770,7 @@ bool Account::isAutoAnswer() const
 //Return if the accounts needs to migrate
 bool Account::needsMigration() const
 {
-    const MapStringString details = ConfigurationManager::instance().getVolatileAccountDetails(id());
-    const QString status = details[DRing::Account::VolatileProperties::Registration::STATUS];
+    const QString status = d_ptr->volatileDetails()[DRing::Account::VolatileProperties::Registration::STATUS];
     return status == DRing::Account::States::ERROR_NEED_MIGRATION;
 }
 
@@ -723,9 +793,7 @@ QString Account::username() const
 //Return the account registered name
 QString Account::registeredName() const
 {
-    const MapStringString details = ConfigurationManager::instance().getVolatileAccountDetails(id());
-    const QString registeredName = details[DRing::Account::VolatileProperties::REGISTERED_NAME];
-    return registeredName;
+    return d_ptr->volatileDetails()[DRing::Account::VolatileProperties::REGISTERED_NAME];
 }
 
 ///Return the account mailbox address
@@ -1492,6 +1560,11 @@ void Account::setId(const QByteArray& id)
    if (! isNew())
       qDebug() << "Error : setting AccountId of an existing account" << d_ptr->m_AccountId;
    d_ptr->m_AccountId = id;
+
+   //Keep getById() working for the accounts already in the model
+   AccountModelPrivate* model = AccountModel::instance().d_ptr;
+   if (model->m_hIndexKeys.contains(this))
+      model->indexAccount(this);
 }
 
 ///Set the account type, SIP or RING
@@ -2428,9 +2501,7 @@ Account::RoleStatus Account::roleStatus(Account::Role role) const
 bool AccountPrivate::updateState()
 {
    if(! q_ptr->isNew()) {
-      ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
-      const MapStringString details        = configurationManager.getVolatileAccountDetails(q_ptr->id());
-      const QString         status         = details[DRing::Account::VolatileProperties::Registration::STATUS];
+      const QString         status         = volatileDetails()[DRing::Account::VolatileProperties::Registration::STATUS];
       const Account::RegistrationState cst = q_ptr->registrationState();
       const Account::RegistrationState st  = Account::fromDaemonName(status);
 
@@ -2450,6 +2521,40 @@ bool Account::updateState()
     return d_ptr->updateState();
 }
 
+/**
+ * The volatile details (registration status, registered name...) are cached
+ * and kept up to date by the daemon signals. Drop them to fetch them again
+ * the next time they are read.
+ */
+void Account::invalidateVolatileDetails()
+{
+   d_ptr->m_HasVolatileDetails = false;
+}
+
+///The cached volatile details, they are only fetched once
+const MapStringString& AccountPrivate::volatileDetails() const
+{
+   if ((!m_HasVolatileDetails) && !q_ptr->isNew()) {
+      m_hVolatileDetails   = ConfigurationManager::instance().getVolatileAccountDetails(q_ptr->id());
+      m_HasVolatileDetails = true;
+   }
+
+   return m_hVolatileDetails;
+}
+
+void AccountPrivate::setVolatileDetails(const MapStringString& details)
+{
+   m_hVolatileDetails   = details;
+   m_HasVolatileDetails = true;
+}
+
+///Update a single value, the other ones are loaded first if needed
+void AccountPrivate::setVolatileDetail(const QString& param, const QString& val)
+{
+   volatileDetails();
+   m_hVolatileDetails[param] = val;
+}
+
 ///Save the current account to the daemon
 void AccountPrivate::save()
 {
@@ -2517,7 +2622,18 @@ void AccountPrivate::reload()
       else
          qDebug() << "Loading" << q_ptr->id();
       ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
-      QMap<QString,QString> aDetails = configurationManager.getAccountDetails(q_ptr->id());
+
+      //The details may have been fetched with the other accounts
+      const bool isPrefetched = m_HasPrefetchedDetails;
+      QMap<QString,QString> aDetails;
+
+      if (isPrefetched) {
+         aDetails = m_hPrefetchedDetails;
+         m_hPrefetchedDetails.clear();
+         m_HasPrefetchedDetails = false;
+      }
+      else
+         aDetails = configurationManager.getAccountDetails(q_ptr->id());
 
       if (!aDetails.count()) {
          qDebug() << "Account not found";
@@ -2582,9 +2698,12 @@ void AccountPrivate::reload()
       emit q_ptr->changed(q_ptr);
 
       //The registration state is cached, update that cache
+      if (!isPrefetched)
+         q_ptr->invalidateVolatileDetails();
+
       updateState();
 
-      AccountModel::instance().d_ptr->slotVolatileAccountDetailsChange(q_ptr->id(),configurationManager.getVolatileAccountDetails(q_ptr->id()));
+      AccountModel::instance().d_ptr->slotVolatileAccountDetailsChange(q_ptr->id(),volatileDetails());
    }
 }
 
@@ -83,6 +83,7 @@ class LIB_EXPORT Account : public ItemBase {
 
    friend class AccountPlaceHolder;
    friend class AccountModel;
+   friend class AccountModelPrivate;
 
    using ContactMethods = QVector<ContactMethod*>;
 
@@ -555,6 +556,7 @@ class LIB_EXPORT Account : public ItemBase {
 
       //Mutator
       bool updateState();
+      void invalidateVolatileDetails();
 
       //Operators
       bool operator==(const Account&)const;
@@ -30,6 +30,7 @@
 #include <QtCore/QItemSelectionModel>
 #include <QtCore/QMimeData>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
 
 //Ring daemon
 #include <account_const.h>
@@ -42,6 +43,7 @@
 #include "contactrequest.h"
 #include "pendingcontactrequestmodel.h"
 #include "ringdevicemodel.h"
+#include "private/account_p.h"
 #include "private/accountmodel_p.h"
 #include "private/ringdevicemodel_p.h"
 #include "accountstatusmodel.h"
@@ -110,6 +112,7 @@ AccountModel::~AccountModel()
    while(d_ptr->m_lAccounts.size()) {
       Account* a = d_ptr->m_lAccounts[0];
       d_ptr->m_lAccounts.remove(0);
+      d_ptr->m_IsRowsDirty = true;
       delete a;
    }
    for(Account* a : d_ptr->m_pRemovedAccounts) {
@@ -322,7 +325,6 @@ AccountModel::getContacts(const Account* account) const
 ///Account status changed
 void AccountModelPrivate::slotDaemonAccountChanged(const QString& account, const QString& registration_state, unsigned code, const QString& status)
 {
-   Q_UNUSED(registration_state);
    Account* a = q_ptr->getById(account.toLatin1());
 
    //TODO move this to AccountStatusModel
@@ -369,6 +371,8 @@ void AccountModelPrivate::slotDaemonAccountChanged(const QString& account, const
           if (daemonRow == -1 && (acc->editState() == Account::EditState::READY || acc->editState() == Account::EditState::REMOVED)) {
               q_ptr->beginRemoveRows(QModelIndex(), modelRow, modelRow);
               accIter.remove();
+              m_IsRowsDirty = true;
+              unindexAccount(acc);
               q_ptr->endRemoveRows();
 
               // should we put it in the list of deleted accounts? who knows?
@@ -382,6 +386,9 @@ void AccountModelPrivate::slotDaemonAccountChanged(const QString& account, const
    }
    else {
       const bool isRegistered = a->registrationState() == Account::RegistrationState::READY;
+
+      //The signal carries the new status, no need to ask the daemon again
+      a->d_ptr->setVolatileDetail(DRing::Account::VolatileProperties::Registration::STATUS, registration_state);
       a->updateState();
       const QModelIndex idx = a->index();
       emit q_ptr->dataChanged(idx, idx);
@@ -397,9 +404,8 @@ void AccountModelPrivate::slotDaemonAccountChanged(const QString& account, const
       //Send the messages to AccountStatusModel for processing
       a->statusModel()->addSipRegistrationEvent(status,code);
 
-      //Make sure volatile details get reloaded
-      //TODO eventually remove this call and trust the signal
-      slotVolatileAccountDetailsChange(account,configurationManager.getVolatileAccountDetails(account));
+      //Make sure the transport state is propagated
+      slotVolatileAccountDetailsChange(account,a->d_ptr->volatileDetails());
 
       emit q_ptr->accountStateChanged(a,a->registrationState());
    }
@@ -414,8 +420,10 @@ void AccountModelPrivate::slotSupportedProtocolsChanged()
 ///Tell the model something changed
 void AccountModelPrivate::slotAccountChanged(Account* a)
 {
-   int idx = m_lAccounts.indexOf(a);
+   const int idx = rowOf(a);
    if (idx != -1) {
+      //The hostname may have changed
+      indexAccount(a);
       emit q_ptr->dataChanged(q_ptr->index(idx, 0), q_ptr->index(idx, 0));
    }
 }
@@ -450,6 +458,8 @@ void AccountModelPrivate::slotVolatileAccountDetailsChange(const QString& accoun
 {
    Account* a = q_ptr->getById(accountId.toLatin1());
    if (a) {
+      a->d_ptr->setVolatileDetails(details);
+
       const int     transportCode = details[DRing::Account::VolatileProperties::Transport::STATE_CODE].toInt();
       const QString transportDesc = details[DRing::Account::VolatileProperties::Transport::STATE_DESC];
       const QString status        = details[DRing::Account::VolatileProperties::Registration::STATUS];
@@ -617,11 +627,35 @@ void AccountModel::updateAccounts()
        }
    }
 
+   //Fetch the new accounts all at once, it is much faster than one by one
+   QElapsedTimer timer;
+   timer.start();
+
+   QList<QByteArray> newIds;
+   for (const QString& id : accountIds) {
+      if ((!getById(id.toLatin1())) && !newIds.contains(id.toLatin1()))
+         newIds << id.toLatin1();
+   }
+
+   const QVector<AccountPrivate::DaemonState> states = AccountPrivate::fetchDaemonStates(newIds);
+   const qint64 fetchTime = timer.restart();
+
+   //Their contacts are added to the PhoneDirectoryModel in a single reset
+   QHash<QByteArray, Account*> built;
+   {
+      PhoneDirectoryModel::BulkInsertion bulk;
+
+      for (const AccountPrivate::DaemonState& state : states)
+         built[state.id] = AccountPrivate::buildFromDaemonState(state);
+   }
+   const qint64 buildTime = timer.restart();
+
    //m_lAccounts.clear();
    for (int i = 0; i < accountIds.size(); ++i) {
       Account* acc = getById(accountIds[i].toLatin1());
       if (!acc) {
-         Account* a = Account::buildExistingAccountFromId(accountIds[i].toLatin1());
+         Account* a = built.value(accountIds[i].toLatin1());
+
          d_ptr->insertAccount(a,d_ptr->m_lAccounts.size());
          connect(a,SIGNAL(changed(Account*)),d_ptr,SLOT(slotAccountChanged(Account*)));
          //connect(a,SIGNAL(propertyChanged(Account*,QString,QString,QString)),d_ptr,SLOT(slotAccountChanged(Account*)));
@@ -637,6 +671,12 @@ void AccountModel::updateAccounts()
          acc->performAction(Account::EditAction::RELOAD);
       }
    }
+
+   if (!newIds.isEmpty()) {
+      qDebug() << "Loaded" << newIds.size() << "accounts: queries" << fetchTime << "ms, build"
+         << buildTime << "ms, insertion" << timer.elapsed() << "ms";
+   }
+
    emit accountListUpdated();
 } //updateAccounts
 
@@ -857,7 +897,7 @@ void AccountModelPrivate::slotMediaParametersChanged(const QString& accountId)
 /**
  * Get an account by its ID
  *
- * @note This method have O(N) complexity, but the average account count is low
+ * @note This method is O(1), the accounts are indexed by id
  *
  * @param id The account identifier
  * @param usePlaceHolder Return a placeholder for a future account instead of nullptr
@@ -867,10 +907,9 @@ Account* AccountModel::getById(const QByteArray& id, bool usePlaceHolder) const
 {
    if (id.isEmpty())
        return nullptr;
-   //This function use a loop as the expected size is < 5
-   for (int i = 0; i < d_ptr->m_lAccounts.size(); i++) {
-      Account* acc = d_ptr->m_lAccounts[i];
-      if (acc && !acc->isNew() && acc->id() == id)
+   if (Account* acc = d_ptr->m_hAccountsById.value(id)) {
+      //An account only get its id when it is saved for the first time
+      if ((!acc->isNew()) && acc->id() == id)
          return acc;
    }
 
@@ -963,6 +1002,12 @@ QList<Account*> AccountModel::getAccountsByProtocol( const Account::Protocol pro
    return {};
 }
 
+///The accounts registered on "hostname"
+QList<Account*> AccountModel::getAccountsByHostname( const QString& hostname ) const
+{
+   return d_ptr->m_hAccountsByHostname.values(hostname);
+}
+
 bool AccountModel::isPresenceEnabled() const
 {
    foreach(Account* a, d_ptr->m_lAccounts) {
@@ -1027,9 +1072,14 @@ void AccountModelPrivate::insertAccount(Account* a, int idx)
 {
    q_ptr->beginInsertRows(QModelIndex(), idx, idx);
    m_lAccounts.insert(idx,a);
+   m_IsRowsDirty = true;
+   indexAccount(a);
    q_ptr->endInsertRows();
 
    connect(a,&Account::editStateChanged, [a,this](const Account::EditState state, const Account::EditState previous) {
+      //New accounts get their id once saved
+      if (m_hIndexKeys.contains(a))
+         indexAccount(a);
       emit q_ptr->accountEditStateChanged(a, state, previous);
    });
 
@@ -1037,8 +1087,51 @@ void AccountModelPrivate::insertAccount(Account* a, int idx)
    connect(a, &Account::contactRequestAccepted, [a, this](const ContactRequest* r){
       emit q_ptr->accountContactAdded(a, r);
    });
+}
+
+void AccountModelPrivate::removeAccount(Account* account)
+{
+   const int aindex = rowOf(account);
+
+   if (aindex == -1)
+      return;
+
+   q_ptr->beginRemoveRows(QModelIndex(),aindex,aindex);
+   m_lAccounts.remove(aindex);
+   m_IsRowsDirty = true;
+   unindexAccount(account);
+   m_lDeletedAccounts << account->id();
+   q_ptr->endRemoveRows();
+
+   m_pRemovedAccounts << account;
+}
+
+/**
+ * Add "a" to the id, hostname and protocol indexes, or update them if its
+ * keys changed since it was indexed.
+ */
+void AccountModelPrivate::indexAccount(Account* a)
+{
+   const IndexKeys keys { a->isNew() ? QByteArray() : a->id(), a->hostname(), a->protocol() };
+
+   const auto i = m_hIndexKeys.constFind(a);
+
+   if (i != m_hIndexKeys.constEnd()) {
+      if (i->id == keys.id && i->hostname == keys.hostname && i->protocol == keys.protocol)
+         return;
 
-   switch(a->protocol()) {
+      unindexAccount(a);
+   }
+
+   m_hIndexKeys[a] = keys;
+
+   if (!keys.id.isEmpty())
+      m_hAccountsById[keys.id] = a;
+
+   if (!keys.hostname.isEmpty())
+      m_hAccountsByHostname.insert(keys.hostname, a);
+
+   switch(keys.protocol) {
       case Account::Protocol::SIP:
          m_lSipAccounts  << a;
          break;
@@ -1050,27 +1143,46 @@ void AccountModelPrivate::insertAccount(Account* a, int idx)
    }
 }
 
-void AccountModelPrivate::removeAccount(Account* account)
+void AccountModelPrivate::unindexAccount(Account* a)
 {
-   const int aindex = m_lAccounts.indexOf(account);
+   const auto i = m_hIndexKeys.find(a);
 
-   q_ptr->beginRemoveRows(QModelIndex(),aindex,aindex);
-   m_lAccounts.remove(aindex);
-   m_lDeletedAccounts << account->id();
-   q_ptr->endRemoveRows();
+   if (i == m_hIndexKeys.end())
+      return;
 
-   m_pRemovedAccounts << account;
+   if (m_hAccountsById.value(i->id) == a)
+      m_hAccountsById.remove(i->id);
+
+   m_hAccountsByHostname.remove(i->hostname, a);
 
-   switch(account->protocol()) {
+   switch(i->protocol) {
       case Account::Protocol::RING:
-         m_lRingAccounts.removeOne(account);
+         m_lRingAccounts.removeOne(a);
          break;
       case Account::Protocol::SIP:
-         m_lSipAccounts.removeOne(account);
+         m_lSipAccounts.removeOne(a);
          break;
       case Account::Protocol::COUNT__:
          break;
    }
+
+   m_hIndexKeys.erase(i);
+}
+
+///The row of "a", or -1. The rows are only recomputed after a change
+int AccountModelPrivate::rowOf(const Account* a) const
+{
+   if (m_IsRowsDirty) {
+      m_hRows.clear();
+      m_hRows.reserve(m_lAccounts.size());
+
+      for (int i = 0; i < m_lAccounts.size(); i++)
+         m_hRows[m_lAccounts[i]] = i;
+
+      m_IsRowsDirty = false;
+   }
+
+   return m_hRows.value(a, -1);
 }
 
 Account* AccountModel::add(const QString& alias, const Account::Protocol proto)
@@ -1220,6 +1332,7 @@ bool AccountModel::dropMimeData(const QMimeData* data, Qt::DropAction action, in
       beginRemoveRows(QModelIndex(), accIdx.row(), accIdx.row());
       Account* acc = d_ptr->m_lAccounts[accIdx.row()];
       d_ptr->m_lAccounts.removeAt(accIdx.row());
+      d_ptr->m_IsRowsDirty = true;
       endRemoveRows();
 
       d_ptr->insertAccount(acc,destinationRow);
@@ -52,6 +52,7 @@ public:
    Q_PROPERTY(Account*       userChosenAccount          READ userChosenAccount      WRITE setUserChosenAccount)
 
    friend class AccountPrivate;
+   friend class Account;
 
    /// @enum Global saving state to be used when using a single saving mechanism for all accounts at once
    enum class EditState {
@@ -71,6 +72,7 @@ public:
    Q_INVOKABLE static QString getSimilarAliasIndex  ( const QString& alias                 )      ;
    Account*             ip2ip                       (                                      ) const;
    QList<Account*>      getAccountsByProtocol       ( const Account::Protocol protocol     ) const;
+   QList<Account*>      getAccountsByHostname       ( const QString& hostname              ) const;
    bool                 isPresenceEnabled           (                                      ) const;
    bool                 isPresencePublishSupported  (                                      ) const;
    bool                 isPresenceSubscribeSupported(                                      ) const;
@@ -63,6 +63,7 @@ public:
    QHash<int,HistoryNode*>      m_hCategories      ;
    QHash<QString,HistoryNode*>  m_hCategoryByName  ;
    SortingCategory::ModelTuple* m_pSortedProxy {nullptr};
+   int                          m_LoadingWindow{   0   };
    int                          m_Role             ;
    QStringList                  m_lMimes           ;
    CategorizedHistoryModel::SortedProxy m_pProxies;
@@ -315,6 +316,24 @@ bool CategorizedHistoryModel::isHistoryEnabled() const
    return ConfigurationManager::instance().getHistoryLimit() >= 0;
 }
 
+/**
+ * Load the history by windows of "calls" calls, the most recent first, 0 to
+ * load everything at once (default). It has to be set before the
+ * collections are loaded.
+ *
+ * The next window is loaded when a view call fetchMore(), for example when a
+ * category is expanded or scrolled to the end.
+ */
+void CategorizedHistoryModel::setLoadingWindow(int calls)
+{
+   d_ptr->m_LoadingWindow = calls;
+}
+
+int CategorizedHistoryModel::loadingWindow() const
+{
+   return d_ptr->m_LoadingWindow;
+}
+
 
 /*****************************************************************************
  *                                                                           *
@@ -488,6 +507,37 @@ QModelIndex CategorizedHistoryModel::index( int row, int column, const QModelInd
    return QModelIndex();
 }
 
+///Collections loaded by windows still list the ids of the calls not loaded yet
+bool CategorizedHistoryModel::canFetchMore(const QModelIndex& parent) const
+{
+   if (parent.isValid() && static_cast<HistoryNode*>(parent.internalPointer())->m_Type == HistoryNode::Type::CALL)
+      return false;
+
+   const auto cols = collections(CollectionInterface::SupportedFeatures::LISTABLE | CollectionInterface::SupportedFeatures::FETCH);
+
+   for (const CollectionInterface* backend : cols) {
+      if (!backend->listId().isEmpty())
+         return true;
+   }
+
+   return false;
+}
+
+///Load the next window of calls, see setLoadingWindow()
+void CategorizedHistoryModel::fetchMore(const QModelIndex& parent)
+{
+   Q_UNUSED(parent)
+
+   const auto cols = collections(CollectionInterface::SupportedFeatures::LISTABLE | CollectionInterface::SupportedFeatures::FETCH);
+
+   for (CollectionInterface* backend : cols) {
+      const QList<CollectionInterface::Element> ids = backend->listId();
+
+      if (!ids.isEmpty())
+         backend->fetch(d_ptr->m_LoadingWindow > 0 ? ids.mid(0, d_ptr->m_LoadingWindow) : ids);
+   }
+}
+
 ///Called when dynamically adding calls, otherwise the proxy filter will segfault
 bool CategorizedHistoryModel::insertRows( int row, int count, const QModelIndex & parent)
 {
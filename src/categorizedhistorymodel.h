@@ -55,6 +55,7 @@ public:
    Q_PROPERTY(bool hasCollections   READ hasCollections  )
    Q_PROPERTY(bool historyEnabled   READ isHistoryEnabled WRITE setHistoryEnabled)
    Q_PROPERTY(bool historyLimited   READ isHistoryLimited WRITE setHistoryLimited)
+   Q_PROPERTY(int  loadingWindow    READ loadingWindow    WRITE setLoadingWindow )
 
    //Singleton
    static CategorizedHistoryModel& instance();
@@ -64,6 +65,7 @@ public:
    bool isHistoryLimited           () const;
    bool isHistoryEnabled           () const;
    int  historyLimit               () const;
+   int  loadingWindow              () const;
    const CallMap getHistoryCalls   () const;
 
    //Backend model implementation
@@ -74,6 +76,7 @@ public:
    void setHistoryLimited(bool isLimited);
    void setHistoryLimit(int numberOfDays);
    void setHistoryEnabled(bool isEnabled);
+   void setLoadingWindow(int calls);
    void clear();
 
    //Model implementation
@@ -89,6 +92,8 @@ public:
    virtual QMimeData*    mimeData    ( const QModelIndexList &indexes                              ) const override;
    virtual bool          dropMimeData( const QMimeData*, Qt::DropAction, int, int, const QModelIndex& ) override;
    virtual bool          insertRows  ( int row, int count, const QModelIndex & parent = QModelIndex() ) override;
+   virtual bool          canFetchMore( const QModelIndex& parent                                   ) const override;
+   virtual void          fetchMore   ( const QModelIndex& parent                                   ) override;
    virtual QHash<int,QByteArray> roleNames() const override;
 
    struct LIB_EXPORT SortedProxy {
@@ -34,6 +34,7 @@
 #include "private/matrixutils.h"
 #include "private/certificatemodel_p.h"
 #include "private/certificate_p.h"
+#include "private/certificateloader.h"
 #include <account.h>
 #include <chainoftrustmodel.h>
 #include "contactmethod.h"
@@ -205,39 +206,94 @@ ChecksCache::ChecksCache(const MapStringString& checks)
 
 void CertificatePrivate::loadDetails(bool reload)
 {
-   if (!m_pDetailsCache || reload) {
-      MapStringString d;
-      switch(m_LoadingType) {
-         case LoadingType::FROM_PATH:
-            d = ConfigurationManager::instance().getCertificateDetailsPath(m_Path, m_PrivateKey, m_PrivateKeyPassword);
-            break;
-         case LoadingType::FROM_ID:
-            d = ConfigurationManager::instance().getCertificateDetails(m_Id);
-            break;
-      }
-      m_pDetailsCache = new DetailsCache(d);
+   if (m_pDetailsCache && !reload)
+      return;
+
+   if ((!reload) && CertificateLoader::instance().isEnabled()) {
+      loadAsync();
+      return;
    }
+
+   MapStringString d;
+   switch(m_LoadingType) {
+      case LoadingType::FROM_PATH:
+         d = ConfigurationManager::instance().getCertificateDetailsPath(m_Path, m_PrivateKey, m_PrivateKeyPassword);
+         break;
+      case LoadingType::FROM_ID:
+         d = ConfigurationManager::instance().getCertificateDetails(m_Id);
+         break;
+   }
+
+   if (m_pDetailsCache)
+      delete m_pDetailsCache;
+
+   m_pDetailsCache = new DetailsCache(d);
+   m_LoadGeneration++;
 }
 
 void CertificatePrivate::loadChecks(bool reload)
 {
-   if ((!m_pCheckCache) || reload) {
-      MapStringString checks;
-      switch(m_LoadingType) {
-         case LoadingType::FROM_PATH:
-            checks = ConfigurationManager::instance().validateCertificatePath(QString(),m_Path,m_PrivateKey, m_PrivateKeyPassword, {});
-            break;
-         case LoadingType::FROM_ID:
-            checks = ConfigurationManager::instance().validateCertificate(QString(),m_Id);
-            break;
-      }
-      if (reload && m_pCheckCache)
-         delete m_pCheckCache;
-      m_pCheckCache = new ChecksCache(checks);
-      CertificateModel::instance().d_ptr->regenChecks(q_ptr);
+   if (m_pCheckCache && !reload)
+      return;
+
+   if ((!reload) && CertificateLoader::instance().isEnabled()) {
+      loadAsync();
+      return;
+   }
+
+   MapStringString checks;
+   switch(m_LoadingType) {
+      case LoadingType::FROM_PATH:
+         checks = ConfigurationManager::instance().validateCertificatePath(QString(),m_Path,m_PrivateKey, m_PrivateKeyPassword, {});
+         break;
+      case LoadingType::FROM_ID:
+         checks = ConfigurationManager::instance().validateCertificate(QString(),m_Id);
+         break;
+   }
+   if (m_pCheckCache)
+      delete m_pCheckCache;
+   m_pCheckCache = new ChecksCache(checks);
+   m_LoadGeneration++;
+   CertificateModel::instance().d_ptr->regenChecks(q_ptr);
+}
+
+/**
+ * Use empty placeholders (all values unsupported) and let CertificateLoader
+ * fetch both the details and checks.
+ */
+void CertificatePrivate::loadAsync()
+{
+   if (!m_pDetailsCache)
+      m_pDetailsCache = new DetailsCache({});
+
+   if (!m_pCheckCache)
+      m_pCheckCache = new ChecksCache({});
+
+   if (!m_IsLoading) {
+      m_IsLoading = true;
+      CertificateLoader::instance().request(q_ptr);
    }
 }
 
+///Replace the placeholders with the CertificateLoader results
+void CertificatePrivate::setResults(const MapStringString& details, const MapStringString& checks)
+{
+   if (m_pDetailsCache)
+      delete m_pDetailsCache;
+
+   if (m_pCheckCache)
+      delete m_pCheckCache;
+
+   m_pDetailsCache = new DetailsCache(details);
+   m_pCheckCache   = new ChecksCache (checks );
+   m_IsLoading     = false;
+
+   CertificateModel::instance().d_ptr->regenDetails(q_ptr);
+   CertificateModel::instance().d_ptr->regenChecks (q_ptr);
+
+   emit q_ptr->changed();
+}
+
 Certificate::Certificate(const QString& path, Type type, const QString& privateKey) : ItemBase(nullptr),d_ptr(new CertificatePrivate(this,LoadingType::FROM_PATH))
 {
    Q_UNUSED(privateKey)
@@ -552,7 +608,7 @@ QDateTime Certificate::nextExpectedUpdateDate() const
 }
 
 bool Certificate::isActivated() const {
-   d_ptr->loadDetails();
+   d_ptr->loadChecks();
    return d_ptr->m_pCheckCache->m_NotActivated == Certificate::CheckValues::PASSED;
 }
 
@@ -591,6 +647,17 @@ QString Certificate::privateKeyPath() const
    return d_ptr->m_PrivateKey;
 }
 
+/**
+ * If the details and checks are still being fetched in the background. Until
+ * then, they are all empty or unsupported.
+ *
+ * @see CertificateModel::setAsynchronousLoading
+ */
+bool Certificate::isLoading() const
+{
+   return d_ptr->m_IsLoading;
+}
+
 Certificate::Type Certificate::type() const
 {
    return d_ptr->m_Type;
@@ -598,7 +665,7 @@ Certificate::Type Certificate::type() const
 
 QString Certificate::outgoingServer() const
 {
-   d_ptr->loadChecks();
+   d_ptr->loadDetails();
    return d_ptr->m_pDetailsCache->m_OutgoingServer;
 }
 
@@ -37,6 +37,7 @@ class LIB_EXPORT Certificate : public ItemBase
 
    friend class CertificateModel;
    friend class CertificateModelPrivate;
+   friend class CertificateLoader;
    friend class SecurityEvaluationModel;
    friend class SecurityEvaluationModelPrivate;
 public:
@@ -64,6 +65,7 @@ public:
    Q_PROPERTY(CheckValues hasExpectedOwner                    READ hasExpectedOwner                    )
    Q_PROPERTY(bool        isActivated                         READ isActivated                         )
    Q_PROPERTY(bool        hasRemote                           READ hasRemote                           )
+   Q_PROPERTY(bool        isLoading                           READ isLoading                           )
    Q_PROPERTY(QByteArray  remoteId                            READ remoteId                            )
    Q_PROPERTY(QString     path                                READ path              WRITE setPath     )
    Q_PROPERTY(QString     privateKeyPath                      READ privateKeyPath    WRITE setPrivateKeyPath)
@@ -229,6 +231,7 @@ public:
    QAbstractItemModel* model            (                             ) const;
    QAbstractItemModel* checksModel      (                             ) const;
    bool hasRemote                       (                             ) const;
+   bool isLoading                       (                             ) const;
    QByteArray remoteId                  (                             ) const;
    Status     status                    ( const Account* a            ) const;
    bool       requireStrictPermission   (                             ) const;
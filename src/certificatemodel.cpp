@@ -41,6 +41,7 @@
 #include "daemoncertificatecollection.h"
 #include "private/matrixutils.h"
 #include "private/certificatemodel_p.h"
+#include "private/certificateloader.h"
 #include "accountmodel.h"
 
 /*
@@ -224,6 +225,7 @@ QHash<int,QByteArray> CertificateModel::roleNames() const
       roles[static_cast<int>(Role::isCheck )] = "isCheck" ;
       roles[static_cast<int>(Role::detail  )] = "detail"  ;
       roles[static_cast<int>(Role::check   )] = "check"   ;
+      roles[static_cast<int>(Role::isLoading)] = "isLoading";
    }
    return roles;
 }
@@ -341,6 +343,39 @@ void CertificateModelPrivate::regenChecks(Certificate* cert)
       loadChecks(n->m_lChildren[1], cert);
 }
 
+///Update the details once they are loaded asynchronously
+void CertificateModelPrivate::regenDetails(Certificate* cert)
+{
+   CertificateNode* n = m_hNodes.value(cert);
+
+   if (!n)
+      return;
+
+   const QModelIndex idx = q_ptr->createIndex(n->m_Index, static_cast<int>(CertificateModel::Columns::NAME), n);
+
+   // Not expanded yet, the m_fLoader will read the new values
+   if (!n->m_IsLoaded || n->m_lChildren.isEmpty()) {
+      emit q_ptr->dataChanged(idx, idx);
+      return;
+   }
+
+   n->m_Col1 = cert->detailResult(Certificate::Details::PUBLIC_KEY_ID).toString();
+
+   CertificateNode* details = n->m_lChildren.first();
+
+   for (CertificateNode* d : details->m_lChildren)
+      d->m_Col2 = cert->detailResult(static_cast<Certificate::Details>(d->m_EnumClassDetail));
+
+   emit q_ptr->dataChanged(idx, idx);
+
+   if (!details->m_lChildren.isEmpty()) {
+      emit q_ptr->dataChanged(
+         q_ptr->createIndex(0, static_cast<int>(CertificateModel::Columns::NAME), details->m_lChildren.first()),
+         q_ptr->createIndex(details->m_lChildren.size()-1, static_cast<int>(CertificateModel::Columns::VALUE), details->m_lChildren.last())
+      );
+   }
+}
+
 //[Re]generate the checks
 void CertificateModelPrivate::loadChecks(CertificateNode* checks, Certificate* cert)
 {
@@ -349,8 +384,8 @@ void CertificateModelPrivate::loadChecks(CertificateNode* checks, Certificate* c
 
    //Clear the existing nodes
    if (checks->m_lChildren.size()) {
-      q_ptr->beginRemoveRows(checksI, 0, checks->m_lChildren.size());
-      const QList<CertificateNode*> nodes;
+      q_ptr->beginRemoveRows(checksI, 0, checks->m_lChildren.size() - 1);
+      const QVector<CertificateNode*> nodes = checks->m_lChildren;
 
       for (CertificateNode* n : nodes)
          delete n;
@@ -548,6 +583,11 @@ QVariant CertificateModel::data( const QModelIndex& index, int role) const
          }
          break;
       case CertificateModel::NodeType::CERTIFICATE     :
+         switch(role) {
+            case (int)Role::isLoading:
+               return node->m_pCertificate ? node->m_pCertificate->isLoading() : false;
+         }
+         break;
       case CertificateModel::NodeType::DETAILS_CATEGORY:
       case CertificateModel::NodeType::CATEGORY        :
          break;
@@ -846,6 +886,24 @@ QAbstractItemModel* CertificateModel::singleCertificateModel(const QModelIndex&
    return d_ptr->getModelCommon(node);
 }
 
+/**
+ * Fetch the certificates details and checks in the background instead of
+ * blocking the first time they are read. Until they are available, the
+ * certificates are flagged as loading and their values are all unsupported.
+ *
+ * The results are cached on disk so unchanged certificates are not validated
+ * again at the next startup.
+ */
+void CertificateModel::setAsynchronousLoading(bool value)
+{
+   CertificateLoader::instance().setEnabled(value);
+}
+
+bool CertificateModel::isAsynchronousLoading() const
+{
+   return CertificateLoader::instance().isEnabled();
+}
+
 /**
  * Create a view of the CertificateModel with only the certificates
  * associated with an account. This doesn't contain the account
@@ -46,6 +46,7 @@ public:
       detail            ,
       check             ,
       requirePrivateKey ,
+      isLoading         ,
 
       // "Virtual" roles for each certificate values
       DetailRoleBase    = 1000,
@@ -80,6 +81,10 @@ public:
 
    //Getter
    QAbstractItemModel* singleCertificateModel(const QModelIndex& idx) const;
+   bool isAsynchronousLoading() const;
+
+   //Setter
+   void setAsynchronousLoading(bool value);
 
    //Mutator
    Certificate* getCertificateFromPath(const QString& path, Certificate::Type type = Certificate::Type::NONE);
@@ -18,11 +18,14 @@
 #include "foldercertificatecollection.h"
 
 //Qt
-#include <QtCore/QThread>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
 #include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QUrl>
 
@@ -53,25 +56,61 @@ private:
    virtual QVector<Certificate*> items() const override;
 };
 
-class BackgroundLoader final : public QThread
+class BackgroundLoader final : public QObject
 {
    Q_OBJECT
 public:
-   BackgroundLoader(FolderCertificateCollection* parent);
+   ///The certificates found in a directory
+   struct Folder {
+      QString     path      ;
+      QString     parentPath; /*!< Empty for the collections being loaded */
+      QStringList files     ;
+   };
+
+   static BackgroundLoader& instance();
+
+   //Mutator
+   void load   ( FolderCertificateCollection* collection                  );
+   void scan   ( const QString& path, const QString& parentPath,
+                 const QString& root, bool rec                          );
+   void scanned( const Folder& folder                                     );
+
+private:
+   explicit BackgroundLoader();
 
    //Attributes
-   QMutex            m_LoaderMutex;
-   FolderCertificateCollection* m_pCurrentFolder;
-   QList<FolderCertificateCollection*> m_lFolderQueue;
+   QThreadPool      m_Pool               ;
+   QMutex           m_Mutex              ;
+   QHash<QString, QSet<QString>> m_hVisited; /*!< Canonical paths per load, symlinks can loop */
+   QVector<Folder>  m_lPending           ;
+   bool             m_IsScheduled {false};
+
+   ///Only accessed from the model thread
+   QHash<QString, FolderCertificateCollection*> m_hCollections;
 
-   //Helpers
-   QByteArray        loadCertificate(const QByteArray& id);
+private Q_SLOTS:
+   void flush();
+};
+
+/**
+ * List and parse the certificates of a single directory. The sub-directories
+ * are scanned by their own FolderScanner.
+ */
+class FolderScanner final : public QRunnable
+{
+public:
+   FolderScanner(const QString& path, const QString& parentPath, const QString& root, bool recursive) :
+      m_Path(path), m_ParentPath(parentPath), m_Root(root), m_IsRecursive(recursive) {}
 
-protected:
    virtual void run() override;
 
-Q_SIGNALS:
-   void listLoaded(const QList<QByteArray>& list);
+private:
+   QString m_Path       ;
+   QString m_ParentPath ;
+   QString m_Root       ; /*!< The directory of the collection being loaded */
+   bool    m_IsRecursive;
+
+   static bool isCertificate(const QString& path);
 };
 
 class FolderCertificateCollectionPrivate
@@ -86,14 +125,12 @@ public:
    FolderCertificateCollection* m_pParent          ;
    static bool                  m_sHasFallbackStore;
    FolderCertificateCollection* q_ptr              ;
-   static BackgroundLoader*     m_spLoader         ;
 
    //Helper
    QList<CollectionInterface::Element> getCertificateList();
 };
 
 bool FolderCertificateCollectionPrivate::m_sHasFallbackStore = false;
-BackgroundLoader* FolderCertificateCollectionPrivate::m_spLoader = nullptr;
 
 FolderCertificateCollection::FolderCertificateCollection(CollectionMediator<Certificate>* mediator,
   const QString& path               ,
@@ -132,36 +169,11 @@ FolderCertificateCollection::~FolderCertificateCollection()
    delete d_ptr;
 }
 
-QByteArray BackgroundLoader::loadCertificate(const QByteArray& id)
-{
-//    QMutexLocker(&this->m_Mutex);
-   QFile file(id);
-   if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-      qDebug() << "Error opening certificate: " << id;
-      return QByteArray();
-   }
-
-   return file.readAll();
-}
-
 bool FolderCertificateCollection::load()
 {
    if (d_ptr->m_IsValid) {
       //Load the stored certificates
-      if (!d_ptr->m_spLoader) {
-         d_ptr->m_spLoader = new BackgroundLoader(this);
-         QObject::connect(d_ptr->m_spLoader, SIGNAL(finished()), d_ptr->m_spLoader, SLOT(deleteLater()));
-      }
-
-      /*if (!loader->isFinished())
-         connect(loader,&BackgroundLoader::finished,[loader](){
-            delete loader;
-         });*/
-
-      d_ptr->m_spLoader->m_lFolderQueue << this;
-
-      if (!d_ptr->m_spLoader->isRunning())
-         d_ptr->m_spLoader->start();
+      BackgroundLoader::instance().load(this);
       return true;
    }
    return false;
@@ -307,15 +319,18 @@ QVector<Certificate*> FallbackLocalCertificateEditor::items() const
  *                                                                             *
  ******************************************************************************/
 
-BackgroundLoader::BackgroundLoader(FolderCertificateCollection* parent) : QThread(nullptr),
-m_pCurrentFolder(parent)
+BackgroundLoader::BackgroundLoader() : QObject(nullptr)
 {
+}
 
+BackgroundLoader& BackgroundLoader::instance()
+{
+   static auto loader = new BackgroundLoader();
+   return *loader;
 }
 
 QList<CollectionInterface::Element> FolderCertificateCollectionPrivate::getCertificateList()
 {
-//    QMutexLocker(&this->m_Mutex);
    QDir dir(m_Path);
 
    if (!dir.exists())
@@ -326,43 +341,166 @@ QList<CollectionInterface::Element> FolderCertificateCollectionPrivate::getCerti
       ret << (m_Path + "/" + str).toLatin1();
    }
 
-   if (m_Flags & FolderCertificateCollection::Options::RECURSIVE) {
-      for (const QString& d : dir.entryList(QDir::AllDirs)) {
-         if (d != QString('.') && d != "..") {
-            CertificateModel::instance().addCollection<FolderCertificateCollection,QString,FlagPack<FolderCertificateCollection::Options>,QString,FolderCertificateCollection*>(
-               m_Path+'/'+d              ,
-               m_Flags                   ,
-               d                         ,
-               q_ptr                     ,
-               LoadOptions::FORCE_ENABLED
-            );
-         }
-      }
+   return ret;
+}
+
+///Start loading "collection", must be called from the model thread
+void BackgroundLoader::load(FolderCertificateCollection* collection)
+{
+   const QString path = collection->d_ptr->m_Path;
+
+   // This is a sub-directory created by flush(), it is already scanned
+   const auto i = m_hCollections.find(path);
+   if (i != m_hCollections.end() && !i.value()) {
+      i.value() = collection;
+      return;
    }
 
-   return ret;
+   m_hCollections[path] = collection;
+
+   // Start from scratch, the directories may have changed since the last load
+   {
+      QMutexLocker locker(&m_Mutex);
+      m_hVisited[path].clear();
+   }
+
+   scan(path, QString(), path, collection->d_ptr->m_Flags & FolderCertificateCollection::Options::RECURSIVE);
+}
+
+///Queue a directory scan, unless it was already visited by this load
+void BackgroundLoader::scan(const QString& path, const QString& parentPath, const QString& root, bool rec)
+{
+   const QString canonical = QFileInfo(path).canonicalFilePath();
+
+   if (canonical.isEmpty())
+      return;
+
+   {
+      QMutexLocker locker(&m_Mutex);
+
+      QSet<QString>& visited = m_hVisited[root];
+
+      if (visited.contains(canonical))
+         return;
+
+      visited.insert(canonical);
+   }
+
+   m_Pool.start(new FolderScanner(path, parentPath, root, rec));
+}
+
+/**
+ * Called by the scanners. The folders are applied in batches by flush().
+ *
+ * A folder is always added before its sub-directories are scanned, so the
+ * parent collections exist by the time their children are applied.
+ */
+void BackgroundLoader::scanned(const Folder& folder)
+{
+   QMutexLocker locker(&m_Mutex);
+
+   m_lPending << folder;
+
+   if (!m_IsScheduled) {
+      m_IsScheduled = true;
+      QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+   }
 }
 
-void BackgroundLoader::run()
+/**
+ * Add the scanned certificates to the model, runs in the model thread.
+ *
+ * The paths are also pinned from here, the daemon proxy isn't thread safe.
+ */
+void BackgroundLoader::flush()
 {
-   while (m_lFolderQueue.size()) {
-      m_pCurrentFolder = m_lFolderQueue.takeFirst();
+   QVector<Folder> folders;
+
+   {
+      QMutexLocker locker(&m_Mutex);
+      folders.swap(m_lPending);
+      m_IsScheduled = false;
+   }
+
+   ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
+
+   for (const Folder& f : folders) {
+      configurationManager.pinCertificatePath(QUrl(f.path).path()+'/');
+
+      FolderCertificateCollection* c = m_hCollections.value(f.path);
+
+      // Sub-directories have their own collection
+      if (!c) {
+         FolderCertificateCollection* parent = m_hCollections.value(f.parentPath);
+
+         if (!parent)
+            continue;
+
+         // Tell load() it is already scanned
+         m_hCollections[f.path] = nullptr;
+
+         c = CertificateModel::instance().addCollection<FolderCertificateCollection,QString,FlagPack<FolderCertificateCollection::Options>,QString,FolderCertificateCollection*>(
+            f.path                         ,
+            parent->d_ptr->m_Flags         ,
+            QFileInfo(f.path).fileName()   ,
+            parent                         ,
+            LoadOptions::FORCE_ENABLED
+         );
+
+         m_hCollections[f.path] = c;
+      }
 
-      QMutexLocker(&this->m_LoaderMutex);
-      for(const QByteArray& id : m_pCurrentFolder->listId()) {
-         Certificate* cert = CertificateModel::instance().getCertificateFromPath(id);
-         m_pCurrentFolder->editor<Certificate>()->addExisting(cert);
+      const bool isRoot = c->d_ptr->m_Flags & FolderCertificateCollection::Options::ROOT;
 
-         if (m_pCurrentFolder->d_ptr->m_Flags & FolderCertificateCollection::Options::ROOT)
+      for (const QString& file : f.files) {
+         Certificate* cert = CertificateModel::instance().getCertificateFromPath(file);
+         c->editor<Certificate>()->addExisting(cert);
+
+         if (isRoot)
             cert->addOrigin(Certificate::OriginHint::ROOT_AUTORITY);
       }
+   }
+}
+
+///Check the file holds a PEM certificate (or, for .crt, a DER one)
+bool FolderScanner::isCertificate(const QString& path)
+{
+   QFile file(path);
+
+   if (!file.open(QIODevice::ReadOnly)) {
+      qDebug() << "Error opening certificate: " << path;
+      return false;
+   }
+
+   const QByteArray content = file.readAll();
+
+   if (content.contains("-----BEGIN CERTIFICATE-----")
+    || content.contains("-----BEGIN TRUSTED CERTIFICATE-----"))
+      return true;
+
+   // DER is an ASN.1 SEQUENCE
+   return path.endsWith(QLatin1String(".crt")) && content.size() && content[0] == 0x30;
+}
+
+void FolderScanner::run()
+{
+   const QDir dir(m_Path);
+
+   BackgroundLoader::Folder folder { m_Path, m_ParentPath, {} };
+
+   for (const QString& str : dir.entryList({"*.pem","*.crt"}, QDir::Files | QDir::Readable)) {
+      const QString path = m_Path + '/' + str;
+
+      if (isCertificate(path))
+         folder.files << path;
+   }
+
+   BackgroundLoader::instance().scanned(folder);
 
-      ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
-      //qDebug() << "\n\nPINING PATH TODO remove extra /" << m_pCurrentFolder->path();
-      configurationManager.pinCertificatePath(m_pCurrentFolder->path().path()+'/');
+   if (m_IsRecursive) {
+      for (const QString& d : dir.entryList(QDir::AllDirs | QDir::NoDotAndDotDot))
+         BackgroundLoader::instance().scan(m_Path + '/' + d, m_Path, m_Root, true);
    }
-   FolderCertificateCollectionPrivate::m_spLoader = nullptr;
-   QThread::exit(0);
 }
 
 #include "foldercertificatecollection.moc"
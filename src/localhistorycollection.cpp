@@ -23,9 +23,11 @@
 #include <QtCore/QDir>
 #include <QtCore/QHash>
 #include <QtCore/QStandardPaths>
-#include <QtCore/QStandardPaths>
 #include <QtCore/QUrl>
 
+//libSTDC++
+#include <algorithm>
+
 //Ring
 #include "call.h"
 #include "media/media.h"
@@ -36,8 +38,15 @@
 #include "certificate.h"
 #include "contactmethod.h"
 #include "categorizedhistorymodel.h"
+#include "phonedirectorymodel.h"
 #include "globalinstances.h"
 #include "interfaces/pixmapmanipulatori.h"
+#include "private/historystore.h"
+
+static QString historyPath(const QString& fileName)
+{
+   return QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/') + fileName;
+}
 
 class LocalHistoryEditor final : public CollectionEditor<Call>
 {
@@ -53,8 +62,7 @@ private:
    virtual QVector<Call*> items() const override;
 
    //Helpers
-   void saveCall(QTextStream& stream, const Call* call);
-   bool regenFile(const Call* toIgnore);
+   static HistoryStore::HistoryMap toHistoryMap(const Call* call);
 
    //Attributes
    QVector<Call*> m_lItems;
@@ -68,81 +76,65 @@ CollectionEditor<Call>(m),m_pCollection(parent)
 }
 
 LocalHistoryCollection::LocalHistoryCollection(CollectionMediator<Call>* mediator) :
-CollectionInterface(new LocalHistoryEditor(mediator,this)),m_pMediator(mediator)
+CollectionInterface(new LocalHistoryEditor(mediator,this)),m_pMediator(mediator),
+m_pStore(new HistoryStore(historyPath(QStringLiteral("history.bin"))))
 {
 //    setObjectName("LocalHistoryCollection");
 }
 
 LocalHistoryCollection::~LocalHistoryCollection()
 {
-
+   delete m_pStore;
 }
 
-void LocalHistoryEditor::saveCall(QTextStream& stream, const Call* call)
+HistoryStore::HistoryMap LocalHistoryEditor::toHistoryMap(const Call* call)
 {
-   if (!CategorizedHistoryModel::instance().isHistoryEnabled())
-      return;
-
-   stream.setCodec("UTF-8");
    const QString direction = (call->direction()==Call::Direction::INCOMING)?
       Call::HistoryStateName::INCOMING : Call::HistoryStateName::OUTGOING;
 
    const Account* a = call->account();
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::CALLID          ).arg(call->historyId()                       );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::TIMESTAMP_START ).arg(call->startTimeStamp()                  );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::TIMESTAMP_STOP  ).arg(call->stopTimeStamp()                   );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::ACCOUNT_ID      ).arg(a?QString(a->id()):""                   );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::DISPLAY_NAME    ).arg(call->peerName()                        );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::PEER_NUMBER     ).arg(call->peerContactMethod()->uri().full() );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::DIRECTION       ).arg(direction                               );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::MISSED          ).arg(call->isMissed()                        );
-   stream << QString("%1=%2\n").arg(Call::HistoryMapFields::CONTACT_USED    ).arg(false                                   );//TODO
+
+   HistoryStore::HistoryMap hc;
+   hc[ Call::HistoryMapFields::CALLID          ] = call->historyId()                              ;
+   hc[ Call::HistoryMapFields::TIMESTAMP_START ] = QString::number(call->startTimeStamp())        ;
+   hc[ Call::HistoryMapFields::TIMESTAMP_STOP  ] = QString::number(call->stopTimeStamp ())        ;
+   hc[ Call::HistoryMapFields::ACCOUNT_ID      ] = a?QString(a->id()):QString()                   ;
+   hc[ Call::HistoryMapFields::DISPLAY_NAME    ] = call->peerName()                               ;
+   hc[ Call::HistoryMapFields::PEER_NUMBER     ] = call->peerContactMethod()->uri().full()        ;
+   hc[ Call::HistoryMapFields::DIRECTION       ] = direction                                      ;
+   hc[ Call::HistoryMapFields::MISSED          ] = QString::number(call->isMissed())              ;
+   hc[ Call::HistoryMapFields::CONTACT_USED    ] = QString::number(false)                         ;//TODO
 
    //TODO handle more than one recording
    if (call->hasRecording(Media::Media::Type::AUDIO,Media::Media::Direction::IN)) {
-      stream << QString("%1=%2\n").arg(Call::HistoryMapFields::RECORDING_PATH  ).arg(((Media::AVRecording*)call->recordings(Media::Media::Type::AUDIO,Media::Media::Direction::IN)[0])->path().path());
+      hc[ Call::HistoryMapFields::RECORDING_PATH ] = ((Media::AVRecording*)call->recordings(Media::Media::Type::AUDIO,Media::Media::Direction::IN)[0])->path().path();
    }
 
-   if (call->peerContactMethod()->contact()) {
-      stream << QString("%1=%2\n").arg(Call::HistoryMapFields::CONTACT_UID  ).arg(
-         QString(call->peerContactMethod()->contact()->uid())
-      );
-   }
+   if (call->peerContactMethod()->contact())
+      hc[ Call::HistoryMapFields::CONTACT_UID ] = QString(call->peerContactMethod()->contact()->uid());
+
    if (call->certificate())
-      stream << QString("%1=%2\n").arg(Call::HistoryMapFields::CERT_PATH).arg(call->certificate()->path());
-   stream << "\n";
-   stream.flush();
-}
+      hc[ Call::HistoryMapFields::CERT_PATH ] = call->certificate()->path();
 
-bool LocalHistoryEditor::regenFile(const Call* toIgnore)
-{
-   QDir dir(QString('/'));
-   dir.mkpath(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/') + QString());
-
-   QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/') +"history.ini");
-   if ( file.open(QIODevice::WriteOnly | QIODevice::Text) ) {
-      QTextStream stream(&file);
-      for (const Call* c : CategorizedHistoryModel::instance().getHistoryCalls()) {
-         if (c != toIgnore)
-            saveCall(stream, c);
-      }
-      file.close();
-      return true;
-   }
-   return false;
+   return hc;
 }
 
+///Saving a call append a record superseding the previous one
 bool LocalHistoryEditor::save(const Call* call)
 {
    if (call->collection()->editor<Call>() != this)
       return addNew(const_cast<Call*>(call));
 
-   return regenFile(nullptr);
+   if (!CategorizedHistoryModel::instance().isHistoryEnabled())
+      return true;
+
+   return m_pCollection->m_pStore->append(toHistoryMap(call));
 }
 
+///Removing a call append a tombstone
 bool LocalHistoryEditor::remove(const Call* item)
 {
-   if (regenFile(item)) {
+   if (m_pCollection->m_pStore->remove(item->historyId())) {
       mediator()->removeItem(item);
       return true;
    }
@@ -157,25 +149,17 @@ bool LocalHistoryEditor::edit( Call* item)
 
 bool LocalHistoryEditor::addNew( Call* call)
 {
-   QDir dir(QString('/'));
-   dir.mkpath(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/') + QString());
-
    if ((call->collection() && call->collection()->editor<Call>() == this)  || call->historyId().isEmpty()) return false;
-   //TODO support \r and \n\r end of line
-   QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/')+"history.ini");
-
-   if ( file.open(QIODevice::Append | QIODevice::Text) ) {
-      QTextStream streamFileOut(&file);
-      saveCall(streamFileOut, call);
-      file.close();
 
-      const_cast<Call*>(call)->setCollection(m_pCollection);
-      addExisting(call);
-      return true;
-   }
-   else
+   if (CategorizedHistoryModel::instance().isHistoryEnabled()
+    && !m_pCollection->m_pStore->append(toHistoryMap(call))) {
       qWarning() << "Unable to save history";
-   return false;
+      return false;
+   }
+
+   const_cast<Call*>(call)->setCollection(m_pCollection);
+   addExisting(call);
+   return true;
 }
 
 bool LocalHistoryEditor::addExisting(const Call* item)
@@ -210,49 +194,129 @@ bool LocalHistoryCollection::isEnabled() const
    return true;
 }
 
+/**
+ * Load the calls from the binary history log. The first time, the legacy
+ * history.ini is imported into it.
+ */
 bool LocalHistoryCollection::load()
 {
    if (!CategorizedHistoryModel::instance().isHistoryEnabled())
       return false;
 
-   QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/') +"history.ini");
-   if ( file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
-      QMap<QString,QString> hc;
-      QStringList lines;
-
-      while (!file.atEnd())
-         lines << file.readLine().trimmed();
-      file.close();
-
-      const bool      isLimited = CategorizedHistoryModel::instance().isHistoryLimited();
-      const long long dayLimit  = CategorizedHistoryModel::instance().historyLimit() * 24 * 3600;
-
-      time_t now = time(0); // get time now
-
-      for (const QString& line : lines) {
-         //The item is complete
-         if ((line.isEmpty() || !line.size()) && hc.size()) {
-            Call* pastCall = Call::buildHistoryCall(hc);
-
-            if (!isLimited || ( (now - pastCall->startTimeStamp()) < dayLimit) ) {
-               pastCall->setCollection(this);
-               editor<Call>()->addExisting(pastCall);
-            }
-
-            hc.clear();
-         }
-         // Add to the current set
-         else {
-            const int idx = line.indexOf("=");
-            if (idx >= 0)
-               hc[line.left(idx)] = line.right(line.size()-idx-1);
-         }
+   const QString legacyPath = historyPath(QStringLiteral("history.ini"));
+   const bool    needImport = (!m_pStore->exists()) && QFile::exists(legacyPath);
+
+   if (!m_pStore->open()) {
+      qWarning() << "History doesn't exist or is not readable";
+      return false;
+   }
+
+   if (needImport) {
+      if (m_pStore->importIni(legacyPath))
+         QFile::rename(legacyPath, legacyPath + QStringLiteral(".imported"));
+      else
+         qWarning() << "Unable to import" << legacyPath;
+   }
+
+   const bool      isLimited = CategorizedHistoryModel::instance().isHistoryLimited();
+   const long long dayLimit  = CategorizedHistoryModel::instance().historyLimit() * 24 * 3600;
+   const int       window    = CategorizedHistoryModel::instance().loadingWindow();
+
+   // Drop the expired calls from the log, not only from the view
+   if (isLimited)
+      m_pStore->expire(time(0) - dayLimit);
+
+   QVector<HistoryStore::Entry> entries = m_pStore->entries();
+
+   // Only keep the index, the calls are built when they are fetched
+   if (window > 0) {
+      std::stable_sort(entries.begin(), entries.end(), [](const HistoryStore::Entry& a, const HistoryStore::Entry& b) {
+         return a.startTimeStamp > b.startTimeStamp;
+      });
+   }
+
+   m_lPending.clear();
+   m_lPendingIds.clear();
+
+   // The calls create most of the ContactMethods at startup
+   PhoneDirectoryModel::BulkInsertion bulk;
+
+   for (const HistoryStore::Entry& entry : entries) {
+      // The calls without an id can't be fetched later
+      if (window > 0 && !entry.historyId.isEmpty()) {
+         const Element id = entry.historyId.toUtf8();
+         m_lPending    << id;
+         m_lPendingIds << id;
+      }
+      else {
+         HistoryStore::HistoryMap hc;
+
+         if (m_pStore->read(entry.offset, hc))
+            addCall(hc);
       }
-      return true;
    }
+
+   if (!m_lPending.isEmpty())
+      fetch(m_lPending.mid(0, window));
+
+   return true;
+}
+
+void LocalHistoryCollection::addCall(const QMap<QString,QString>& hc)
+{
+   Call* pastCall = Call::buildHistoryCall(hc);
+   pastCall->setCollection(this);
+   editor<Call>()->addExisting(pastCall);
+}
+
+///The ids of the calls not loaded yet, the most recent first
+QList<CollectionInterface::Element> LocalHistoryCollection::listId() const
+{
+   return m_lPending;
+}
+
+bool LocalHistoryCollection::listId(std::function<void(const QList<Element>)> callback) const
+{
+   callback(m_lPending);
+   return true;
+}
+
+/**
+ * Build the call "element" if it isn't loaded yet.
+ *
+ * The record is looked up by id, the log may have been compacted since
+ * load() and the offsets changed.
+ */
+bool LocalHistoryCollection::fetch(const Element& element)
+{
+   if (!m_lPendingIds.remove(element))
+      return false;
+
+   // The windows are fetched in order, avoid the linear search
+   if (m_lPending.first() == element)
+      m_lPending.removeFirst();
    else
-      qWarning() << "History doesn't exist or is not readable";
-   return false;
+      m_lPending.removeOne(element);
+
+   HistoryStore::HistoryMap hc;
+
+   // It may have been removed meanwhile
+   if (!m_pStore->read(QString::fromUtf8(element), hc))
+      return false;
+
+   addCall(hc);
+
+   return true;
+}
+
+bool LocalHistoryCollection::fetch(const QList<Element>& elements)
+{
+   bool ret = true;
+
+   for (const Element& e : elements)
+      ret &= fetch(e);
+
+   return ret;
 }
 
 bool LocalHistoryCollection::reload()
@@ -268,13 +332,18 @@ FlagPack<CollectionInterface::SupportedFeatures> LocalHistoryCollection::support
       CollectionInterface::SupportedFeatures::CLEAR      |
       CollectionInterface::SupportedFeatures::REMOVE     |
       CollectionInterface::SupportedFeatures::MANAGEABLE |
+      CollectionInterface::SupportedFeatures::LISTABLE   |
+      CollectionInterface::SupportedFeatures::FETCH      |
       CollectionInterface::SupportedFeatures::ADD        ;
 }
 
 bool LocalHistoryCollection::clear()
 {
-   QFile::remove(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1Char('/') +"history.ini");
-   return true;
+   m_lPending.clear();
+   m_lPendingIds.clear();
+
+   QFile::remove(historyPath(QStringLiteral("history.ini")));
+   return m_pStore->clear();
 }
 
 QByteArray LocalHistoryCollection::id() const
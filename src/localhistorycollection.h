@@ -18,15 +18,21 @@
  ***********************************************************************************/
 #pragma once
 
+#include <QtCore/QMap>
+#include <QtCore/QSet>
+
 #include "collectioninterface.h"
 #include "collectioneditor.h"
 
 class Call;
+class HistoryStore;
+class LocalHistoryEditor;
 
 template<typename T> class CollectionMediator;
 
 class LIB_EXPORT LocalHistoryCollection : public CollectionInterface
 {
+   friend class LocalHistoryEditor;
 public:
    explicit LocalHistoryCollection(CollectionMediator<Call>* mediator);
    virtual ~LocalHistoryCollection();
@@ -35,6 +41,11 @@ public:
    virtual bool reload() override;
    virtual bool clear () override;
 
+   virtual QList<Element> listId() const override;
+   virtual bool listId(std::function<void(const QList<Element>)> callback) const override;
+   virtual bool fetch( const Element& element) override;
+   virtual bool fetch( const QList<Element>& elements) override;
+
    virtual QString    name     () const override;
    virtual QString    category () const override;
    virtual QVariant   icon     () const override;
@@ -45,5 +56,11 @@ public:
 
 private:
    CollectionMediator<Call>*  m_pMediator;
+   HistoryStore*              m_pStore   ;
+   QList<Element>             m_lPending   ; /*!< Not loaded yet, most recent first */
+   QSet<Element>              m_lPendingIds; /*!< Same as m_lPending, for lookups   */
+
+   //Helpers
+   void addCall(const QMap<QString,QString>& hc);
 };
 
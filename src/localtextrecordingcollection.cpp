@@ -23,6 +23,12 @@
 #include <QtCore/QStandardPaths>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+//libSTDC++
+#include <algorithm>
 
 //Ring
 #include <globalinstances.h>
@@ -32,7 +38,10 @@
 #include <media/textrecording.h>
 #include <private/textrecording_p.h>
 #include <private/contactmethod_p.h>
+#include <private/textjournal.h>
+#include <private/textsearchindex.h>
 #include <media/media.h>
+#include <phonedirectorymodel.h>
 
 /*
  * This collection store and load the instant messaging conversations. Lets call
@@ -44,7 +53,50 @@
  *
  * If more than 1 peer is part of the conversation, then their hash are
  * concatenated then hashed in sha1 again.
+ *
+ * The json files are snapshots, the messages added or modified since are
+ * appended to a journal next to them (see TextJournal).
+ *
+ * When loading by pages, the conversations are created from their metadata
+ * and their messages are only read once they are displayed.
+ */
+
+static int s_PageSize = 0;
+
+/**
+ * Read and parse a conversation (or only its metadata) on a worker thread.
+ * The objects are then created on the main thread.
  */
+class ConversationReader final : public QRunnable
+{
+public:
+   struct Result {
+      QJsonObject metadata    ;
+      QJsonObject conversation;
+      bool        ok {false}  ;
+   };
+
+   ConversationReader(const QString& dir, const QByteArray& sha1, Result* result) :
+      m_Dir(dir), m_Sha1(sha1), m_pResult(result) {}
+
+   virtual void run() override
+   {
+      // When loading by pages, the messages are read on demand
+      if (s_PageSize > 0) {
+         m_pResult->metadata = TextJournal::metadata(m_Dir, m_Sha1);
+
+         if (!m_pResult->metadata.isEmpty())
+            return;
+      }
+
+      m_pResult->conversation = TextJournal::load(m_Dir, m_Sha1, &m_pResult->ok);
+   }
+
+private:
+   const QString    m_Dir    ;
+   const QByteArray m_Sha1   ;
+   Result*          m_pResult;
+};
 
 class LocalTextRecordingEditor final : public CollectionEditor<Media::Recording>
 {
@@ -55,7 +107,8 @@ public:
    virtual bool edit       ( Media::Recording*       item ) override;
    virtual bool addNew     ( Media::Recording*       item ) override;
    virtual bool addExisting( const Media::Recording* item ) override;
-   QString fetch(const QByteArray& sha1);
+   QJsonObject fetch(const QByteArray& sha1, bool* ok = nullptr);
+   bool saveMetadata(const Media::TextRecording* recording, const QList<QByteArray>& sha1s);
 
    void clearAll();
 
@@ -82,30 +135,67 @@ LocalTextRecordingCollection& LocalTextRecordingCollection::instance()
    return *instance;
 }
 
+/**
+ * Append the new messages and status changes to the journals. Conversations
+ * which were never saved (or changed in ways the journal can't express) are
+ * saved as a full snapshot.
+ */
 bool LocalTextRecordingEditor::save(const Media::Recording* recording)
 {
-   Q_UNUSED(recording)
-   QHash<QByteArray,QByteArray> ret = static_cast<const Media::TextRecording*>(recording)->d_ptr->toJsons();
+   const Media::TextRecordingPrivate* d = static_cast<const Media::TextRecording*>(recording)->d_ptr;
 
    QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
 
    //Make sure the directory exist
    dir.mkdir("text/");
 
-   //Save each file
-   for (QHash<QByteArray,QByteArray>::const_iterator i = ret.begin(); i != ret.end(); ++i) {
-      QFile file(QString("%1/text/%2.json").arg(dir.path()).arg(QString(i.key())));
+   const QString textDir = dir.path() + QStringLiteral("/text");
 
-      if ( file.open(QIODevice::WriteOnly | QIODevice::Text) ) {
-         QTextStream streamFileOut(&file);
-         streamFileOut.setCodec("UTF-8");
-         streamFileOut << i.value();
-         streamFileOut.flush();
-         file.close();
-      }
+   //The snapshot may have been deleted, the journal can't be used alone
+   for (Serializable::Peers* p : d->m_lAssociatedPeers) {
+      if ((!p->hasChanged) && !QFile::exists(QStringLiteral("%1/%2.json").arg(textDir, p->sha1s[0])))
+         p->hasChanged = true;
    }
 
-   return true;
+   const QHash<QByteArray,QByteArray>        snapshots = d->toJsons    ();
+   const QHash<QByteArray,QList<QByteArray>> journals  = d->takeJournals();
+
+   bool ret = true;
+
+   for (auto i = snapshots.constBegin(); i != snapshots.constEnd(); ++i)
+      ret &= TextJournal::writeSnapshot(textDir, i.key(), i.value());
+
+   for (auto i = journals.constBegin(); i != journals.constEnd(); ++i)
+      ret &= TextJournal::append(textDir, i.key(), i.value());
+
+   ret &= saveMetadata(static_cast<const Media::TextRecording*>(recording), snapshots.keys() + journals.keys());
+
+   return ret;
+}
+
+///Update the metadata of the "sha1s" conversations, it is only used when loading by pages
+bool LocalTextRecordingEditor::saveMetadata(const Media::TextRecording* recording, const QList<QByteArray>& sha1s)
+{
+   if (s_PageSize <= 0)
+      return true;
+
+   const QString textDir = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/text";
+
+   bool ret = true;
+
+   for (const Serializable::Peers* p : recording->d_ptr->m_lAssociatedPeers) {
+      const QByteArray sha1 = p->sha1s[0].toLatin1();
+
+      if ((!p->isLoaded) || !sha1s.contains(sha1))
+         continue;
+
+      QJsonObject metadata;
+      p->writeMetadata(metadata);
+
+      ret &= TextJournal::writeMetadata(textDir, sha1, metadata);
+   }
+
+   return ret;
 }
 
 void LocalTextRecordingEditor::clearAll()
@@ -144,15 +234,9 @@ bool LocalTextRecordingEditor::addExisting(const Media::Recording* item)
    return false;
 }
 
-QString LocalTextRecordingEditor::fetch(const QByteArray& sha1)
+QJsonObject LocalTextRecordingEditor::fetch(const QByteArray& sha1, bool* ok)
 {
-   QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/text/" + sha1 + ".json");
-
-   if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-      return QByteArray();
-   }
-
-   return QString::fromUtf8(file.readAll());
+   return TextJournal::load(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/text", sha1, ok);
 }
 
 QVector<Media::Recording*> LocalTextRecordingEditor::items() const
@@ -185,50 +269,71 @@ bool LocalTextRecordingCollection::load()
     // load all text recordings so we can recover CMs that are not in the call history
     QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/text/");
     if (dir.exists()) {
-        // get .json files, sorted by time, latest first
+        // get .json files, sorted by time (including their journal), latest first
         QStringList filters;
         filters << "*.json";
-        auto list = dir.entryInfoList(filters, QDir::Files | QDir::NoSymLinks | QDir::Readable, QDir::Time);
+        QList<QPair<qint64, QByteArray>> list;
+
+        for (const QFileInfo& fileInfo : dir.entryInfoList(filters, QDir::Files | QDir::NoSymLinks | QDir::Readable)) {
+            const QByteArray sha1 = fileInfo.completeBaseName().toLatin1();
+            list << qMakePair(TextJournal::lastModified(dir.path(), sha1), sha1);
+        }
+
+        std::stable_sort(list.begin(), list.end(), [](const QPair<qint64, QByteArray>& a, const QPair<qint64, QByteArray>& b) {
+            return a.first > b.first;
+        });
+
+        // Parse the files in parallel, each reader fill its own result
+        QVector<ConversationReader::Result> results(list.size());
+
+        QThreadPool pool;
+
+        for (int i = 0; i < list.size(); ++i)
+            pool.start(new ConversationReader(dir.path(), list[i].second, &results[i]));
+
+        pool.waitForDone();
+
+        auto e = static_cast<LocalTextRecordingEditor*>(editor<Media::Recording>());
+
+        // Add the peers to the PhoneDirectoryModel in a single reset
+        PhoneDirectoryModel::BulkInsertion bulk;
 
         for (int i = 0; i < list.size(); ++i) {
-            QFileInfo fileInfo = list.at(i);
-
-            QString content;
-            QFile file(fileInfo.absoluteFilePath());
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                content = QString::fromUtf8(file.readAll());
-            } else {
-                qWarning() << "Could not open text recording json file";
+            const ConversationReader::Result& result = results[i];
+
+            Media::TextRecording* r = nullptr;
+
+            if (!result.metadata.isEmpty())
+                r = Media::TextRecording::fromMetadata(result.metadata, this);
+            else if (result.ok && !result.conversation.isEmpty()) {
+                r = Media::TextRecording::fromJson({result.conversation}, nullptr, this);
+
+                // The metadata is missing or outdated
+                e->saveMetadata(r, {list[i].second});
+            }
+            else {
+                qWarning() << "Text recording file is empty or invalid" << list[i].second;
+                continue;
             }
 
-            if (!content.isEmpty()) {
-                QJsonParseError err;
-                QJsonDocument loadDoc = QJsonDocument::fromJson(content.toUtf8(), &err);
-
-                if (err.error == QJsonParseError::ParseError::NoError) {
-                    Media::TextRecording* r = Media::TextRecording::fromJson({loadDoc.object()}, nullptr, this);
-
-                    editor<Media::Recording>()->addExisting(r);
-
-                    // get CMs from recording
-                    for (ContactMethod *cm : r->peers()) {
-                        // since we load the recordings in order from newest to oldest, if there is
-                        // more than one found associated with a CM, we take the newest one
-                        if (!cm->d_ptr->m_pTextRecording) {
-                            cm->d_ptr->setTextRecording(r);
-                        } else {
-                            qWarning() << "CM already has text recording" << cm;
-                        }
-                    }
+            e->addExisting(r);
+
+            // get CMs from recording
+            for (ContactMethod *cm : r->peers()) {
+                // since we load the recordings in order from newest to oldest, if there is
+                // more than one found associated with a CM, we take the newest one
+                if (!cm->d_ptr->m_pTextRecording) {
+                    cm->d_ptr->setTextRecording(r);
                 } else {
-                    qWarning() << "Error Decoding Text Message History Json" << err.errorString();
+                    qWarning() << "CM already has text recording" << cm;
                 }
-            } else {
-                qWarning() << "Text recording file is empty";
             }
         }
     }
 
+    // index the messages not yet searchable in the background
+    TextSearchIndex::instance().build(dir.path());
+
     // always return true, even if noting was loaded, since the collection can still be used to
     // save files
     return true;
@@ -256,6 +361,7 @@ FlagPack<CollectionInterface::SupportedFeatures> LocalTextRecordingCollection::s
 bool LocalTextRecordingCollection::clear()
 {
     static_cast<LocalTextRecordingEditor *>(editor<Media::Recording>())->clearAll();
+    TextSearchIndex::instance().clear();
 
     QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/text");
 
@@ -306,26 +412,39 @@ bool LocalTextRecordingCollection::fetch( const QList<CollectionInterface::Eleme
 Media::TextRecording* LocalTextRecordingCollection::fetchFor(const ContactMethod* cm)
 {
    const QByteArray& sha1 = cm->sha1();
-   const QString content = static_cast<LocalTextRecordingEditor*>(editor<Media::Recording>())->fetch(sha1);
 
-   if (content.isEmpty())
+   if (!QFile::exists(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/text/" + sha1 + ".json"))
       return nullptr;
 
-   QJsonParseError err;
-   QJsonDocument loadDoc = QJsonDocument::fromJson(content.toUtf8(), &err);
+   bool ok = false;
+   const QJsonObject obj = static_cast<LocalTextRecordingEditor*>(editor<Media::Recording>())->fetch(sha1, &ok);
 
-   if (err.error != QJsonParseError::ParseError::NoError) {
-       qWarning() << "Error Decoding Text Message History Json" << err.errorString();
-       return nullptr;
-   }
+   if (!ok)
+      return nullptr;
 
-   Media::TextRecording* r = Media::TextRecording::fromJson({loadDoc.object()}, cm, this);
+   Media::TextRecording* r = Media::TextRecording::fromJson({obj}, cm, this);
 
    editor<Media::Recording>()->addExisting(r);
 
    return r;
 }
 
+///Load a conversation and replay its journal
+QJsonObject LocalTextRecordingCollection::fetchConversation(const QByteArray& sha1, bool* ok)
+{
+   return static_cast<LocalTextRecordingEditor*>(editor<Media::Recording>())->fetch(sha1, ok);
+}
+
+void LocalTextRecordingCollection::setPageSize(int size)
+{
+   s_PageSize = size;
+}
+
+int LocalTextRecordingCollection::pageSize()
+{
+   return s_PageSize;
+}
+
 Media::TextRecording* LocalTextRecordingCollection::createFor(const ContactMethod* cm)
 {
    Media::TextRecording* r = fetchFor(cm);
@@ -22,6 +22,9 @@
 
 #include <typedefs.h>
 
+//Qt
+class QJsonObject;
+
 namespace Media {
    class Recording;
    class TextRecording;
@@ -49,9 +52,18 @@ public:
 
    Media::TextRecording* fetchFor (const ContactMethod* cm);
    Media::TextRecording* createFor(const ContactMethod* cm);
+   QJsonObject fetchConversation(const QByteArray& sha1, bool* ok = nullptr);
 
    virtual FlagPack<SupportedFeatures> supportedFeatures() const override;
 
    static LocalTextRecordingCollection& instance();
 
+   /**
+    * Load the conversations by pages of "size" messages (0, the default, load
+    * everything). At startup, only the conversations metadata is then read.
+    * It has to be set before the Media::RecordingModel is created.
+    */
+   static void setPageSize(int size);
+   static int  pageSize();
+
 };
@@ -297,6 +297,10 @@ bool Media::RecordingModel::addItemCallback(const Recording* item)
          const TextRecording* r = static_cast<const TextRecording*>(item);
          connect(r, &TextRecording::messageInserted, d_ptr, &RecordingModelPrivate::forwardInsertion);
          connect(r, &TextRecording::unreadCountChange, d_ptr, &RecordingModelPrivate::updateUnreadCount);
+
+         //The messages loaded from the disk
+         if (r->unreadCount())
+            d_ptr->updateUnreadCount(r->unreadCount());
       }
 
       return true;
@@ -185,11 +185,102 @@ void IMConversationManagerPrivate::newAccountMessage(const QString& accountId, c
    }
 }
 
+/**
+ * The delivery status of the "ids" messages. Only those not already known are
+ * queried. The queries are all sent before waiting for the replies, so over
+ * D-Bus it costs a single round-trip instead of one per message.
+ *
+ * The final statuses are only returned once, the caller is expected to clear
+ * the id of these messages.
+ */
+QHash<uint64_t,int> IMConversationManagerPrivate::messageStatus(const QVector<uint64_t>& ids)
+{
+   QHash<uint64_t,int> ret;
+   QVector<uint64_t>   missing;
+
+   for (const uint64_t id : ids) {
+      const auto i = m_hStatus.find(id);
+
+      if (i != m_hStatus.end()) {
+         ret[id] = i.value();
+         m_hStatus.erase(i);
+      }
+      else
+         missing << id;
+   }
+
+   if (missing.isEmpty())
+      return ret;
+
+   ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
+
+#ifdef ENABLE_LIBWRAP
+   for (const uint64_t id : missing)
+      ret[id] = configurationManager.getMessageStatus(id);
+#else //ENABLE_LIBWRAP
+   QVector<QDBusPendingReply<int>> replies;
+   replies.reserve(missing.size());
+
+   for (const uint64_t id : missing)
+      replies << configurationManager.getMessageStatus(id);
+
+   for (int i = 0; i < missing.size(); i++) {
+      replies[i].waitForFinished();
+
+      if (replies[i].isValid())
+         ret[missing[i]] = replies[i].value();
+   }
+#endif //ENABLE_LIBWRAP
+
+   // The changes are then tracked by accountMessageStatusChanged()
+   return ret;
+}
+
+/**
+ * Forward the status to the recording. If the message isn't loaded yet, a
+ * final status is kept until messageStatus() hands it over, the other ones
+ * will be queried again anyway.
+ */
 void IMConversationManagerPrivate::accountMessageStatusChanged(const QString& accountId, uint64_t id, const QString& to, int status)
 {
+    bool applied = false;
+
     if (auto cm = PhoneDirectoryModel::instance().getNumber(to, AccountModel::instance().getById(accountId.toLatin1()))) {
         auto txtRecording = cm->textRecording();
-        txtRecording->d_ptr->accountMessageStatusChanged(id, static_cast<DRing::Account::MessageStates>(status));
+        applied = txtRecording->d_ptr->accountMessageStatusChanged(id, static_cast<DRing::Account::MessageStates>(status));
+    }
+
+    if (applied || !Media::TextRecordingPrivate::isFinalStatus(static_cast<Media::TextRecording::Status>(status)))
+        m_hStatus.remove(id);
+    else
+        cacheStatus(id, status);
+}
+
+/**
+ * Keep the status of a message which isn't loaded. The messages may never
+ * be loaded, so only the MAX_CACHED_STATUS latest ones are kept. The others
+ * are queried from the daemon by messageStatus().
+ */
+void IMConversationManagerPrivate::cacheStatus(uint64_t id, int status)
+{
+    if (!m_hStatus.contains(id))
+        m_lStatusOrder.enqueue(id);
+
+    m_hStatus[id] = status;
+
+    while (m_hStatus.size() > MAX_CACHED_STATUS)
+        m_hStatus.remove(m_lStatusOrder.dequeue());
+
+    // Drop the ids already handed over by messageStatus()
+    if (m_lStatusOrder.size() > 2 * MAX_CACHED_STATUS) {
+        QQueue<uint64_t> order;
+
+        for (const uint64_t i : m_lStatusOrder) {
+            if (m_hStatus.contains(i))
+                order.enqueue(i);
+        }
+
+        m_lStatusOrder.swap(order);
     }
 }
 
@@ -18,6 +18,7 @@
 #include "textrecording.h"
 
 //Qt
+#include <QtCore/QCoreApplication>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonValue>
@@ -25,6 +26,8 @@
 #include <QtCore/QDateTime>
 #include <QtCore/QCryptographicHash>
 #include <QtCore/QUrl>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
 
 //Daemon
 #include <account_const.h>
@@ -37,14 +40,20 @@
 #include "accountmodel.h"
 #include "personmodel.h"
 #include "private/textrecording_p.h"
+#include "private/textjournal.h"
+#include "private/textsearchindex.h"
+#include "private/imconversationmanagerprivate.h"
+#include "private/threadworker.h"
 #include "globalinstances.h"
 #include "interfaces/pixmapmanipulatori.h"
 #include "itemdataroles.h"
 #include "mime.h"
-#include "dbus/configurationmanager.h"
+#include "localtextrecordingcollection.h"
 
 //Std
+#include <algorithm>
 #include <ctime>
+#include <functional>
 
 QHash<QByteArray, Serializable::Peers*> SerializableEntityManager::m_hPeers;
 
@@ -67,6 +76,7 @@ Serializable::Peers* SerializableEntityManager::peer(const ContactMethod* cm)
    if (!p) {
       p = new Serializable::Peers();
       p->sha1s << sha1;
+      p->hasChanged = true;
 
       addPeer(p,cm);
 
@@ -109,6 +119,7 @@ Serializable::Peers* SerializableEntityManager::peers(QList<const ContactMethod*
    if (!p) {
       p = new Serializable::Peers();
       p->sha1s = sha1s;
+      p->hasChanged = true;
       m_hPeers[sha1] = p;
    }
 
@@ -120,9 +131,9 @@ Serializable::Peers* SerializableEntityManager::fromSha1(const QByteArray& sha1)
    return m_hPeers[sha1];
 }
 
-Serializable::Peers* SerializableEntityManager::fromJson(const QJsonObject& json, const ContactMethod* cm)
+///The key of a conversation (or its metadata) in SerializableEntityManager
+static QByteArray peersKey(const QJsonObject& json)
 {
-   //Check if the object is already loaded
    QStringList sha1List;
    QJsonArray as = json["sha1s"].toArray();
    for (int i = 0; i < as.size(); ++i) {
@@ -130,17 +141,30 @@ Serializable::Peers* SerializableEntityManager::fromJson(const QJsonObject& json
    }
 
    if (sha1List.isEmpty())
+      return {};
+
+   if (sha1List.size() > 1)
+      return mashSha1s(sha1List);
+
+   return sha1List[0].toLatin1();
+}
+
+Serializable::Peers* SerializableEntityManager::fromJson(const QJsonObject& json, const ContactMethod* cm)
+{
+   const QByteArray sha1 = peersKey(json);
+
+   if (sha1.isEmpty())
       return nullptr;
 
-   QByteArray sha1 = sha1List[0].toLatin1();
+   //Check if the object is already loaded
+   if (Serializable::Peers* p = m_hPeers[sha1]) {
+      //Only its metadata was read so far
+      if (!p->isLoaded)
+         p->readGroups(json);
 
-   if (sha1List.size() > 1) {
-      sha1 = mashSha1s(sha1List);
+      return p;
    }
 
-   if (m_hPeers[sha1])
-      return m_hPeers[sha1];
-
    //Load from json
    Serializable::Peers* p = new Serializable::Peers();
    p->read(json);
@@ -148,8 +172,29 @@ Serializable::Peers* SerializableEntityManager::fromJson(const QJsonObject& json
 
    //TODO Remove in 2016
    //Some older versions of the file don't store necessary values, fix that
-   if (cm && p->peers.isEmpty())
+   if (cm && p->peers.isEmpty()) {
       addPeer(p,cm);
+      p->hasChanged = true;
+   }
+
+   return p;
+}
+
+///Create the peers of a conversation without reading its messages
+Serializable::Peers* SerializableEntityManager::fromMetadata(const QJsonObject& json)
+{
+   const QByteArray sha1 = peersKey(json);
+
+   if (sha1.isEmpty())
+      return nullptr;
+
+   if (m_hPeers[sha1])
+      return m_hPeers[sha1];
+
+   Serializable::Peers* p = new Serializable::Peers();
+   p->readHeader(json);
+   p->isLoaded = false;
+   m_hPeers[sha1] = p;
 
    return p;
 }
@@ -167,6 +212,15 @@ Media::TextRecording::~TextRecording()
    delete d_ptr;
 }
 
+///If the daemon won't report further changes for this message
+bool Media::TextRecordingPrivate::isFinalStatus(TextRecording::Status status)
+{
+    //READ status is not used yet it'll be the final state when it is
+    return status == Media::TextRecording::Status::READ
+        || status == Media::TextRecording::Status::SENT
+        || status == Media::TextRecording::Status::FAILURE;
+}
+
 /**
  * Updates the message status and potentially the message id, if a new status is set.
  * Returns true if the Message object was modified, false otherwise.
@@ -179,10 +233,7 @@ bool Media::TextRecordingPrivate::updateMessageStatus(Serializable::Message* m,
         qWarning() << "Unknown message status with code: " << static_cast<int>(newSatus);
         newSatus = TextRecording::Status::UNKNOWN;
     } else {
-        //READ status is not used yet it'll be the final state when it is
-        if (newSatus == TextRecording::Status::READ
-                || newSatus == TextRecording::Status::SENT
-                || newSatus == TextRecording::Status::FAILURE) {
+        if (isFinalStatus(newSatus)) {
             m_hPendingMessages.remove(m->id);
             if (m->id != 0) {
                 m->id = 0;
@@ -195,10 +246,15 @@ bool Media::TextRecordingPrivate::updateMessageStatus(Serializable::Message* m,
         m->deliveryStatus = newSatus;
         modified = true;
     }
+
+    if (modified)
+        Serializable::Peers::messageChanged(m);
+
     return modified;
 }
 
-void Media::TextRecordingPrivate::accountMessageStatusChanged(const uint64_t id, DRing::Account::MessageStates status)
+///Return false if the message isn't loaded, the status is then not applied
+bool Media::TextRecordingPrivate::accountMessageStatusChanged(const uint64_t id, DRing::Account::MessageStates status)
 {
     if (auto node = m_hPendingMessages.value(id, nullptr)) {
         if (updateMessageStatus(node->m_pMessage, static_cast<TextRecording::Status>(status))) {
@@ -208,7 +264,11 @@ void Media::TextRecordingPrivate::accountMessageStatusChanged(const uint64_t id,
             auto msg_index = m_pImModel->index(node->m_row, 0);
             m_pImModel->dataChanged(msg_index, msg_index);
         }
+
+        return true;
     }
+
+    return false;
 }
 
 bool Media::TextRecording::hasMimeType(const QString& mimeType) const
@@ -226,6 +286,7 @@ QAbstractItemModel* Media::TextRecording::instantMessagingModel() const
 {
    if (!d_ptr->m_pImModel) {
       d_ptr->m_pImModel = new InstantMessagingModel(const_cast<TextRecording*>(this));
+      d_ptr->loadFirstPage();
    }
 
    return d_ptr->m_pImModel;
@@ -234,10 +295,24 @@ QAbstractItemModel* Media::TextRecording::instantMessagingModel() const
 ///Set all messages as read and then save the recording
 void Media::TextRecording::setAllRead()
 {
+    //Nothing to do, don't read the messages from the disk
+    if (d_ptr->m_IsPartial && !d_ptr->m_UnreadCount)
+        return;
+
+    d_ptr->materialize();
+
     bool changed = false;
+    for (Serializable::Message* m : d_ptr->m_lOlder) {
+        if (!m->isRead) {
+            m->isRead = true;
+            Serializable::Peers::messageChanged(m);
+            changed = true;
+        }
+    }
     for(int row = 0; row < d_ptr->m_lNodes.size(); ++row) {
         if (!d_ptr->m_lNodes[row]->m_pMessage->isRead) {
             d_ptr->m_lNodes[row]->m_pMessage->isRead = true;
+            Serializable::Peers::messageChanged(d_ptr->m_lNodes[row]->m_pMessage);
             if (d_ptr->m_pImModel) {
                 auto idx = d_ptr->m_pImModel->index(row, 0);
                 emit d_ptr->m_pImModel->dataChanged(idx,idx);
@@ -251,8 +326,10 @@ void Media::TextRecording::setAllRead()
         int oldVal = d_ptr->m_UnreadCount;
         d_ptr->m_UnreadCount = 0;
         emit unreadCountChange(-oldVal);
-        emit d_ptr->m_lNodes[0]->m_pContactMethod->unreadTextMessageCountChanged();
-        emit d_ptr->m_lNodes[0]->m_pContactMethod->changed();
+        for (ContactMethod* cm : peers()) {
+            emit cm->unreadTextMessageCountChanged();
+            emit cm->changed();
+        }
         save();
     }
 }
@@ -346,27 +423,52 @@ bool Media::TextRecording::isEmpty() const
    return !size();
 }
 
+///The number of messages, including those not loaded in the model yet
 int Media::TextRecording::size() const
 {
-    return d_ptr->m_lNodes.size();
+    return d_ptr->m_lNodes.size() + d_ptr->m_lOlder.size() + d_ptr->m_UnloadedCount;
+}
+
+///The number of unread text messages, including those not loaded yet
+int Media::TextRecording::unreadCount() const
+{
+    return d_ptr->m_UnreadCount;
 }
 
 // Qt convention compat
 int Media::TextRecording::count() const { return size(); }
 
+///Full snapshots of the conversations which can't be saved using the journal
 QHash<QByteArray,QByteArray> Media::TextRecordingPrivate::toJsons() const
 {
    QHash<QByteArray,QByteArray> ret;
    for (Serializable::Peers* p : m_lAssociatedPeers) {
-//       if (p->hasChanged) {
+      //Without its messages, the snapshot would erase the conversation
+      if (p->hasChanged && p->isLoaded) {
          p->hasChanged = false;
+         p->m_lJournal.clear();
 
          QJsonObject output;
          p->write(output);
 
          QJsonDocument doc(output);
          ret[p->sha1s[0].toLatin1()] = doc.toJson();
-//       }
+      }
+   }
+
+   return ret;
+}
+
+///The journal records added since the last save
+QHash<QByteArray,QList<QByteArray>> Media::TextRecordingPrivate::takeJournals() const
+{
+   QHash<QByteArray,QList<QByteArray>> ret;
+
+   for (Serializable::Peers* p : m_lAssociatedPeers) {
+      if (!p->m_lJournal.isEmpty()) {
+         ret[p->sha1s[0].toLatin1()] = p->m_lJournal;
+         p->m_lJournal.clear();
+      }
    }
 
    return ret;
@@ -378,21 +480,92 @@ Media::TextRecording* Media::TextRecording::fromJson(const QList<QJsonObject>& i
     if (backend)
         t->setCollection(backend);
 
-    ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
-
     //Load the history data
     for (const QJsonObject& obj : items) {
-        Serializable::Peers* p = SerializableEntityManager::fromJson(obj,cm);
-        t->d_ptr->m_lAssociatedPeers << p;
+        if (Serializable::Peers* p = SerializableEntityManager::fromJson(obj,cm))
+            t->d_ptr->m_lAssociatedPeers << p;
     }
 
-    //Create the model
-    bool statusChanged = false; // if a msg status changed during parsing, we need to re-save the model
-    t->instantMessagingModel();
-
     //Reconstruct the conversation
+    t->d_ptr->queueMessages(cm);
+
+    //When loading by pages, the messages are added once the model is used
+    if (!LocalTextRecordingCollection::pageSize())
+        t->instantMessagingModel();
+
+    return t;
+}
+
+/**
+ * Create a recording from the metadata of a conversation (see
+ * Serializable::Peers::writeMetadata()). The messages are read from the
+ * collection once they are needed.
+ */
+Media::TextRecording* Media::TextRecording::fromMetadata(const QJsonObject& metadata, CollectionInterface* backend)
+{
+    TextRecording* t = new TextRecording();
+    if (backend)
+        t->setCollection(backend);
+
+    Serializable::Peers* p = SerializableEntityManager::fromMetadata(metadata);
+
+    if (!p)
+        return t;
+
+    t->d_ptr->m_lAssociatedPeers << p;
+    t->d_ptr->m_IsPartial     = true;
+    t->d_ptr->m_UnreadCount   = metadata["unreadCount" ].toInt();
+    t->d_ptr->m_UnloadedCount = metadata["messageCount"].toInt();
+
+    // update the timestamp of the CM
+    if (!p->peers.isEmpty())
+        p->peers.at(0)->m_pContactMethod->setLastUsed(metadata["lastTimestamp"].toInt());
+
+    return t;
+}
+
+/**
+ * Read the messages of the conversations only known by their metadata.
+ *
+ * The whole conversation is parsed the first time, the snapshot has no
+ * page offsets to seek to. Only the creation of the model nodes is paged.
+ */
+void Media::TextRecordingPrivate::materialize()
+{
+    if (!m_IsPartial)
+        return;
+
+    m_IsPartial     = false;
+    m_UnloadedCount = 0;
+
+    auto collection = dynamic_cast<LocalTextRecordingCollection*>(q_ptr->collection());
+
+    for (Serializable::Peers* p : m_lAssociatedPeers) {
+        if (p->isLoaded || !collection)
+            continue;
+
+        bool ok = false;
+        const QJsonObject json = collection->fetchConversation(p->sha1s[0].toLatin1(), &ok);
+
+        if (ok)
+            p->readGroups(json);
+        else
+            qWarning() << "Text recording file is empty or invalid" << p->sha1s[0];
+    }
+
+    queueMessages(nullptr);
+}
+
+/**
+ * Flatten the conversation graph into the queue of messages not in the model
+ * yet, they are then added to it by loadOlder().
+ */
+void Media::TextRecordingPrivate::queueMessages(const ContactMethod* cm)
+{
+    int unread = 0;
+
     //TODO do it right, right now it flatten the graph
-    for (const Serializable::Peers* p : t->d_ptr->m_lAssociatedPeers) {
+    for (const Serializable::Peers* p : m_lAssociatedPeers) {
         //Seems old version didn't store that
         if (p->peers.isEmpty())
             continue;
@@ -403,53 +576,218 @@ Media::TextRecording* Media::TextRecording::fromJson(const QList<QJsonObject>& i
         time_t lastUsed = 0;
         for (const Serializable::Group* g : p->groups) {
             for (Serializable::Message* m : g->messages) {
-                ::TextMessageNode* n  = new ::TextMessageNode();
-                n->m_pMessage         = m                      ;
-                if (!n->m_pMessage->contactMethod) {
+                if (!m->contactMethod) {
                     if (cm) {
-                        n->m_pMessage->contactMethod = const_cast<ContactMethod*>(cm); //TODO remove in 2016
-                        n->m_pMessage->authorSha1 = cm->sha1();
+                        m->contactMethod = const_cast<ContactMethod*>(cm); //TODO remove in 2016
+                        m->authorSha1 = cm->sha1();
 
                         if (p->peers.isEmpty())
                             addPeer(const_cast<Serializable::Peers*>(p), cm);
                     } else {
-                        if (p->m_hSha1.contains(n->m_pMessage->authorSha1)) {
-                            n->m_pMessage->contactMethod = p->m_hSha1[n->m_pMessage->authorSha1];
+                        if (p->m_hSha1.contains(m->authorSha1)) {
+                            m->contactMethod = p->m_hSha1[m->authorSha1];
                         } else {
                             // message was outgoing and author sha1 was set to that of the sending account
-                            n->m_pMessage->contactMethod = peerCM;
-                            n->m_pMessage->authorSha1 = peerCM->sha1();
+                            m->contactMethod = peerCM;
+                            m->authorSha1 = peerCM->sha1();
                         }
                     }
                 }
-                n->m_pContactMethod   = m->contactMethod;
-                t->d_ptr->m_pImModel->addRowBegin();
-                t->d_ptr->m_lNodes << n;
-                t->d_ptr->m_pImModel->addRowEnd();
-
-                if (lastUsed < n->m_pMessage->timestamp)
-                    lastUsed = n->m_pMessage->timestamp;
-                if (m->id) {
-                    int status = configurationManager.getMessageStatus(m->id);
-                    t->d_ptr->m_hPendingMessages[m->id] = n;
-                    if (t->d_ptr->updateMessageStatus(m, static_cast<TextRecording::Status>(status)))
-                        statusChanged = true;
-                }
+                m_lOlder << m;
+
+                if (lastUsed < m->timestamp)
+                    lastUsed = m->timestamp;
+                if (m->m_HasText && !m->isRead)
+                    ++unread;
             }
         }
 
-        if (statusChanged)
-            t->save();
-
         // update the timestamp of the CM
         peerCM->setLastUsed(lastUsed);
     }
 
-    return t;
+    if (unread != m_UnreadCount) {
+        const int diff = unread - m_UnreadCount;
+        m_UnreadCount = unread;
+        emit q_ptr->unreadCountChange(diff);
+    }
+}
+
+/**
+ * Add the newest page of messages to the model, or all of them when not
+ * loading by pages. The unread messages are always part of it, otherwise they
+ * would be missing from unreadInstantTextMessagingModel().
+ */
+void Media::TextRecordingPrivate::loadFirstPage()
+{
+    materialize();
+
+    const int pageSize = LocalTextRecordingCollection::pageSize();
+    int count = pageSize;
+
+    if (pageSize > 0) {
+        for (int i = 0; i < m_lOlder.size() - count; ++i) {
+            if (m_lOlder[i]->m_HasText && !m_lOlder[i]->isRead) {
+                count = m_lOlder.size() - i;
+                break;
+            }
+        }
+    }
+
+    loadOlder(count);
+}
+
+/**
+ * Add the "count" newest queued messages at the top of the model (all of them
+ * if "count" is 0). Return the number of messages added.
+ */
+int Media::TextRecordingPrivate::loadOlder(int count)
+{
+    const int n = count > 0 ? qMin(count, m_lOlder.size()) : m_lOlder.size();
+
+    if (!n)
+        return 0;
+
+    bool statusChanged = false; // if a msg status changed during loading, we need to re-save the model
+
+    QVector<::TextMessageNode*> nodes;
+    nodes.reserve(n + m_lNodes.size());
+
+    QVector<uint64_t> pending;
+
+    for (int i = m_lOlder.size() - n; i < m_lOlder.size(); ++i) {
+        Serializable::Message* m = m_lOlder[i];
+
+        ::TextMessageNode* node = new ::TextMessageNode();
+        node->m_pMessage        = m                ;
+        node->m_pContactMethod  = m->contactMethod ;
+        nodes << node;
+
+        if (m->id) {
+            m_hPendingMessages[m->id] = node;
+
+            // It was saved before the id was cleared, no need to ask the daemon
+            if (isFinalStatus(m->deliveryStatus)) {
+                if (updateMessageStatus(m, m->deliveryStatus))
+                    statusChanged = true;
+            }
+            else
+                pending << m->id;
+        }
+    }
+
+    m_lOlder.resize(m_lOlder.size() - n);
+
+    const QHash<uint64_t,int> statuses = IMConversationManagerPrivate::instance().messageStatus(pending);
+
+    for (auto i = statuses.constBegin(); i != statuses.constEnd(); ++i) {
+        if (::TextMessageNode* node = m_hPendingMessages.value(i.key())) {
+            if (updateMessageStatus(node->m_pMessage, static_cast<TextRecording::Status>(i.value())))
+                statusChanged = true;
+        }
+    }
+
+    m_pImModel->prependRowsBegin(n);
+
+    nodes += m_lNodes;
+    m_lNodes = nodes;
+
+    for (int row = 0; row < m_lNodes.size(); ++row)
+        m_lNodes[row]->m_row = row;
+
+    m_pImModel->prependRowsEnd();
+
+    if (statusChanged)
+        q_ptr->save();
+
+    QVector<Serializable::Message*> messages;
+    messages.reserve(n);
+    for (int row = 0; row < n; ++row)
+        messages << m_lNodes[row]->m_pMessage;
+
+    detectLinks(messages);
+
+    return n;
+}
+
+/**
+ * Find the links of "messages" on a worker thread. They are then saved with
+ * the messages so it is only done once.
+ */
+void Media::TextRecordingPrivate::detectLinks(const QVector<Serializable::Message*>& messages)
+{
+    QVector<Serializable::Message*> pending;
+    QVector<QString>                texts  ;
+
+    for (Serializable::Message* m : messages) {
+        if (!(m->m_LinksDetected || m->m_PlainText.isEmpty())) {
+            pending << m;
+            texts   << m->m_PlainText;
+        }
+    }
+
+    if (pending.isEmpty())
+        return;
+
+    const int                             generation = m_LinkGeneration;
+    const QPointer<Media::TextRecording>  recording  = q_ptr;
+
+    new ThreadWorker([pending, texts, generation, recording]() {
+        // A QRegularExpression can't be shared between threads
+        const QRegularExpression re(
+            Serializable::Message::m_linkRegex.pattern(),
+            Serializable::Message::m_linkRegex.patternOptions()
+        );
+
+        QVector<QVector<Serializable::Message::LinkSpan>> spans;
+        spans.reserve(texts.size());
+
+        for (const QString& text : texts)
+            spans << Serializable::Message::findLinks(text, re);
+
+        // The recording may be deleted at any time, it can only be checked
+        // from the GUI thread. The application object outlives the workers.
+        QTimer::singleShot(0, QCoreApplication::instance(), [pending, spans, generation, recording]() {
+            if (recording)
+                recording->d_ptr->applyLinks(pending, spans, generation);
+        });
+    });
+}
+
+void Media::TextRecordingPrivate::applyLinks(const QVector<Serializable::Message*>& messages,
+    const QVector<QVector<Serializable::Message::LinkSpan>>& spans, int generation)
+{
+    // The messages were deleted meanwhile
+    if (generation != m_LinkGeneration)
+        return;
+
+    for (int i = 0; i < messages.size(); ++i) {
+        Serializable::Message* m = messages[i];
+
+        // They were needed before the worker was done
+        if (m->m_LinksDetected)
+            continue;
+
+        m->m_lLinkSpans    = spans[i];
+        m->m_LinksDetected = true;
+        Serializable::Peers::linksDetected(m);
+    }
+
+    q_ptr->save();
+
+    if (m_pImModel && !m_lNodes.isEmpty()) {
+        emit m_pImModel->dataChanged(m_pImModel->index(0, 0), m_pImModel->index(m_lNodes.size() - 1, 0), {
+            static_cast<int>(TextRecording::Role::LinkSpans),
+            static_cast<int>(TextRecording::Role::LinkList ),
+        });
+    }
 }
 
 void Media::TextRecordingPrivate::insertNewMessage(const QMap<QString,QString>& message, ContactMethod* cm, Media::Media::Direction direction, uint64_t id)
 {
+    //Make sure the model exist, the new group must come after the ones on the disk
+    q_ptr->instantMessagingModel();
+
     //Only create it if none was found on the disk
     if (!m_pCurrentGroup) {
         m_pCurrentGroup = new Serializable::Group();
@@ -461,7 +799,7 @@ void Media::TextRecordingPrivate::insertNewMessage(const QMap<QString,QString>&
         if (m_lAssociatedPeers.indexOf(p) == -1) {
             m_lAssociatedPeers << p;
         }
-        p->groups << m_pCurrentGroup;
+        p->addGroup(m_pCurrentGroup);
    }
 
    //Create the message
@@ -513,10 +851,7 @@ void Media::TextRecordingPrivate::insertNewMessage(const QMap<QString,QString>&
             m_lMimeTypes << strippedMimeType;
       }
    }
-   m_pCurrentGroup->messages << m;
-
-   //Make sure the model exist
-   q_ptr->instantMessagingModel();
+   m_pCurrentGroup->m_pPeers->addMessage(m_pCurrentGroup, m);
 
    //Update the reconstructed conversation
    ::TextMessageNode* n  = new ::TextMessageNode()       ;
@@ -530,12 +865,20 @@ void Media::TextRecordingPrivate::insertNewMessage(const QMap<QString,QString>&
    if (m->id > 0)
        m_hPendingMessages[id] = n;
 
+   detectLinks({m});
+
    //Save the conversation
    q_ptr->save();
 
+   if (m->m_HasText)
+      TextSearchIndex::instance().addMessage(
+         m_pCurrentGroup->m_pPeers->sha1s.first().toLatin1(), m_pCurrentGroup->m_Index,
+         m->m_Index, m->timestamp, m->m_PlainText
+      );
+
    cm->setLastUsed(currentTime);
    emit q_ptr->messageInserted(message, const_cast<ContactMethod*>(cm), direction);
-   if (!m->isRead) {
+   if (m->m_HasText && !m->isRead) {
       m_UnreadCount += 1;
       emit q_ptr->unreadCountChange(1);
       emit cm->unreadTextMessageCountChanged();
@@ -591,6 +934,24 @@ void Serializable::Message::read (const QJsonObject &json)
       m_PlainText = p->payload;
       m_HasText   = true;
    }
+
+   if (json.contains("links")) {
+      const QJsonArray links = json["links"].toArray();
+      for (const QJsonValue& v : links) {
+         const QJsonArray span = v.toArray();
+         m_lLinkSpans << LinkSpan { span[0].toInt(), span[1].toInt() };
+      }
+      m_LinksDetected = true;
+   }
+}
+
+static QJsonArray linksToJson(const QVector<Serializable::Message::LinkSpan>& spans)
+{
+   QJsonArray a;
+   for (const Serializable::Message::LinkSpan& span : spans)
+      a.append(QJsonArray { span.start, span.length });
+
+   return a;
 }
 
 void Serializable::Message::write(QJsonObject &json) const
@@ -610,32 +971,73 @@ void Serializable::Message::write(QJsonObject &json) const
       a.append(o);
    }
    json["payloads"] = a;
+
+   if (m_LinksDetected)
+      json["links"] = linksToJson(m_lLinkSpans);
 }
 
 const QRegularExpression Serializable::Message::m_linkRegex = QRegularExpression(QStringLiteral("((?>(?>https|http|ftp|ring):|www\\.)(?>[^\\s,.);!>]|[,.);!>](?!\\s|$))+)"),
                                                                                  QRegularExpression::CaseInsensitiveOption);
 
+///Find the links in "text", this is thread safe as long as "re" isn't shared
+QVector<Serializable::Message::LinkSpan> Serializable::Message::findLinks(const QString& text, const QRegularExpression& re)
+{
+    QVector<LinkSpan> spans;
+
+    auto it = re.globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        spans << LinkSpan { match.capturedStart(), match.capturedLength() };
+    }
+
+    return spans;
+}
+
+/**
+ * Detect the links right away if it wasn't done in the background yet (see
+ * Media::TextRecordingPrivate::detectLinks()).
+ */
+void Serializable::Message::detectLinks()
+{
+    if (m_LinksDetected)
+        return;
+
+    m_lLinkSpans    = findLinks(m_PlainText, m_linkRegex);
+    m_LinksDetected = true;
+    Serializable::Peers::linksDetected(this);
+}
+
+const QList<QUrl>& Serializable::Message::linkList()
+{
+    detectLinks();
+
+    if (m_LinkList.size() != m_lLinkSpans.size()) {
+        m_LinkList.clear();
+        for (const LinkSpan& span : m_lLinkSpans)
+            m_LinkList << QUrl::fromUserInput(m_PlainText.mid(span.start, span.length));
+    }
+
+    return m_LinkList;
+}
+
 const QString& Serializable::Message::getFormattedHtml()
 {
     if (m_FormattedHtml.isEmpty())
     {
+        const QList<QUrl>& urls = linkList();
+
         QString re;
         auto p = 0;
-        auto it = m_linkRegex.globalMatch(m_PlainText);
-        while (it.hasNext()) {
-            QRegularExpressionMatch match = it.next();
-            auto start = match.capturedStart();
-
-            auto url = QUrl::fromUserInput(match.capturedRef().toString());
+        for (int i = 0; i < m_lLinkSpans.size(); ++i) {
+            const LinkSpan& span = m_lLinkSpans[i];
 
-            if (start > p)
-                re.append(m_PlainText.mid(p, start - p).toHtmlEscaped().replace(QLatin1Char('\n'),
-                                                                                QStringLiteral("<br/>")));
+            if (span.start > p)
+                re.append(m_PlainText.mid(p, span.start - p).toHtmlEscaped().replace(QLatin1Char('\n'),
+                                                                                     QStringLiteral("<br/>")));
             re.append(QStringLiteral("<a href=\"%1\">%2</a>")
-                      .arg(QString::fromLatin1(url.toEncoded()).toHtmlEscaped(),
-                           match.capturedRef().toString().toHtmlEscaped()));
-            m_LinkList.append(url);
-            p = match.capturedEnd();
+                      .arg(QString::fromLatin1(urls[i].toEncoded()).toHtmlEscaped(),
+                           m_PlainText.mid(span.start, span.length).toHtmlEscaped()));
+            p = span.start + span.length;
         }
         if (p < m_PlainText.size())
             re.append(m_PlainText.mid(p, m_PlainText.size() - p).toHtmlEscaped());
@@ -657,6 +1059,8 @@ void Serializable::Group::read (const QJsonObject &json, const QHash<QString,Con
       Message* message = new Message();
       message->contactMethod = sha1s[message->authorSha1];
       message->read(o);
+      message->m_pGroup = this;
+      message->m_Index  = messages.size();
       messages.append(message);
    }
 }
@@ -700,7 +1104,13 @@ void Serializable::Peer::write(QJsonObject &json) const
 
 void Serializable::Peers::read (const QJsonObject &json)
 {
+   readHeader(json);
+   readGroups(json);
+}
 
+///Read the participants, but not the messages
+void Serializable::Peers::readHeader(const QJsonObject &json)
+{
    QJsonArray as = json["sha1s"].toArray();
    for (int i = 0; i < as.size(); ++i) {
       sha1s.append(as[i].toString());
@@ -714,23 +1124,26 @@ void Serializable::Peers::read (const QJsonObject &json)
       m_hSha1[peer->sha1] = peer->m_pContactMethod;
       peers.append(peer);
    }
+}
+
+void Serializable::Peers::readGroups(const QJsonObject &json)
+{
+   isLoaded = true;
 
    QJsonArray a = json["groups"].toArray();
    for (int i = 0; i < a.size(); ++i) {
       QJsonObject o = a[i].toObject();
       Group* group = new Group();
       group->read(o,m_hSha1);
+      group->m_pPeers = this;
+      group->m_Index  = groups.size();
       groups.append(group);
    }
 }
 
 void Serializable::Peers::write(QJsonObject &json) const
 {
-   QJsonArray a2;
-   for (const QString& sha1 : sha1s) {
-      a2.append(sha1);
-   }
-   json["sha1s"] = a2;
+   writeHeader(json);
 
    QJsonArray a;
    for (const Group* g : groups) {
@@ -739,6 +1152,15 @@ void Serializable::Peers::write(QJsonObject &json) const
       a.append(o);
    }
    json["groups"] = a;
+}
+
+void Serializable::Peers::writeHeader(QJsonObject &json) const
+{
+   QJsonArray a2;
+   for (const QString& sha1 : sha1s) {
+      a2.append(sha1);
+   }
+   json["sha1s"] = a2;
 
    QJsonArray a3;
    for (const Peer* p : peers) {
@@ -749,6 +1171,98 @@ void Serializable::Peers::write(QJsonObject &json) const
    json["peers"] = a3;
 }
 
+/**
+ * What is needed to list a conversation without reading its messages, see
+ * TextRecording::fromMetadata().
+ */
+void Serializable::Peers::writeMetadata(QJsonObject &json) const
+{
+   writeHeader(json);
+
+   int    count    = 0;
+   int    unread   = 0;
+   time_t lastUsed = 0;
+
+   for (const Group* g : groups) {
+      for (const Message* m : g->messages) {
+         count++;
+
+         if (m->m_HasText && !m->isRead)
+            unread++;
+
+         lastUsed = std::max(lastUsed, m->timestamp);
+      }
+   }
+
+   json["messageCount" ] = count                     ;
+   json["unreadCount"  ] = unread                    ;
+   json["lastTimestamp"] = static_cast<int>(lastUsed);
+}
+
+///Append a new group, it is journaled unless a full snapshot is needed
+void Serializable::Peers::addGroup(Group* group)
+{
+   group->m_pPeers = this;
+   group->m_Index  = groups.size();
+   groups << group;
+
+   if (!hasChanged) {
+      QJsonObject o;
+      group->write(o);
+      m_lJournal << TextJournal::groupRecord(group->m_Index, o);
+   }
+}
+
+void Serializable::Peers::addMessage(Group* group, Message* message)
+{
+   message->m_pGroup = group;
+   message->m_Index  = group->messages.size();
+   group->messages << message;
+
+   if (!hasChanged) {
+      QJsonObject o;
+      message->write(o);
+      m_lJournal << TextJournal::messageRecord(group->m_Index, message->m_Index, o);
+   }
+}
+
+///Journal the fields of a message which can change once it is sent
+void Serializable::Peers::messageChanged(const Message* message)
+{
+   // Not part of a saved conversation yet
+   if (!(message->m_pGroup && message->m_pGroup->m_pPeers))
+      return;
+
+   Peers* p = message->m_pGroup->m_pPeers;
+
+   if (p->hasChanged)
+      return;
+
+   QJsonObject o;
+   o["isRead"        ] = message->isRead                           ;
+   o["id"            ] = QString::number(message->id)              ;
+   o["deliveryStatus"] = static_cast<int>(message->deliveryStatus);
+
+   p->m_lJournal << TextJournal::updateRecord(message->m_pGroup->m_Index, message->m_Index, o);
+}
+
+///Journal the links once they are detected, so it is never done twice
+void Serializable::Peers::linksDetected(const Message* message)
+{
+   if (!(message->m_pGroup && message->m_pGroup->m_pPeers))
+      return;
+
+   Peers* p = message->m_pGroup->m_pPeers;
+
+   if (p->hasChanged)
+      return;
+
+   QJsonObject o;
+   o["links"] = linksToJson(message->m_lLinkSpans);
+
+   p->m_lJournal << TextJournal::updateRecord(message->m_pGroup->m_Index, message->m_Index, o);
+}
+
 
 ///Constructor
 InstantMessagingModel::InstantMessagingModel(Media::TextRecording* recording) : QAbstractListModel(recording),m_pRecording(recording)
@@ -778,6 +1292,7 @@ QHash<int,QByteArray> InstantMessagingModel::roleNames() const
       roles.insert((int)Media::TextRecording::Role::FormattedHtml       , "formattedHtml"       );
       roles.insert((int)Media::TextRecording::Role::LinkList            , "linkList"            );
       roles.insert((int)Media::TextRecording::Role::Id                  , "id"                  );
+      roles.insert((int)Media::TextRecording::Role::LinkSpans           , "linkSpans"           );
    }
    return roles;
 }
@@ -843,9 +1358,20 @@ QVariant InstantMessagingModel::data( const QModelIndex& idx, int role) const
          case (int)Media::TextRecording::Role::FormattedHtml        :
             return QVariant::fromValue(n->m_pMessage->getFormattedHtml());
          case (int)Media::TextRecording::Role::LinkList             :
-            return QVariant::fromValue(n->m_pMessage->m_LinkList);
+            return QVariant::fromValue(n->m_pMessage->linkList());
          case (int)Media::TextRecording::Role::Id                   :
             return QVariant::fromValue(n->m_pMessage->id);
+         case (int)Media::TextRecording::Role::LinkSpans            : {
+            // Empty until they are detected, dataChanged() is then emitted
+            QVariantList spans;
+            for (const Serializable::Message::LinkSpan& span : n->m_pMessage->m_lLinkSpans) {
+               spans << QVariantMap {
+                  { QStringLiteral("start" ), span.start  },
+                  { QStringLiteral("length"), span.length },
+               };
+            }
+            return spans;
+         }
          default:
             break;
       }
@@ -881,6 +1407,7 @@ bool InstantMessagingModel::setData(const QModelIndex& idx, const QVariant &valu
         case (int)Media::TextRecording::Role::IsRead               :
             if (n->m_pMessage->isRead != value.toBool()) {
                 n->m_pMessage->isRead = value.toBool();
+                Serializable::Peers::messageChanged(n->m_pMessage);
                 if (n->m_pMessage->m_HasText) {
                     int val = value.toBool() ? -1 : +1;
                     m_pRecording->d_ptr->m_UnreadCount += val;
@@ -913,9 +1440,34 @@ void InstantMessagingModel::addRowEnd()
    endInsertRows();
 }
 
+void InstantMessagingModel::prependRowsBegin(int count)
+{
+   beginInsertRows(QModelIndex(), 0, count - 1);
+}
+
+void InstantMessagingModel::prependRowsEnd()
+{
+   endInsertRows();
+}
+
+///The older messages are loaded by pages, see LocalTextRecordingCollection::setPageSize()
+bool InstantMessagingModel::canFetchMore(const QModelIndex& parentIdx) const
+{
+   return (!parentIdx.isValid()) && !m_pRecording->d_ptr->m_lOlder.isEmpty();
+}
+
+void InstantMessagingModel::fetchMore(const QModelIndex& parentIdx)
+{
+   if (!parentIdx.isValid())
+      m_pRecording->d_ptr->loadOlder(LocalTextRecordingCollection::pageSize());
+}
+
 void Media::TextRecordingPrivate::clear()
 {
-    m_pImModel->clear();
+    if (m_pImModel)
+        m_pImModel->clear();
+    else
+        clearMessages();
 
     if (m_UnreadCount != 0) {
         m_UnreadCount = 0;
@@ -923,31 +1475,47 @@ void Media::TextRecordingPrivate::clear()
     }
 }
 
-void InstantMessagingModel::clear()
+void Media::TextRecordingPrivate::clearMessages()
 {
-    beginResetModel();
-
-    for ( TextMessageNode *node : m_pRecording->d_ptr->m_lNodes) {
+    for ( TextMessageNode *node : m_lNodes) {
         for (Serializable::Payload *payload : node->m_pMessage->payloads) {
             delete payload;
         }
         delete node->m_pMessage;
         delete node;
     }
-    m_pRecording->d_ptr->m_lNodes.clear();
+    m_lNodes.clear();
 
-    for (Serializable::Peers *peers : m_pRecording->d_ptr->m_lAssociatedPeers) {
+    for (Serializable::Message *message : m_lOlder) {
+        for (Serializable::Payload *payload : message->payloads) {
+            delete payload;
+        }
+        delete message;
+    }
+    m_lOlder.clear();
+    m_hPendingMessages.clear();
+
+    m_IsPartial     = false;
+    m_UnloadedCount = 0;
+    m_LinkGeneration++;
+
+    for (Serializable::Peers *peers : m_lAssociatedPeers) {
         for (Serializable::Group *group : peers->groups) {
             group->messages.clear();
         }
     }
-    m_pRecording->d_ptr->m_lAssociatedPeers.clear();
+    m_lAssociatedPeers.clear();
 
     //TODO: holly memory leaks batman! what else do we need to delete?
 
-    m_pRecording->d_ptr->m_pCurrentGroup = nullptr;
-    m_pRecording->d_ptr->m_hMimeTypes.clear();
-    m_pRecording->d_ptr->m_lMimeTypes.clear();
+    m_pCurrentGroup = nullptr;
+    m_hMimeTypes.clear();
+    m_lMimeTypes.clear();
+}
 
+void InstantMessagingModel::clear()
+{
+    beginResetModel();
+    m_pRecording->d_ptr->clearMessages();
     endResetModel();
 }
@@ -46,6 +46,7 @@ class LIB_EXPORT TextRecording : public Recording
    friend class ::LocalTextRecordingEditor;
    friend class Text;
    friend class ::ContactMethod;
+   friend class TextRecordingPrivate;
 
 public:
 
@@ -65,6 +66,7 @@ public:
       FormattedHtml        ,
       LinkList             ,
       Id                   ,
+      LinkSpans            ,
    };
 
     ///Possible messages states
@@ -83,6 +85,7 @@ public:
    explicit TextRecording();
    virtual ~TextRecording();
    static TextRecording* fromJson(const QList<QJsonObject>& items, const ContactMethod* cm = nullptr, CollectionInterface* backend = nullptr);
+   static TextRecording* fromMetadata(const QJsonObject& metadata, CollectionInterface* backend = nullptr);
 
    //Getter
    QAbstractItemModel* instantMessagingModel    (                         ) const;
@@ -91,6 +94,7 @@ public:
    bool                isEmpty                  (                         ) const;
    int                 count                    (                         ) const;
    int                 size                     (                         ) const;
+   int                 unreadCount              (                         ) const;
    bool                hasMimeType              ( const QString& mimeType ) const;
    QStringList         mimeTypes                (                         ) const;
    QVector<ContactMethod*> peers                (                         ) const;
@@ -20,9 +20,14 @@
 //Qt
 #include <QtCore/QCoreApplication>
 #include <QtCore/QItemSelectionModel>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 
-//System
-#include <cmath>
+//libSTDC++
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 //DRing
 #include <account_const.h>
@@ -41,6 +46,85 @@
 //Private
 #include "private/phonedirectorymodel_p.h"
 
+///A completion candidate and its weight
+struct RankedNumber {
+   uint           weight;
+   ContactMethod* number;
+};
+
+/**
+ * Keep the "max" heaviest candidates using a bounded min-heap.
+ *
+ * Adding a candidate is O(log max) and nothing is allocated once the heap
+ * is full. A max of 0 keeps every candidate.
+ */
+class RankedNumbers final
+{
+public:
+   explicit RankedNumbers(int max);
+
+   void add(uint weight, ContactMethod* number);
+
+   ///Return the candidates, heaviest first
+   QVector<RankedNumber> take();
+
+private:
+   static bool heavier(const RankedNumber& a, const RankedNumber& b);
+
+   const int                 m_Max  ;
+   std::vector<RankedNumber> m_lHeap;
+};
+
+/**
+ * Look up the directory prefix indices away from the GUI thread.
+ *
+ * The queries are made against snapshots of the indices, the directory can
+ * keep being updated meanwhile. Only the latest query is kept, a query
+ * replaced before it started is never executed and the results of a query
+ * replaced while it was running are not published.
+ *
+ * The worker only collects the matching wrappers, reading the contact
+ * methods they hold and weighting them is left to the GUI thread.
+ */
+class CompletionSearchThread final : public QThread
+{
+   Q_OBJECT
+public:
+   struct Query {
+      uint                        generation;
+      QString                     prefix    ; /*!< Lower case */
+      PrefixIndex<NumberWrapper*> names     ;
+      PrefixIndex<NumberWrapper*> numbers   ;
+   };
+
+   struct Result {
+      uint                   generation;
+      QVector<NumberWrapper*> wrappers ;
+   };
+
+   explicit CompletionSearchThread(QObject* parent);
+
+   void post(Query&& query);
+   bool takeResult(Result& result);
+   void stop();
+
+protected:
+   virtual void run() override;
+
+private:
+   QMutex           m_Mutex     ;
+   QWaitCondition   m_Condition ;
+   Query            m_Pending   ;
+   bool             m_HasPending;
+   bool             m_HasResult ;
+   bool             m_Stopping  ;
+   Result           m_Result    ;
+   std::atomic_uint m_Latest    ;
+
+Q_SIGNALS:
+   void resultReady();
+};
+
 class NumberCompletionModelPrivate final : public QObject
 {
    Q_OBJECT
@@ -55,19 +139,26 @@ public:
 
    //Constructor
    NumberCompletionModelPrivate(NumberCompletionModel* parent);
+   virtual ~NumberCompletionModelPrivate();
 
    //Methods
    void updateModel();
+   void publish(const QSet<ContactMethod*>& numbers);
 
    //Helper
    void locateNameRange  (const QString& prefix, QSet<ContactMethod*>& set);
    void locateNumberRange(const QString& prefix, QSet<ContactMethod*>& set);
    uint getWeight(ContactMethod* number);
    uint getWeight(Account* account);
-   void getRange(QMap<QString,NumberWrapper*> map, const QString& prefix, QSet<ContactMethod*>& set) const;
+   void getRange(const PrefixIndex<NumberWrapper*>& index, const QString& prefix, QSet<ContactMethod*>& set) const;
+
+   //Constants
+   constexpr static const int DEFAULT_MAX_RESULTS = 0; /*!< No limit */
 
    //Attributes
-   QMultiMap<int,ContactMethod*> m_hNumbers              ;
+   QVector<RankedNumber>         m_lResults              ; /*!< Heaviest first */
+   uint                          m_Generation            ;
+   int                           m_MaxResults            ;
    URI                           m_Prefix                ;
    Call*                         m_pCall                 ;
    bool                          m_Enabled               ;
@@ -75,6 +166,7 @@ public:
    bool                          m_DisplayMostUsedNumbers;
    QItemSelectionModel*          m_pSelectionModel       ;
    bool                          m_HasCustomSelection    ;
+   CompletionSearchThread*       m_pSearchThread         ; /*!< Only when asynchronous */
 
    QHash<Account*,TemporaryContactMethod*> m_hSipTemporaryNumbers;
    QHash<Account*,TemporaryContactMethod*> m_hRingTemporaryNumbers;
@@ -88,6 +180,7 @@ public Q_SLOTS:
 
    void resetSelectionModel();
    void slotSelectionChanged(const QModelIndex& sel, const QModelIndex& prev);
+   void slotSearchResultReady();
 
 private:
    NumberCompletionModel* q_ptr;
@@ -96,7 +189,8 @@ private:
 
 NumberCompletionModelPrivate::NumberCompletionModelPrivate(NumberCompletionModel* parent) : QObject(parent), q_ptr(parent),
 m_pCall(nullptr),m_Enabled(false),m_UseUnregisteredAccount(true), m_Prefix(QString()),m_DisplayMostUsedNumbers(false),
-m_pSelectionModel(nullptr),m_HasCustomSelection(false)
+m_pSelectionModel(nullptr),m_HasCustomSelection(false),m_Generation(0),m_MaxResults(DEFAULT_MAX_RESULTS),
+m_pSearchThread(nullptr)
 {
    //Create the temporary number list
    bool     hasNonIp2Ip = false;
@@ -120,6 +214,14 @@ m_pSelectionModel(nullptr),m_HasCustomSelection(false)
    connect(&AccountModel::instance(), &AccountModel::accountRemoved, this, &NumberCompletionModelPrivate::accountRemoved);
 }
 
+NumberCompletionModelPrivate::~NumberCompletionModelPrivate()
+{
+   if (m_pSearchThread) {
+      m_pSearchThread->stop();
+      delete m_pSearchThread;
+   }
+}
+
 NumberCompletionModel::NumberCompletionModel() : QAbstractTableModel(&PhoneDirectoryModel::instance()), d_ptr(new NumberCompletionModelPrivate(this))
 {
    setObjectName("NumberCompletionModel");
@@ -164,12 +266,12 @@ QHash<int,QByteArray> NumberCompletionModel::roleNames() const
 
 QVariant NumberCompletionModel::data(const QModelIndex& index, int role ) const
 {
-   if (!index.isValid())
+   if ((!index.isValid()) || index.row() >= d_ptr->m_lResults.size())
       return QVariant();
 
-   const QMap<int,ContactMethod*>::iterator i = d_ptr->m_hNumbers.end()-1-index.row();
-   const ContactMethod* n = i.value();
-   const int weight     = i.key  ();
+   const RankedNumber& r = d_ptr->m_lResults[index.row()];
+   const ContactMethod* n = r.number;
+   const int weight     = r.weight;
 
    bool needAcc = (role>=100 || role == Qt::UserRole) && n->account() /*&& n->account() != AvailableAccountModel::currentDefaultAccount()*/
                   && !n->account()->isIp2ip();
@@ -240,7 +342,7 @@ int NumberCompletionModel::rowCount(const QModelIndex& parent ) const
    if (parent.isValid())
       return 0;
 
-   return d_ptr->m_hNumbers.size();
+   return d_ptr->m_lResults.size();
 }
 
 int NumberCompletionModel::columnCount(const QModelIndex& parent ) const
@@ -307,9 +409,14 @@ void NumberCompletionModelPrivate::setPrefix(const QString& str)
    if (m_Enabled)
       updateModel();
    else {
-      q_ptr->beginRemoveRows(QModelIndex(), 0, m_hNumbers.size()-1);
-      m_hNumbers.clear();
-      q_ptr->endRemoveRows();
+      // Also drop the results of a query still being computed
+      ++m_Generation;
+
+      if (!m_lResults.isEmpty()) {
+         q_ptr->beginResetModel();
+         m_lResults.clear();
+         q_ptr->endResetModel();
+      }
    }
 
    if (m_Prefix.protocolHint() == URI::ProtocolHint::RING) {
@@ -331,9 +438,9 @@ Call* NumberCompletionModel::call() const
 
 ContactMethod* NumberCompletionModel::number(const QModelIndex& idx) const
 {
-   if (idx.isValid()) {
+   if (idx.isValid() && idx.row() < d_ptr->m_lResults.size()) {
       //Keep the temporary contact methods private, export a copy
-      ContactMethod* m = (d_ptr->m_hNumbers.end()-1-idx.row()).value();
+      ContactMethod* m = d_ptr->m_lResults[idx.row()].number;
       return m->type() == ContactMethod::Type::TEMPORARY ?
          PhoneDirectoryModel::instance().fromTemporary(qobject_cast<TemporaryContactMethod*>(m))
          : m;
@@ -342,43 +449,107 @@ ContactMethod* NumberCompletionModel::number(const QModelIndex& idx) const
    return nullptr;
 }
 
+RankedNumbers::RankedNumbers(int max) : m_Max(max)
+{
+   if (m_Max > 0)
+      m_lHeap.reserve(m_Max);
+}
+
+///Heap order, the lightest candidate is at the front
+bool RankedNumbers::heavier(const RankedNumber& a, const RankedNumber& b)
+{
+   return a.weight > b.weight;
+}
+
+void RankedNumbers::add(uint weight, ContactMethod* number)
+{
+   if (m_Max <= 0 || static_cast<int>(m_lHeap.size()) < m_Max) {
+      m_lHeap.push_back({weight, number});
+      std::push_heap(m_lHeap.begin(), m_lHeap.end(), heavier);
+   }
+   else if (weight > m_lHeap.front().weight) {
+      std::pop_heap(m_lHeap.begin(), m_lHeap.end(), heavier);
+      m_lHeap.back() = {weight, number};
+      std::push_heap(m_lHeap.begin(), m_lHeap.end(), heavier);
+   }
+}
+
+QVector<RankedNumber> RankedNumbers::take()
+{
+   // Sorting a min-heap with a "heavier" comparator put the heaviest first
+   std::sort_heap(m_lHeap.begin(), m_lHeap.end(), heavier);
+
+   QVector<RankedNumber> ret;
+   ret.reserve(static_cast<int>(m_lHeap.size()));
+
+   for (const RankedNumber& r : m_lHeap)
+      ret << r;
+
+   m_lHeap.clear();
+   return ret;
+}
+
+/**
+ * Look up the candidates for the current prefix.
+ *
+ * In asynchronous mode, the directory is searched by m_pSearchThread and the
+ * results are published by slotSearchResultReady().
+ */
 void NumberCompletionModelPrivate::updateModel()
 {
+   const uint generation = ++m_Generation;
+
    QSet<ContactMethod*> numbers;
-   q_ptr->beginRemoveRows(QModelIndex(), 0, m_hNumbers.size()-1);
-   m_hNumbers.clear();
-   q_ptr->endRemoveRows();
 
    if (!m_Prefix.isEmpty()) {
+      if (m_pSearchThread) {
+         const PhoneDirectoryModelPrivate* dir = PhoneDirectoryModel::instance().d_ptr.data();
+
+         m_pSearchThread->post({
+            generation,
+            m_Prefix.toLower(),
+            dir->m_NameIndex.snapshot(),
+            dir->m_NumberIndex.snapshot()
+         });
+
+         return;
+      }
+
       locateNameRange  ( m_Prefix, numbers );
       locateNumberRange( m_Prefix, numbers );
+   }
 
+   publish(numbers);
+}
+
+/**
+ * Rank the candidates and publish them in a single model reset.
+ *
+ * Only the maximumResults() heaviest candidates are kept.
+ */
+void NumberCompletionModelPrivate::publish(const QSet<ContactMethod*>& numbers)
+{
+   RankedNumbers ranked(m_MaxResults);
+
+   if (!m_Prefix.isEmpty()) {
       if (m_Prefix.protocolHint() == URI::ProtocolHint::RING) {
          for (TemporaryContactMethod* cm : m_hRingTemporaryNumbers) {
-            const int weight = getWeight(cm->account());
-            if (weight) {
-               q_ptr->beginInsertRows(QModelIndex(), m_hNumbers.size(), m_hNumbers.size());
-               m_hNumbers.insert(weight,cm);
-               q_ptr->endInsertRows();
-            }
+            if (!cm) continue;
+            if (const uint weight = getWeight(cm->account()))
+               ranked.add(weight, cm);
          }
       } else {
          for (auto cm : m_hSipTemporaryNumbers) {
             if (!cm) continue;
-            if (auto weight = getWeight(cm->account())) {
-               q_ptr->beginInsertRows(QModelIndex(), m_hNumbers.size(), m_hNumbers.size());
-               m_hNumbers.insert(weight, cm);
-               q_ptr->endInsertRows();
-            }
+            if (const uint weight = getWeight(cm->account()))
+               ranked.add(weight, cm);
          }
       }
 
       for (ContactMethod* n : numbers) {
          if (m_UseUnregisteredAccount || ((n->account() && n->account()->registrationState() == Account::RegistrationState::READY)
           || !n->account())) {
-            q_ptr->beginInsertRows(QModelIndex(), m_hNumbers.size(), m_hNumbers.size());
-            m_hNumbers.insert(getWeight(n),n);
-            q_ptr->endInsertRows();
+            ranked.add(getWeight(n), n);
          }
       }
    }
@@ -388,96 +559,59 @@ void NumberCompletionModelPrivate::updateModel()
 
       for (int i=0;i<((cl.size()>=10)?10:cl.size());i++) {
          ContactMethod* n = cl[i];
-         q_ptr->beginInsertRows(QModelIndex(), m_hNumbers.size(), m_hNumbers.size());
-         m_hNumbers.insert(getWeight(n),n);
-         q_ptr->endInsertRows();
+         ranked.add(getWeight(n), n);
       }
    }
+
+   q_ptr->beginResetModel();
+   m_lResults = ranked.take();
+   q_ptr->endResetModel();
 }
 
-void NumberCompletionModelPrivate::getRange(QMap<QString,NumberWrapper*> map, const QString& prefix, QSet<ContactMethod*>& set) const
+void NumberCompletionModelPrivate::slotSearchResultReady()
 {
-   if (prefix.isEmpty() || map.isEmpty())
-      return;
-
-   QMap<QString,NumberWrapper*>::iterator iBeg = map.begin();
-   QMap<QString,NumberWrapper*>::iterator iEnd = map.end  ()-1;
-
-   const QString pref = prefix.toLower();
-
-   const int prefixLen = pref.size();
-   int size = map.size()/2;
-   bool startOk(false),endOk(false);
-
-   while (size > 1 && !(startOk&&endOk)) {
-      QMap<QString,NumberWrapper*>::iterator mid;
-
-      if (size > 7)
-         mid = (iBeg+size);
-      else {
-         //We have to be careful with "::ceil" it may cause an overflow in some rare case
-         int toAdd = size-1;
-         mid = iBeg;
-
-         while (toAdd && mid != map.end()) {
-            ++mid;
-            --toAdd;
-         }
-
-      }
+   CompletionSearchThread::Result result;
 
-      if (mid != map.end() && mid.key().left(prefixLen) == pref && iBeg.key().left(prefixLen) < pref) {
-         //Too far, need to go back
-         iBeg = mid;
+   if (!(m_pSearchThread && m_pSearchThread->takeResult(result)))
+      return;
 
-         while ((iBeg-1).key().left(prefixLen) == pref && iBeg != map.begin())
-            iBeg--;
+   // The results for an older prefix arrived late
+   if (result.generation != m_Generation || !m_Enabled)
+      return;
 
-         startOk = true;
-      }
-      else if ((!startOk) && mid != map.end() && mid.key().left(prefixLen) < pref) {
-         iBeg = mid;
-      }
-      else if(!endOk) {
-         iEnd = mid;
-      }
+   QSet<ContactMethod*> numbers;
 
-      while ((iEnd).key().left(prefixLen) == pref && iEnd+1 != map.end()) {
-         ++iEnd;
+   for (const NumberWrapper* wrap : result.wrappers) {
+      for (ContactMethod* n : wrap->numbers) {
+         if (n)
+            numbers << n;
       }
-
-      endOk = (iEnd.key().left(prefixLen) == pref);
-
-      size = (int)::ceil((static_cast<float>(size))/2.0f);
    }
 
-   while (iBeg.key().left(prefixLen) != pref && iBeg != map.end() && iBeg != iEnd)
-      ++iBeg;
+   publish(numbers);
+}
 
-   if (iEnd == iBeg && iBeg.key().left(prefixLen) != pref) {
-      iEnd = map.end();
-      iBeg = map.end();
-   }
+void NumberCompletionModelPrivate::getRange(const PrefixIndex<NumberWrapper*>& index, const QString& prefix, QSet<ContactMethod*>& set) const
+{
+   if (prefix.isEmpty() || index.isEmpty())
+      return;
 
-   while(iBeg != iEnd) {
-      foreach(ContactMethod* n,iBeg.value()->numbers) {
-         if (n) {
+   index.forEachWithPrefix(prefix.toLower(), [&set](NumberWrapper* wrap) {
+      for (ContactMethod* n : wrap->numbers) {
+         if (n)
             set << n;
-         }
       }
-
-      ++iBeg;
-   }
+   });
 }
 
 void NumberCompletionModelPrivate::locateNameRange(const QString& prefix, QSet<ContactMethod*>& set)
 {
-   getRange(PhoneDirectoryModel::instance().d_ptr->m_lSortedNames,prefix,set);
+   getRange(PhoneDirectoryModel::instance().d_ptr->m_NameIndex,prefix,set);
 }
 
 void NumberCompletionModelPrivate::locateNumberRange(const QString& prefix, QSet<ContactMethod*>& set)
 {
-   getRange(PhoneDirectoryModel::instance().d_ptr->m_hSortedNumbers,prefix,set);
+   getRange(PhoneDirectoryModel::instance().d_ptr->m_NumberIndex,prefix,set);
 }
 
 uint NumberCompletionModelPrivate::getWeight(ContactMethod* number)
@@ -534,6 +668,143 @@ bool NumberCompletionModel::displayMostUsedNumbers() const
    return d_ptr->m_DisplayMostUsedNumbers;
 }
 
+/**
+ * Keep only the "value" best ranked completions, 0 (the default) for no
+ * limit. The current results are ranked again right away.
+ */
+void NumberCompletionModel::setMaximumResults(int value)
+{
+   if (d_ptr->m_MaxResults == value)
+      return;
+
+   d_ptr->m_MaxResults = value;
+
+   if (d_ptr->m_Enabled)
+      d_ptr->updateModel();
+}
+
+int NumberCompletionModel::maximumResults() const
+{
+   return d_ptr->m_MaxResults;
+}
+
+/**
+ * Search the directory on a worker thread. The model is updated once the
+ * results are available instead of when the prefix change.
+ */
+void NumberCompletionModel::setAsynchronous(bool value)
+{
+   if (value == isAsynchronous())
+      return;
+
+   if (value) {
+      d_ptr->m_pSearchThread = new CompletionSearchThread(nullptr);
+      connect(d_ptr->m_pSearchThread, &CompletionSearchThread::resultReady,
+         d_ptr, &NumberCompletionModelPrivate::slotSearchResultReady, Qt::QueuedConnection);
+      d_ptr->m_pSearchThread->start();
+   }
+   else {
+      d_ptr->m_pSearchThread->stop();
+      delete d_ptr->m_pSearchThread;
+      d_ptr->m_pSearchThread = nullptr;
+
+      // A query may have been in flight
+      if (d_ptr->m_Enabled)
+         d_ptr->updateModel();
+   }
+}
+
+bool NumberCompletionModel::isAsynchronous() const
+{
+   return d_ptr->m_pSearchThread != nullptr;
+}
+
+CompletionSearchThread::CompletionSearchThread(QObject* parent) : QThread(parent),
+m_HasPending(false), m_HasResult(false), m_Stopping(false), m_Latest(0)
+{
+}
+
+///Replace the pending query, if any
+void CompletionSearchThread::post(Query&& query)
+{
+   QMutexLocker lk(&m_Mutex);
+   m_Latest     = query.generation;
+   m_Pending    = std::move(query);
+   m_HasPending = true;
+   m_Condition.wakeOne();
+}
+
+bool CompletionSearchThread::takeResult(Result& result)
+{
+   QMutexLocker lk(&m_Mutex);
+
+   if (!m_HasResult)
+      return false;
+
+   result      = std::move(m_Result);
+   m_HasResult = false;
+
+   return true;
+}
+
+void CompletionSearchThread::stop()
+{
+   {
+      QMutexLocker lk(&m_Mutex);
+      m_Stopping = true;
+      m_Condition.wakeOne();
+   }
+
+   wait();
+}
+
+void CompletionSearchThread::run()
+{
+   forever {
+      Query query;
+
+      {
+         QMutexLocker lk(&m_Mutex);
+
+         while (!(m_HasPending || m_Stopping))
+            m_Condition.wait(&m_Mutex);
+
+         if (m_Stopping)
+            return;
+
+         query        = std::move(m_Pending);
+         m_Pending    = Query();
+         m_HasPending = false;
+      }
+
+      QSet<NumberWrapper*> found;
+      const auto collect = [&found](NumberWrapper* wrap) { found << wrap; };
+
+      query.names.forEachWithPrefix(query.prefix, collect);
+
+      if (m_Latest != query.generation)
+         continue;
+
+      query.numbers.forEachWithPrefix(query.prefix, collect);
+
+      Result result { query.generation, found.toList().toVector() };
+
+      // Release the snapshots before the directory gets modified again
+      query = Query();
+
+      QMutexLocker lk(&m_Mutex);
+
+      // A newer query was posted meanwhile, don't bother the GUI thread
+      if (m_Latest != result.generation)
+         continue;
+
+      m_Result    = std::move(result);
+      m_HasResult = true;
+
+      emit resultReady();
+   }
+}
+
 void NumberCompletionModelPrivate::resetSelectionModel()
 {
    if (!m_pSelectionModel)
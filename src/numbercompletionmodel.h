@@ -40,6 +40,8 @@ public:
    //Properties
    Q_PROPERTY(QString prefix READ prefix)
    Q_PROPERTY(bool displayMostUsedNumbers READ displayMostUsedNumbers WRITE setDisplayMostUsedNumbers)
+   Q_PROPERTY(int maximumResults READ maximumResults WRITE setMaximumResults)
+   Q_PROPERTY(bool asynchronous READ isAsynchronous WRITE setAsynchronous)
 
    enum Role {
       ALTERNATE_ACCOUNT= (int)Ring::Role::UserRole,
@@ -65,6 +67,8 @@ public:
    void setCall(Call* call);
    void setUseUnregisteredAccounts(bool value);
    void setDisplayMostUsedNumbers(bool value);
+   void setMaximumResults(int value);
+   void setAsynchronous(bool value);
 
    //Getters
    Call* call() const;
@@ -72,6 +76,8 @@ public:
    bool isUsingUnregisteredAccounts();
    QString prefix() const;
    bool displayMostUsedNumbers() const;
+   int maximumResults() const;
+   bool isAsynchronous() const;
    QItemSelectionModel* selectionModel() const;
 
 private:
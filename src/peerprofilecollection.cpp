@@ -33,6 +33,7 @@
 #include "accountmodel.h"
 #include "person.h"
 #include "contactmethod.h"
+#include "phonedirectorymodel.h"
 
 class PeerProfileEditor final : public CollectionEditor<Person>
 {
@@ -162,6 +163,8 @@ bool PeerProfileCollection::load()
 
     const QStringList entries = profilesDir.entryList({QStringLiteral("*.vcf")}, QDir::Files);
 
+    PhoneDirectoryModel::BulkInsertion bulk;
+
     foreach (const QString& item , entries) {
         auto filePath = profilesDir.path() + '/' + item;
 
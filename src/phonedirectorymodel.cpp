@@ -20,6 +20,8 @@
 //Qt
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
 
 //DRing
 #include <account_const.h>
@@ -65,7 +67,7 @@ PhoneDirectoryModel::~PhoneDirectoryModel()
    QList<NumberWrapper*> vals = d_ptr->m_hNumbersByNames.values();
    //Used by indexes
    d_ptr->m_hNumbersByNames.clear();
-   d_ptr->m_lSortedNames.clear();
+   d_ptr->m_NameIndex.clear();
    while (vals.size()) {
       NumberWrapper* w = vals[0];
       vals.removeAt(0);
@@ -73,8 +75,8 @@ PhoneDirectoryModel::~PhoneDirectoryModel()
    }
 
    //Used by auto completion
-   vals = d_ptr->m_hSortedNumbers.values();
-   d_ptr->m_hSortedNumbers.clear();
+   vals = d_ptr->m_hDirectory.values();
+   d_ptr->m_NumberIndex.clear();
    d_ptr->m_hDirectory.clear();
    while (vals.size()) {
       NumberWrapper* w = vals[0];
@@ -327,8 +329,8 @@ void PhoneDirectoryModelPrivate::setAccount(ContactMethod* number, Account* acco
       if (!wrap) {
          //It won't be a duplicate as none exist for this URI
          wrap = new NumberWrapper();
-         m_hDirectory    [extendedUri] = wrap;
-         m_hSortedNumbers[extendedUri] = wrap;
+         m_hDirectory[extendedUri] = wrap;
+         indexUri(extendedUri, wrap);
          wrap->numbers << number;
 
       }
@@ -347,7 +349,7 @@ void PhoneDirectoryModelPrivate::setAccount(ContactMethod* number, Account* acco
    // for RingIDs, once we set an account, we should perform (another) name lookup, in case the
    // account has a different name server set from the default
    if (number->uri().protocolHint() == URI::ProtocolHint::RING)
-      NameDirectory::instance().lookupAddress(number->account(), QString(), number->uri().userinfo());
+      lookupName(number);
 }
 
 ///Add new information to existing numbers and try to merge
@@ -464,34 +466,23 @@ ContactMethod* PhoneDirectoryModel::getNumber(const URI& uri, const QString& typ
    connect(number,&ContactMethod::contactChanged ,d_ptr.data(), &PhoneDirectoryModelPrivate::slotContactChanged);
    connect(number,&ContactMethod::rebased ,d_ptr.data(), &PhoneDirectoryModelPrivate::slotContactMethodMerged);
 
-    // add the new cm into the historic.
-    for (auto col : CategorizedHistoryModel::instance().collections(CollectionInterface::SupportedFeatures::ADD)) {
-        if (col->id() == "mhb") {
-            QMap<QString,QString> hc;
-            hc[Call::HistoryMapFields::PEER_NUMBER ] = number->uri();
-            // it matters to set a value to hc[Call::HistoryMapFields::CALLID ], but the value itself doesn't matter
-            hc[Call::HistoryMapFields::CALLID ] = "0";
-
-            if (auto fakeCall = Call::buildHistoryCall(hc))
-                col->add(fakeCall);
-            else
-                qDebug() << "buildHistoryCall() has returned an invalid Call object.";
-        }
-    }
+   // add the new cm into the historic.
+   d_ptr->addToHistory(number);
 
    const QString hn = number->uri().hostname();
 
-   emit layoutChanged();
+   if (!d_ptr->m_BulkDepth)
+      emit layoutChanged();
    if (!wrap) {
       wrap = new NumberWrapper();
       d_ptr->m_hDirectory[uri] = wrap;
-      d_ptr->m_hSortedNumbers[uri] = wrap;
+      d_ptr->indexUri(uri, wrap);
    }
    wrap->numbers << number;
 
    // perform a username lookup for new CM with RingID
    if (number->uri().protocolHint() == URI::ProtocolHint::RING)
-      NameDirectory::instance().lookupAddress(number->account(), QString(), number->uri().userinfo());
+      d_ptr->lookupName(number);
 
    return number;
 }
@@ -597,8 +588,8 @@ ContactMethod* PhoneDirectoryModel::getNumber(const QString& uri, Person* contac
    connect(number,&ContactMethod::rebased ,d_ptr.data(), &PhoneDirectoryModelPrivate::slotContactMethodMerged);
    if (!wrap) {
       wrap = new NumberWrapper();
-      d_ptr->m_hDirectory    [strippedUri] = wrap;
-      d_ptr->m_hSortedNumbers[strippedUri] = wrap;
+      d_ptr->m_hDirectory[strippedUri] = wrap;
+      d_ptr->indexUri(strippedUri, wrap);
 
       //Also add its alternative URI, it should be safe to do
       if ( !hasAtSign && account && !account->hostname().isEmpty() ) {
@@ -606,8 +597,8 @@ ContactMethod* PhoneDirectoryModel::getNumber(const QString& uri, Person* contac
          //Also check if it hasn't been created by setAccount
          if ((!wrap2) && (!d_ptr->m_hDirectory[extendedUri])) {
             wrap2 = new NumberWrapper();
-            d_ptr->m_hDirectory    [extendedUri] = wrap2;
-            d_ptr->m_hSortedNumbers[extendedUri] = wrap2;
+            d_ptr->m_hDirectory[extendedUri] = wrap2;
+            d_ptr->indexUri(extendedUri, wrap2);
          }
 
          if (wrap2)
@@ -618,11 +609,12 @@ ContactMethod* PhoneDirectoryModel::getNumber(const QString& uri, Person* contac
 
    }
    wrap->numbers << number;
-   emit layoutChanged();
+   if (!d_ptr->m_BulkDepth)
+      emit layoutChanged();
 
    // perform a username lookup for new CM with RingID
    if (number->uri().protocolHint() == URI::ProtocolHint::RING)
-      NameDirectory::instance().lookupAddress(number->account(), QString(), number->uri().userinfo());
+      d_ptr->lookupName(number);
 
    return number;
 }
@@ -632,6 +624,55 @@ ContactMethod* PhoneDirectoryModel::fromTemporary(const TemporaryContactMethod*
    return getNumber(number->uri(),number->contact(),number->account());
 }
 
+/**
+ * Create many ContactMethod at once. Until the matching commitBulkInsertion():
+ *
+ *  * the model is not notified of each new number, it is reset once
+ *  * the name lookups are queued, each address is looked up once
+ *  * the new numbers are only added to the history at the end
+ *
+ * The calls can be nested, everything is done by the outermost commit. See
+ * PhoneDirectoryModel::BulkInsertion for the scoped version.
+ */
+void PhoneDirectoryModel::beginBulkInsertion()
+{
+   if (!d_ptr->m_BulkDepth++)
+      beginResetModel();
+}
+
+void PhoneDirectoryModel::commitBulkInsertion()
+{
+   Q_ASSERT(d_ptr->m_BulkDepth > 0);
+
+   if (--d_ptr->m_BulkDepth)
+      return;
+
+   endResetModel();
+
+   const QVector<ContactMethod*> history = d_ptr->m_lPendingHistory;
+   const QVector<ContactMethod*> lookups = d_ptr->m_lPendingLookups;
+
+   d_ptr->m_lPendingHistory.clear();
+   d_ptr->m_lPendingLookups.clear();
+
+   for (ContactMethod* number : history)
+      d_ptr->addToHistory(number);
+
+   // Many numbers can share the same address, for example when an account
+   // was set after the creation
+   QSet<QPair<const Account*, QString>> done;
+
+   for (ContactMethod* number : lookups) {
+      const auto key = qMakePair(static_cast<const Account*>(number->account()), number->uri().userinfo());
+
+      if (done.contains(key))
+         continue;
+
+      done.insert(key);
+      d_ptr->lookupName(number);
+   }
+}
+
 ContactMethod* PhoneDirectoryModel::fromHash(const QString& hash)
 {
    const QStringList fields = hash.split("///");
@@ -699,7 +740,8 @@ void PhoneDirectoryModelPrivate::slotCallAdded(Call* call)
             currentIndex--;
          } while (currentIndex && m_lPopularityIndex[currentIndex-1]->callCount() < number->callCount());
          number->setPopularityIndex(currentIndex);
-         emit q_ptr->layoutChanged();
+         if (!m_BulkDepth)
+            emit q_ptr->layoutChanged();
          if (m_pPopularModel)
             m_pPopularModel->reload();
       }
@@ -709,7 +751,8 @@ void PhoneDirectoryModelPrivate::slotCallAdded(Call* call)
          if (m_pPopularModel)
             m_pPopularModel->addRow();
          number->setPopularityIndex(m_lPopularityIndex.size()-1);
-         emit q_ptr->layoutChanged();
+         if (!m_BulkDepth)
+            emit q_ptr->layoutChanged();
       }
       //The top 10 is full, but this number just made it to the top 10
       else if (currentIndex == -1 && m_lPopularityIndex.size() >= 10 && m_lPopularityIndex[9] != number && m_lPopularityIndex[9]->callCount() < number->callCount()) {
@@ -730,8 +773,46 @@ void PhoneDirectoryModelPrivate::slotCallAdded(Call* call)
    }
 }
 
+///Look up the registered name of a RING number, or queue it during a bulk insertion
+void PhoneDirectoryModelPrivate::lookupName(ContactMethod* number)
+{
+   if (m_BulkDepth) {
+      m_lPendingLookups << number;
+      return;
+   }
+
+   NameDirectory::instance().lookupAddress(number->account(), QString(), number->uri().userinfo());
+}
+
+///Add an history entry for a new number, or queue it during a bulk insertion
+void PhoneDirectoryModelPrivate::addToHistory(ContactMethod* number)
+{
+   if (m_BulkDepth) {
+      m_lPendingHistory << number;
+      return;
+   }
+
+   for (auto col : CategorizedHistoryModel::instance().collections(CollectionInterface::SupportedFeatures::ADD)) {
+      if (col->id() == "mhb") {
+         QMap<QString,QString> hc;
+         hc[Call::HistoryMapFields::PEER_NUMBER ] = number->uri();
+         // it matters to set a value to hc[Call::HistoryMapFields::CALLID ], but the value itself doesn't matter
+         hc[Call::HistoryMapFields::CALLID ] = "0";
+
+         if (auto fakeCall = Call::buildHistoryCall(hc))
+            col->add(fakeCall);
+         else
+            qDebug() << "buildHistoryCall() has returned an invalid Call object.";
+      }
+   }
+}
+
 void PhoneDirectoryModelPrivate::slotChanged()
 {
+   //The model will be reset anyway
+   if (m_BulkDepth)
+      return;
+
    ContactMethod* number = qobject_cast<ContactMethod*>(sender());
    if (number) {
       const int idx = number->index();
@@ -778,6 +859,12 @@ void PhoneDirectoryModelPrivate::slotNewBuddySubscription(const QString& account
    emit number->changed();
 }
 
+///Add an URI to the completion index, the lookups are case insensitive
+void PhoneDirectoryModelPrivate::indexUri(const QString& uri, NumberWrapper* wrap)
+{
+   m_NumberIndex.insert(uri.toLower(), wrap);
+}
+
 ///Make sure the indexes are still valid for those names
 void PhoneDirectoryModelPrivate::indexNumber(ContactMethod* number, const QStringList &names)
 {
@@ -790,7 +877,7 @@ void PhoneDirectoryModelPrivate::indexNumber(ContactMethod* number, const QStrin
             if (!wrap) {
                wrap = new NumberWrapper();
                m_hNumbersByNames[chunk] = wrap;
-               m_lSortedNames[chunk]    = wrap;
+               m_NameIndex.insert(chunk, wrap);
             }
             const int numCount = wrap->numbers.size();
             if (!((numCount == 1 && wrap->numbers[0] == number) || (numCount > 1 && wrap->numbers.indexOf(number) != -1)))
@@ -801,7 +888,7 @@ void PhoneDirectoryModelPrivate::indexNumber(ContactMethod* number, const QStrin
       if (!wrap) {
          wrap = new NumberWrapper();
          m_hNumbersByNames[lower] = wrap;
-         m_lSortedNames[lower]    = wrap;
+         m_NameIndex.insert(lower, wrap);
       }
       const int numCount = wrap->numbers.size();
       if (!((numCount == 1 && wrap->numbers[0] == number) || (numCount > 1 && wrap->numbers.indexOf(number) != -1)))
@@ -840,8 +927,8 @@ PhoneDirectoryModelPrivate::slotRegisteredNameFound(const Account* account, Name
                 if (!m_hDirectory.contains(name)) {
                     //TODO support multiple name service, use proper URIs for names
                     auto wrap2 = new NumberWrapper();
-                    m_hDirectory    [name] = wrap2;
-                    m_hSortedNumbers[name] = wrap2;
+                    m_hDirectory[name] = wrap2;
+                    indexUri(name, wrap2);
                     wrap2->numbers << cm;
                 }
                 else {
@@ -957,7 +1044,7 @@ PhoneDirectoryModel::hasUnreadMessage() const
 {
     return std::any_of(d_ptr->m_lNumbers.begin(), d_ptr->m_lNumbers.end(),
     [](ContactMethod* cm){
-        return cm->textRecording()->unreadInstantTextMessagingModel()->rowCount() > 0;
+        return cm->textRecording()->unreadCount() > 0;
     });
 }
 
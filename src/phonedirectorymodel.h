@@ -97,6 +97,18 @@ public:
    //Setters
    void setCallWithAccount(bool value);
 
+   //Mutator
+   void beginBulkInsertion ();
+   void commitBulkInsertion();
+
+   ///Call beginBulkInsertion() and commitBulkInsertion() for its lifetime
+   class BulkInsertion final {
+   public:
+      BulkInsertion () { PhoneDirectoryModel::instance().beginBulkInsertion (); }
+      ~BulkInsertion() { PhoneDirectoryModel::instance().commitBulkInsertion(); }
+      Q_DISABLE_COPY(BulkInsertion)
+   };
+
    //Static
    QVector<ContactMethod*> getNumbersByPopularity() const;
 
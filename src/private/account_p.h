@@ -69,13 +69,34 @@ public:
    unsigned short             m_UseDefaultPort           ;
    bool                       m_RemoteEnabledState       ;
    uint                       m_InternalId               ;
+   mutable MapStringString    m_hVolatileDetails         ;
+   mutable bool               m_HasVolatileDetails {false};
+   MapStringString            m_hPrefetchedDetails       ;
+   bool                       m_HasPrefetchedDetails {false};
+
+   ///What the daemon knows about an existing account, fetched in advance
+   struct DaemonState {
+      QByteArray            id              ;
+      MapStringString       details         ;
+      MapStringString       volatileDetails ;
+      VectorMapStringString trustRequests   ;
+      VectorMapStringString contacts        ;
+      VectorMapStringString subscriptions   ;
+   };
+
+   //Factories
+   static QVector<DaemonState> fetchDaemonStates   (const QList<QByteArray>& ids);
+   static Account*             buildFromDaemonState(const DaemonState& state    );
 
    //Setters
    void setAccountProperties(const QHash<QString,QString>& m          );
    bool setAccountProperty  (const QString& param, const QString& val );
+   void setVolatileDetails  (const MapStringString& details           );
+   void setVolatileDetail   (const QString& param, const QString& val );
 
    //Getters
    QString accountDetail(const QString& param) const;
+   const MapStringString& volatileDetails() const;
 
    //Mutator
    bool merge(Account* account);
@@ -19,6 +19,7 @@
 #pragma once
 
 //Qt
+#include <QtCore/QHash>
 #include <QtCore/QObject>
 #include <QtCore/QStringList>
 
@@ -45,6 +46,9 @@ public:
    AccountModel::EditState convertAccountEditState(const Account::EditState s);
    void insertAccount(Account* a, int idx);
    void removeAccount(Account* account);
+   void indexAccount(Account* a);
+   void unindexAccount(Account* a);
+   int  rowOf(const Account* a) const;
 
    //Attributes
    AccountModel*                     q_ptr                ;
@@ -60,6 +64,20 @@ public:
    QList<Account*>                   m_lRingAccounts      ;
    Matrix1D<Account::Protocol, bool> m_lSupportedProtocols;
 
+   ///The keys an account is currently indexed with, they can change after a save
+   struct IndexKeys {
+      QByteArray        id       ;
+      QString           hostname ;
+      Account::Protocol protocol ;
+   };
+
+   //Indexes
+   QHash<QByteArray, Account*>       m_hAccountsById      ;
+   QMultiHash<QString, Account*>     m_hAccountsByHostname;
+   QHash<const Account*, IndexKeys>  m_hIndexKeys         ;
+   mutable QHash<const Account*,int> m_hRows              ;
+   mutable bool                      m_IsRowsDirty {true} ;
+
    //Future account cache
    static QHash<QByteArray,AccountPlaceHolder*> m_hsPlaceHolder;
 
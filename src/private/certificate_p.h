@@ -124,9 +124,17 @@ public:
    mutable DetailsCache* m_pDetailsCache;
    mutable ChecksCache*  m_pCheckCache  ;
 
+   /* When CertificateLoader is enabled, the caches are empty placeholders
+    * until its results are received.
+    */
+   bool m_IsLoading      {false};
+   int  m_LoadGeneration {  0  }; /*!< Incremented by the synchronous reloads */
+
    //Helpers
    void loadDetails(bool reload = false);
    void loadChecks (bool loadChecks = false);
+   void loadAsync  ();
+   void setResults (const MapStringString& details, const MapStringString& checks);
 
    static Matrix1D<Certificate::Checks ,QString> m_slChecksName;
    static Matrix1D<Certificate::Checks ,QString> m_slChecksDescription;
@@ -0,0 +1,369 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "certificateloader.h"
+
+//Qt
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QTimer>
+#ifndef ENABLE_LIBWRAP
+#include <QtDBus/QDBusPendingCallWatcher>
+#endif
+
+//Ring
+#include "dbus/configurationmanager.h"
+#include "certificate.h"
+#include "private/threadworker.h"
+
+static QJsonObject toJson(const MapStringString& map)
+{
+   QJsonObject ret;
+
+   for (auto i = map.constBegin(); i != map.constEnd(); ++i)
+      ret[i.key()] = i.value();
+
+   return ret;
+}
+
+static MapStringString fromJson(const QJsonObject& obj)
+{
+   MapStringString ret;
+
+   for (auto i = obj.constBegin(); i != obj.constEnd(); ++i)
+      ret[i.key()] = i.value().toString();
+
+   return ret;
+}
+
+CertificateLoader::CertificateLoader() : QObject(nullptr)
+{
+}
+
+CertificateLoader& CertificateLoader::instance()
+{
+   static auto loader = new CertificateLoader();
+   return *loader;
+}
+
+bool CertificateLoader::isEnabled() const
+{
+   return m_IsEnabled;
+}
+
+void CertificateLoader::setEnabled(bool value)
+{
+   if (value && !m_IsEnabled)
+      new ThreadWorker(&CertificateLoader::pruneCache);
+
+   m_IsEnabled = value;
+}
+
+/**
+ * Queue "cert" for the next batch. The certificate placeholder values are
+ * replaced once the results are available.
+ */
+void CertificateLoader::request(Certificate* cert)
+{
+   QMutexLocker locker(&m_Mutex);
+
+   if (m_lQueued.contains(cert))
+      return;
+
+   m_lQueued.insert(cert);
+   m_lQueue << cert;
+
+   if (!m_IsScheduled) {
+      m_IsScheduled = true;
+      QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+   }
+}
+
+void CertificateLoader::flush()
+{
+   QVector<QPointer<Certificate>> certs;
+
+   {
+      QMutexLocker locker(&m_Mutex);
+      certs.reserve(m_lQueue.size());
+
+      // Some may have been deleted meanwhile
+      for (const QPointer<Certificate>& c : m_lQueue) {
+         if (c)
+            certs << c;
+      }
+
+      m_lQueue.clear();
+      m_lQueued.clear();
+      m_IsScheduled = false;
+   }
+
+   if (certs.isEmpty())
+      return;
+
+   std::shared_ptr<Batch> batch(new Batch());
+   batch->certs = certs;
+   batch->requests.reserve(certs.size());
+
+   for (const QPointer<Certificate>& c : certs) {
+      const CertificatePrivate* d = c->d_ptr;
+      batch->requests << Request {
+         d->m_LoadingType, d->m_Id, d->m_Path, d->m_PrivateKey, d->m_PrivateKeyPassword, d->m_LoadGeneration
+      };
+   }
+
+   batch->results.resize(batch->requests.size());
+
+   // Hashing the files and reading the cache is done by the worker
+   new ThreadWorker([this, batch]() {
+      for (int i = 0; i < batch->requests.size(); i++) {
+         Result& result = batch->results[i];
+
+         // Never cache what depends on the private key password
+         if (batch->requests[i].password.isEmpty())
+            result.key = fingerprint(batch->requests[i]);
+
+         if (result.key.isEmpty() || !readCache(result))
+            batch->missing << i;
+      }
+
+      QTimer::singleShot(0, this, [this, batch]() {
+         query(batch);
+      });
+   });
+}
+
+///Query the daemon for the certificates missing from the cache
+void CertificateLoader::query(const std::shared_ptr<Batch>& batch)
+{
+   if (batch->missing.isEmpty()) {
+      finish(batch);
+      return;
+   }
+
+   ConfigurationManagerInterface& configurationManager = ConfigurationManager::instance();
+
+#ifdef ENABLE_LIBWRAP
+   for (const int i : batch->missing) {
+      const Request& r = batch->requests[i];
+
+      switch(r.type) {
+         case LoadingType::FROM_PATH:
+            batch->results[i].details = configurationManager.getCertificateDetailsPath(r.path, r.privateKey, r.password);
+            batch->results[i].checks  = configurationManager.validateCertificatePath(QString(), r.path, r.privateKey, r.password, {});
+            break;
+         case LoadingType::FROM_ID:
+            batch->results[i].details = configurationManager.getCertificateDetails(r.id);
+            batch->results[i].checks  = configurationManager.validateCertificate(QString(), r.id);
+            break;
+      }
+   }
+
+   finish(batch);
+#else //ENABLE_LIBWRAP
+   const auto watch = [this, batch](const QDBusPendingCall& call, MapStringString Result::* field, int i) {
+      auto watcher = new QDBusPendingCallWatcher(call, this);
+      batch->pending++;
+
+      connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, batch, field, i](QDBusPendingCallWatcher* w) {
+         const QDBusPendingReply<MapStringString> reply = *w;
+
+         if (reply.isValid())
+            batch->results[i].*field = reply.value();
+
+         w->deleteLater();
+
+         if (!--batch->pending)
+            finish(batch);
+      });
+   };
+
+   for (const int i : batch->missing) {
+      const Request& r = batch->requests[i];
+
+      switch(r.type) {
+         case LoadingType::FROM_PATH:
+            watch(configurationManager.getCertificateDetailsPath(r.path, r.privateKey, r.password), &Result::details, i);
+            watch(configurationManager.validateCertificatePath(QString(), r.path, r.privateKey, r.password, {}), &Result::checks, i);
+            break;
+         case LoadingType::FROM_ID:
+            watch(configurationManager.getCertificateDetails(r.id), &Result::details, i);
+            watch(configurationManager.validateCertificate(QString(), r.id), &Result::checks, i);
+            break;
+      }
+   }
+#endif //ENABLE_LIBWRAP
+}
+
+///Update the certificates and cache the new results
+void CertificateLoader::finish(const std::shared_ptr<Batch>& batch)
+{
+   apply(*batch);
+
+   QVector<Result> fresh;
+
+   for (const int i : batch->missing) {
+      const Result& result = batch->results[i];
+
+      if ((!result.key.isEmpty()) && !result.details.isEmpty())
+         fresh << result;
+   }
+
+   if (fresh.isEmpty())
+      return;
+
+   new ThreadWorker([fresh]() {
+      for (const Result& result : fresh)
+         writeCache(result);
+   });
+}
+
+void CertificateLoader::apply(const Batch& batch)
+{
+   for (int i = 0; i < batch.certs.size(); i++) {
+      Certificate* c = batch.certs[i].data();
+
+      if (!c)
+         continue;
+
+      // It was reloaded with other parameters meanwhile, ask again
+      if (c->d_ptr->m_LoadGeneration != batch.requests[i].generation) {
+         request(c);
+         continue;
+      }
+
+      c->d_ptr->setResults(batch.results[i].details, batch.results[i].checks);
+   }
+}
+
+/**
+ * The daemon identify the certificates by their fingerprint, use it as key.
+ * The certificates loaded from a file are identified by a hash of their
+ * content instead. As the checks also cover the files permissions, they are
+ * also part of the key.
+ */
+QByteArray CertificateLoader::fingerprint(const Request& r)
+{
+   QCryptographicHash hash(QCryptographicHash::Sha1);
+
+   switch(r.type) {
+      case LoadingType::FROM_ID:
+         if (r.id.isEmpty())
+            return {};
+
+         hash.addData(r.id);
+         break;
+      case LoadingType::FROM_PATH: {
+         QFile file(r.path);
+
+         if (!file.open(QIODevice::ReadOnly))
+            return {};
+
+         hash.addData(&file);
+
+         for (const QString& path : {r.path, r.privateKey}) {
+            if (path.isEmpty())
+               continue;
+
+            const QFileInfo info(path);
+            hash.addData(path.toUtf8());
+            hash.addData(QByteArray::number(static_cast<int>(info.permissions())));
+            hash.addData(QByteArray::number(static_cast<int>(QFileInfo(info.absolutePath()).permissions())));
+            hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+         }
+      }
+         break;
+   }
+
+   return hash.result().toHex();
+}
+
+QString CertificateLoader::cacheDir()
+{
+   return QStandardPaths::writableLocation(QStandardPaths::DataLocation)
+      + QStringLiteral("/certificates_cache/");
+}
+
+QString CertificateLoader::cachePath(const QByteArray& key)
+{
+   return cacheDir() + key + QStringLiteral(".json");
+}
+
+/**
+ * Remove the expired entries. The keys of the path certificates change with
+ * the files, so their old entries would otherwise be kept forever.
+ */
+void CertificateLoader::pruneCache()
+{
+   const QDir dir(cacheDir());
+   const QDateTime limit = QDateTime::currentDateTimeUtc().addSecs(-CACHE_LIFETIME);
+
+   for (const QFileInfo& info : dir.entryInfoList({QStringLiteral("*.json")}, QDir::Files)) {
+      if (info.lastModified().toUTC() < limit)
+         QFile::remove(info.absoluteFilePath());
+   }
+}
+
+bool CertificateLoader::readCache(Result& result)
+{
+   QFile file(cachePath(result.key));
+
+   if (!file.open(QIODevice::ReadOnly))
+      return false;
+
+   const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+
+   const qint64 age = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch()/1000
+      - static_cast<qint64>(obj[QStringLiteral("validated")].toDouble());
+
+   if (age < 0 || age > CACHE_LIFETIME)
+      return false;
+
+   result.details = fromJson(obj[QStringLiteral("details")].toObject());
+   result.checks  = fromJson(obj[QStringLiteral("checks" )].toObject());
+
+   return !result.details.isEmpty();
+}
+
+void CertificateLoader::writeCache(const Result& result)
+{
+   const QString path = cachePath(result.key);
+
+   QDir().mkpath(QFileInfo(path).absolutePath());
+
+   QJsonObject obj;
+   obj[ QStringLiteral("validated") ] = static_cast<double>(QDateTime::currentDateTimeUtc().toMSecsSinceEpoch()/1000);
+   obj[ QStringLiteral("details"  ) ] = toJson(result.details);
+   obj[ QStringLiteral("checks"   ) ] = toJson(result.checks );
+
+   QSaveFile file(path);
+
+   if (!file.open(QIODevice::WriteOnly)) {
+      qWarning() << "Cannot write the certificate cache" << path;
+      return;
+   }
+
+   file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+   file.commit();
+}
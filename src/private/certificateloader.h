@@ -0,0 +1,115 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//Qt
+#include <QtCore/QObject>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+//Ring
+#include <typedefs.h>
+#include "private/certificate_p.h"
+
+//libSTDC++
+#include <memory>
+
+class Certificate;
+
+/**
+ * Fetch the certificates details and checks without blocking the GUI thread.
+ *
+ * The certificates requested during the same event loop iteration are
+ * queried together. The cache is read and written by a worker, but the
+ * daemon proxy is only used from the thread of the loader. Over D-Bus, the
+ * calls of a batch are all sent asynchronously and the certificates are
+ * updated once every reply arrived.
+ *
+ * The results are cached on disk, keyed by the certificate fingerprint, so
+ * the unchanged certificates are not validated again after a restart. As the
+ * checks also depend on time (expiration, revocation), the cached entries
+ * are only trusted for CACHE_LIFETIME seconds.
+ */
+class CertificateLoader final : public QObject
+{
+   Q_OBJECT
+public:
+   static CertificateLoader& instance();
+
+   //Getters
+   bool isEnabled() const;
+
+   //Setters
+   void setEnabled(bool value);
+
+   //Mutator
+   void request(Certificate* cert);
+
+private:
+   ///A snapshot of what is needed to query the daemon
+   struct Request {
+      LoadingType type        ;
+      QByteArray  id          ;
+      QString     path        ;
+      QString     privateKey  ;
+      QString     password    ;
+      int         generation  ;
+   };
+
+   struct Result {
+      QByteArray      key      ;
+      MapStringString details  ;
+      MapStringString checks   ;
+   };
+
+   ///The certificates flushed together
+   struct Batch {
+      QVector<QPointer<Certificate>> certs    ;
+      QVector<Request>               requests ;
+      QVector<Result>                results  ;
+      QVector<int>                   missing  ; /*!< Not in the cache */
+      int                            pending {0}; /*!< Replies still expected */
+   };
+
+   constexpr static const qint64 CACHE_LIFETIME = 24*60*60;
+
+   explicit CertificateLoader();
+
+   //Attributes
+   QMutex                          m_Mutex            ;
+   bool                            m_IsEnabled {false};
+   bool                            m_IsScheduled {false};
+   QVector<QPointer<Certificate>>  m_lQueue           ;
+   QSet<Certificate*>              m_lQueued          ;
+
+   //Helpers
+   void query (const std::shared_ptr<Batch>& batch);
+   void finish(const std::shared_ptr<Batch>& batch);
+   void apply (const Batch& batch);
+
+   static QString    cacheDir   (                                  );
+   static QString    cachePath  ( const QByteArray& key            );
+   static QByteArray fingerprint( const Request& r                 );
+   static bool       readCache  ( Result& result                   );
+   static void       writeCache ( const Result& result             );
+   static void       pruneCache (                                  );
+
+private Q_SLOTS:
+   void flush();
+};
@@ -50,6 +50,7 @@ public:
    bool banCertificate(Certificate* c, Account* a);
    void loadChecks(CertificateNode* checks, Certificate* cert);
    void regenChecks(Certificate* cert);
+   void regenDetails(Certificate* cert);
    bool isPartOf(CertificateNode* sibling, CertificateNode* list);
 
    //Attributes
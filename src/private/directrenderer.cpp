@@ -25,6 +25,7 @@
 #include <QtCore/QTimer>
 
 #include <cstring>
+#include <vector>
 
 #ifndef CLOCK_REALTIME
 #define CLOCK_REALTIME 0
@@ -38,6 +39,32 @@
 
 namespace Video {
 
+/**
+ * Fixed size pool of frame buffers shared between the daemon, the renderer
+ * and the frame leases.
+ *
+ * It has its own lock as leases can be released from any thread, even after
+ * the renderer is gone.
+ */
+class DirectFramePool final
+{
+public:
+    // Constants
+    /// One buffer written by the daemon, one ready and one displayed
+    constexpr static const uint MIN_POOL_DEPTH = 3;
+
+    //Mutators
+    DRing::SinkTarget::FrameBufferPtr acquire(std::size_t bytes);
+    void recycle(DRing::SinkTarget::FrameBufferPtr buf);
+    void setDepth(uint depth);
+
+private:
+    QMutex m_Mutex;
+    uint m_Depth {MIN_POOL_DEPTH}; // max number of buffers owned by the renderer
+    uint m_Allocated {0}; // number of buffers currently alive
+    std::vector<DRing::SinkTarget::FrameBufferPtr> m_lFreeBuffers;
+};
+
 class DirectRendererPrivate : public QObject
 {
     Q_OBJECT
@@ -48,7 +75,9 @@ public:
 
     DRing::SinkTarget target;
     mutable QMutex directmutex;
-    mutable DRing::SinkTarget::FrameBufferPtr daemonFramePtr_;
+    mutable DRing::SinkTarget::FrameBufferPtr daemonFramePtr_; // last frame pushed by the daemon
+    mutable DRing::SinkTarget::FrameBufferPtr displayedFramePtr_; // frame exposed by currentFrame()
+    std::shared_ptr<DirectFramePool> m_pPool {std::make_shared<DirectFramePool>()};
 private:
     Video::DirectRenderer* q_ptr;
 };
@@ -85,47 +114,202 @@ void Video::DirectRenderer::startRendering()
 void Video::DirectRenderer::stopRendering ()
 {
    Video::Renderer::d_ptr->m_isRendering = false;
+
+   {
+      // Give the pending frames back to the pool, keep the buffers allocated
+      QMutexLocker lk(mutex());
+      d_ptr->m_pPool->recycle(std::move(d_ptr->daemonFramePtr_   ));
+      d_ptr->m_pPool->recycle(std::move(d_ptr->displayedFramePtr_));
+   }
+
    emit stopped();
 }
 
+/**
+ * Set how many frame buffers this renderer can own.
+ *
+ * The depth cannot be smaller than MIN_POOL_DEPTH. When reduced, the extra
+ * buffers are released as soon as they come back to the pool.
+ */
+void Video::DirectRenderer::setBufferSize(uint size)
+{
+   d_ptr->m_pPool->setDepth(size);
+}
+
+void Video::DirectFramePool::setDepth(uint depth)
+{
+    QMutexLocker lk(&m_Mutex);
+
+    m_Depth = depth < MIN_POOL_DEPTH ? MIN_POOL_DEPTH : depth;
+
+    while (m_Allocated > m_Depth && !m_lFreeBuffers.empty()) {
+        m_lFreeBuffers.pop_back();
+        --m_Allocated;
+    }
+}
+
+/// Return a buffer to the pool
+void Video::DirectFramePool::recycle(DRing::SinkTarget::FrameBufferPtr buf)
+{
+    if (not buf)
+        return;
+
+    QMutexLocker lk(&m_Mutex);
+
+    if (m_Allocated > m_Depth) {
+        --m_Allocated;
+        return;
+    }
+
+    m_lFreeBuffers.push_back(std::move(buf));
+}
+
+/// Get a free buffer or nullptr if they are all in use
+DRing::SinkTarget::FrameBufferPtr Video::DirectFramePool::acquire(std::size_t bytes)
+{
+    QMutexLocker lk(&m_Mutex);
+
+    DRing::SinkTarget::FrameBufferPtr buf;
+
+    if (not m_lFreeBuffers.empty()) {
+        buf = std::move(m_lFreeBuffers.back());
+        m_lFreeBuffers.pop_back();
+    }
+    else if (m_Allocated < m_Depth) {
+        buf.reset(new DRing::FrameBuffer);
+        ++m_Allocated;
+    }
+    else
+        return nullptr;
+
+    // Shrinking a vector or growing it within its capacity doesn't allocate
+    buf->storage.resize(bytes);
+    buf->ptr = buf->storage.data();
+    buf->ptrSize = bytes;
+    return buf;
+}
+
+/**
+ * Hand a buffer of at least "bytes" to the daemon.
+ *
+ * Buffers are taken from the pool and keep their storage between frames, so
+ * no allocation happen once the pool is warm and the resolution is stable.
+ * If every buffer is in use, the frame waiting to be displayed is dropped
+ * and its buffer is reused.
+ */
 DRing::SinkTarget::FrameBufferPtr Video::DirectRendererPrivate::requestFrameBuffer(std::size_t bytes)
 {
     QMutexLocker lk(q_ptr->mutex());
+
+    if (auto buf = m_pPool->acquire(bytes))
+        return buf;
+
+    // The daemon skips this frame
     if (not daemonFramePtr_)
-        daemonFramePtr_.reset(new DRing::FrameBuffer);
-    daemonFramePtr_->storage.resize(bytes);
-    daemonFramePtr_->ptr = daemonFramePtr_->storage.data();
-    daemonFramePtr_->ptrSize = bytes;
-    return std::move(daemonFramePtr_);
+        return nullptr;
+
+    q_ptr->Video::Renderer::d_ptr->framesDropped(1);
+
+    auto buf = std::move(daemonFramePtr_);
+    buf->storage.resize(bytes);
+    buf->ptr = buf->storage.data();
+    buf->ptrSize = bytes;
+    return buf;
 }
 
 void Video::DirectRendererPrivate::onNewFrame(DRing::SinkTarget::FrameBufferPtr buf)
 {
-    if (not q_ptr->isRendering())
+    if (not q_ptr->isRendering()) {
+        m_pPool->recycle(std::move(buf));
         return;
+    }
+
+    auto stats = q_ptr->Video::Renderer::d_ptr;
+
+    // This is the daemon thread, the frame is being produced right now
+    const qint64 producedAt = Video::RendererPrivate::now();
 
     {
         QMutexLocker lk(q_ptr->mutex());
+
+        // The previous frame was never displayed, drop it
+        if (daemonFramePtr_) {
+            stats->framesDropped(1);
+            m_pPool->recycle(std::move(daemonFramePtr_));
+        }
+
         daemonFramePtr_ = std::move(buf);
     }
 
+    stats->frameProduced(producedAt);
+
     emit q_ptr->frameUpdated();
 }
 
+/**
+ * Get the latest frame pushed by the daemon.
+ *
+ * The returned frame doesn't own its data, it points to a pooled buffer that
+ * stays valid until the next call to currentFrame() or stopRendering().
+ */
 Video::Frame Video::DirectRenderer::currentFrame() const
 {
     if (not isRendering())
         return {};
 
     QMutexLocker lock(mutex());
-    if (not d_ptr->daemonFramePtr_)
+    if (not d_ptr->daemonFramePtr_) {
+        Video::Renderer::d_ptr->frameDuplicated();
         return {};
+    }
+
+    Video::Renderer::d_ptr->frameDelivered();
+
+    d_ptr->m_pPool->recycle(std::move(d_ptr->displayedFramePtr_));
+    d_ptr->displayedFramePtr_ = std::move(d_ptr->daemonFramePtr_);
 
     Video::Frame frame;
-    frame.storage = std::move(d_ptr->daemonFramePtr_->storage);
-    frame.ptr = frame.storage.data();
-    frame.size = frame.storage.size();
-    return std::move(frame);
+    frame.ptr  = d_ptr->displayedFramePtr_->ptr;
+    frame.size = d_ptr->displayedFramePtr_->ptrSize;
+    return frame;
+}
+
+/**
+ * Take the latest frame pushed by the daemon out of the renderer.
+ *
+ * The buffer is owned by the lease and goes back to the pool when the last
+ * copy of the lease is released. While it is held, the daemon will use the
+ * other buffers of the pool or drop frames.
+ */
+Video::FrameLease Video::DirectRenderer::leaseFrame() const
+{
+    if (not isRendering())
+        return {};
+
+    DRing::FrameBuffer* buf = nullptr;
+
+    {
+        QMutexLocker lock(mutex());
+        if (not d_ptr->daemonFramePtr_) {
+            Video::Renderer::d_ptr->frameDuplicated();
+            return {};
+        }
+
+        buf = d_ptr->daemonFramePtr_.release();
+    }
+
+    Video::Renderer::d_ptr->frameDelivered();
+
+    auto frame  = new Video::Frame;
+    frame->ptr  = buf->ptr;
+    frame->size = buf->ptrSize;
+
+    // The deleter has to be copyable, so it carries a raw pointer
+    std::shared_ptr<DirectFramePool> pool = d_ptr->m_pPool;
+    return Video::FrameLease(frame, [pool, buf](const Video::Frame* f) {
+        delete f;
+        pool->recycle(DRing::SinkTarget::FrameBufferPtr(buf));
+    });
 }
 
 const DRing::SinkTarget& Video::DirectRenderer::target() const
@@ -51,7 +51,10 @@ public:
    const DRing::SinkTarget& target() const;
    virtual ColorSpace colorSpace() const override;
    virtual Frame currentFrame() const override;
+   virtual FrameLease leaseFrame() const override;
 
+   //Setters
+   void setBufferSize(uint size);
 
 public Q_SLOTS:
    virtual void startRendering() override;
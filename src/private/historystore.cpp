@@ -0,0 +1,600 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "historystore.h"
+
+//Qt
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStringList>
+#include <QtCore/QtEndian>
+
+//libSTDC++
+#include <algorithm>
+
+//Ring
+#include "call.h"
+
+/*
+ * File layout (big endian):
+ *
+ *    header : "RHST" quint16(version)
+ *    record : quint8(type) quint32(payload size) payload quint16(CRC-16 of type, size and payload)
+ *
+ * CALL payload      : qint64(start) utf8(call id) utf8(peer uri) quint8(count) count * field
+ * field             : quint8(id) [utf8(name) if id == CUSTOM_FIELD] utf8(value)
+ * TOMBSTONE payload : the live key of the call in utf8, see liveKey()
+ *
+ * The utf8 strings are QDataStream QByteArrays.
+ */
+
+namespace {
+
+constexpr static const char    MAGIC[]            = "RHST";
+constexpr static const quint16 VERSION            = 1;
+constexpr static const int     HEADER_SIZE        = 6;
+constexpr static const int     RECORD_HEADER_SIZE = 5;
+constexpr static const int     CHECKSUM_SIZE      = 2;
+constexpr static const quint32 MAX_PAYLOAD        = 1 << 20;
+constexpr static const quint8  CUSTOM_FIELD       = 0xFF;
+
+/// The position is the field id in the records, only ever append to this list
+static const char* const FIELDS[] = {
+   Call::HistoryMapFields::ACCOUNT_ID     ,
+   Call::HistoryMapFields::DISPLAY_NAME   ,
+   Call::HistoryMapFields::RECORDING_PATH ,
+   Call::HistoryMapFields::STATE          ,
+   Call::HistoryMapFields::TIMESTAMP_STOP ,
+   Call::HistoryMapFields::MISSED         ,
+   Call::HistoryMapFields::DIRECTION      ,
+   Call::HistoryMapFields::CONTACT_USED   ,
+   Call::HistoryMapFields::CONTACT_UID    ,
+   Call::HistoryMapFields::NUMBER_TYPE    ,
+   Call::HistoryMapFields::CERT_PATH      ,
+};
+
+constexpr static const int FIELD_COUNT = sizeof(FIELDS)/sizeof(FIELDS[0]);
+
+QByteArray fileHeader()
+{
+   QByteArray ret(MAGIC, 4);
+   ret.resize(HEADER_SIZE);
+   qToBigEndian<quint16>(VERSION, reinterpret_cast<uchar*>(ret.data() + 4));
+   return ret;
+}
+
+/// Key to the live calls, the calls without an id can't be superseded
+QString liveKey(const HistoryStore::Entry& entry)
+{
+   return entry.historyId.isEmpty() ?
+      QString(QLatin1Char('#') + QString::number(entry.offset)) : entry.historyId;
+}
+
+}
+
+HistoryStore::HistoryStore(const QString& path) : m_Path(path), m_Dead(0)
+{
+}
+
+HistoryStore::~HistoryStore()
+{
+   if (m_File.isOpen())
+      m_File.close();
+}
+
+///Open or create the log and index the live calls
+bool HistoryStore::open()
+{
+   if (m_File.isOpen())
+      m_File.close();
+
+   QDir().mkpath(QFileInfo(m_Path).absolutePath());
+
+   m_File.setFileName(m_Path);
+
+   if (!m_File.open(QIODevice::ReadWrite)) {
+      qWarning() << "Unable to open the history" << m_Path << m_File.errorString();
+      return false;
+   }
+
+   if (!m_File.size())
+      m_File.write(fileHeader());
+
+   if (!scan())
+      return false;
+
+   maybeCompact();
+
+   return true;
+}
+
+bool HistoryStore::exists() const
+{
+   return QFile::exists(m_Path);
+}
+
+/**
+ * Read the record headers and keep the position of the live calls.
+ *
+ * A record which is truncated or has a bad checksum end the log, it is
+ * most likely the last write before a crash.
+ */
+bool HistoryStore::scan()
+{
+   m_hLive.clear();
+   m_Dead = 0;
+
+   m_File.seek(0);
+
+   if (m_File.read(HEADER_SIZE) != fileHeader()) {
+      qWarning() << "Unsupported history format" << m_Path;
+      m_File.close();
+      return false;
+   }
+
+   qint64 pos = HEADER_SIZE;
+
+   forever {
+      const QByteArray record = readRaw(pos);
+
+      if (record.isEmpty()) {
+         if (pos < m_File.size()) {
+            qWarning() << "Dropping a damaged history record at" << pos;
+            m_File.resize(pos);
+         }
+         break;
+      }
+
+      const QByteArray payload = record.mid(RECORD_HEADER_SIZE, record.size() - RECORD_HEADER_SIZE - CHECKSUM_SIZE);
+
+      switch (static_cast<RecordType>(record[0])) {
+         case RecordType::CALL: {
+            Entry entry;
+            if (decodeCall(payload, nullptr, entry)) {
+               entry.offset = pos;
+               track(entry);
+            }
+            else
+               m_Dead++;
+         }
+            break;
+         case RecordType::TOMBSTONE:
+            if (m_hLive.remove(QString::fromUtf8(payload)))
+               m_Dead++;
+            m_Dead++;
+            break;
+         default:
+            m_Dead++;
+      }
+
+      pos += record.size();
+   }
+
+   return true;
+}
+
+///Read a whole record, an empty array is returned if it isn't valid
+QByteArray HistoryStore::readRaw(qint64 offset)
+{
+   if (!m_File.seek(offset))
+      return {};
+
+   QByteArray record = m_File.read(RECORD_HEADER_SIZE);
+
+   if (record.size() != RECORD_HEADER_SIZE)
+      return {};
+
+   const quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(record.constData() + 1));
+
+   if (size > MAX_PAYLOAD)
+      return {};
+
+   record += m_File.read(size + CHECKSUM_SIZE);
+
+   if (record.size() != static_cast<int>(RECORD_HEADER_SIZE + size + CHECKSUM_SIZE))
+      return {};
+
+   const quint16 checksum = qFromBigEndian<quint16>(
+      reinterpret_cast<const uchar*>(record.constData() + RECORD_HEADER_SIZE + size)
+   );
+
+   if (checksum != qChecksum(record.constData(), RECORD_HEADER_SIZE + size))
+      return {};
+
+   return record;
+}
+
+bool HistoryStore::writeRecord(RecordType type, const QByteArray& payload, qint64* offset)
+{
+   QByteArray record(RECORD_HEADER_SIZE, '\0');
+   record[0] = static_cast<char>(type);
+   qToBigEndian<quint32>(payload.size(), reinterpret_cast<uchar*>(record.data() + 1));
+   record += payload;
+
+   QByteArray checksum(CHECKSUM_SIZE, '\0');
+   qToBigEndian<quint16>(qChecksum(record.constData(), record.size()), reinterpret_cast<uchar*>(checksum.data()));
+   record += checksum;
+
+   const qint64 pos = m_File.size();
+
+   if (!(m_File.seek(pos) && m_File.write(record) == record.size())) {
+      qWarning() << "Unable to write the history" << m_File.errorString();
+      return false;
+   }
+
+   if (offset)
+      *offset = pos;
+
+   return true;
+}
+
+void HistoryStore::track(const Entry& entry)
+{
+   const QString k = liveKey(entry);
+
+   if (m_hLive.contains(k))
+      m_Dead++;
+
+   m_hLive[k] = entry;
+}
+
+void HistoryStore::maybeCompact()
+{
+   if (m_Dead >= COMPACTION_MIN_DEAD && m_Dead > m_hLive.size())
+      compact();
+}
+
+///Add a call, or replace it if a call with the same id exist
+bool HistoryStore::append(const HistoryMap& call)
+{
+   if (!m_File.isOpen())
+      return false;
+
+   Entry entry {
+      0,
+      static_cast<time_t>(call[Call::HistoryMapFields::TIMESTAMP_START].toLongLong()),
+      call[Call::HistoryMapFields::CALLID     ],
+      call[Call::HistoryMapFields::PEER_NUMBER],
+   };
+
+   if (!writeRecord(RecordType::CALL, encodeCall(call), &entry.offset))
+      return false;
+
+   m_File.flush();
+
+   track(entry);
+   maybeCompact();
+
+   return true;
+}
+
+///Remove a call, false if there is no live call with this id
+bool HistoryStore::remove(const QString& historyId)
+{
+   if (!m_File.isOpen())
+      return false;
+
+   if (historyId.isEmpty() || !m_hLive.contains(historyId))
+      return false;
+
+   if (!writeRecord(RecordType::TOMBSTONE, historyId.toUtf8(), nullptr))
+      return false;
+
+   m_File.flush();
+
+   m_hLive.remove(historyId);
+   m_Dead += 2;
+   maybeCompact();
+
+   return true;
+}
+
+/**
+ * Remove the calls started at or before "limit", including the ones
+ * without an id. The tombstones are keyed by the live key, which for those
+ * calls is their offset. It stays valid until the next compaction, which
+ * drops both the tombstone and the record.
+ *
+ * @return the number of removed calls
+ */
+int HistoryStore::expire(time_t limit)
+{
+   if (!m_File.isOpen())
+      return 0;
+
+   QStringList expired;
+
+   for (auto i = m_hLive.constBegin(); i != m_hLive.constEnd(); ++i) {
+      if (i->startTimeStamp <= limit)
+         expired << i.key();
+   }
+
+   int count = 0;
+
+   for (const QString& key : expired) {
+      if (!writeRecord(RecordType::TOMBSTONE, key.toUtf8(), nullptr))
+         break;
+
+      m_hLive.remove(key);
+      m_Dead += 2;
+      ++count;
+   }
+
+   if (count) {
+      m_File.flush();
+      maybeCompact();
+   }
+
+   return count;
+}
+
+///Rewrite the log with only the live calls
+bool HistoryStore::compact()
+{
+   if (!m_File.isOpen())
+      return false;
+
+   QSaveFile out(m_Path);
+
+   if (!out.open(QIODevice::WriteOnly)) {
+      qWarning() << "Unable to compact the history" << out.errorString();
+      return false;
+   }
+
+   out.write(fileHeader());
+
+   QHash<QString,Entry> live;
+   live.reserve(m_hLive.size());
+
+   for (Entry entry : entries()) {
+      const QByteArray record = readRaw(entry.offset);
+
+      if (record.isEmpty()) {
+         qWarning() << "Unable to compact the history, a record is unreadable";
+         out.cancelWriting();
+         return false;
+      }
+
+      entry.offset = out.pos();
+      out.write(record);
+      live[liveKey(entry)] = entry;
+   }
+
+   m_File.close();
+
+   const bool committed = out.commit();
+
+   if (committed) {
+      m_hLive = live;
+      m_Dead  = 0;
+   }
+   else
+      qWarning() << "Unable to compact the history" << out.errorString();
+
+   if (!m_File.open(QIODevice::ReadWrite)) {
+      m_hLive.clear();
+      return false;
+   }
+
+   return committed;
+}
+
+///Remove all calls
+bool HistoryStore::clear()
+{
+   m_File.close();
+   m_hLive.clear();
+   m_Dead = 0;
+
+   QFile::remove(m_Path);
+
+   return open();
+}
+
+/**
+ * Append the calls of a legacy history.ini file. It is a list of "key=value"
+ * lines, each call ending with an empty line.
+ */
+bool HistoryStore::importIni(const QString& path)
+{
+   if (!m_File.isOpen())
+      return false;
+
+   QFile file(path);
+
+   if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+      return false;
+
+   HistoryMap hc;
+
+   const auto flush = [this, &hc]() {
+      Entry entry {
+         0,
+         static_cast<time_t>(hc[Call::HistoryMapFields::TIMESTAMP_START].toLongLong()),
+         hc[Call::HistoryMapFields::CALLID     ],
+         hc[Call::HistoryMapFields::PEER_NUMBER],
+      };
+
+      if (writeRecord(RecordType::CALL, encodeCall(hc), &entry.offset))
+         track(entry);
+
+      hc.clear();
+   };
+
+   while (!file.atEnd()) {
+      const QString line = QString::fromUtf8(file.readLine()).trimmed();
+
+      //The item is complete
+      if (line.isEmpty()) {
+         if (hc.size())
+            flush();
+      }
+      // Add to the current set
+      else {
+         const int idx = line.indexOf(QLatin1Char('='));
+         if (idx >= 0)
+            hc[line.left(idx)] = line.mid(idx+1);
+      }
+   }
+
+   if (hc.size())
+      flush();
+
+   m_File.flush();
+
+   return true;
+}
+
+///The live calls, in the order they were written
+QVector<HistoryStore::Entry> HistoryStore::entries() const
+{
+   QVector<Entry> ret;
+   ret.reserve(m_hLive.size());
+
+   for (const Entry& e : m_hLive)
+      ret << e;
+
+   std::sort(ret.begin(), ret.end(), [](const Entry& a, const Entry& b) {
+      return a.offset < b.offset;
+   });
+
+   return ret;
+}
+
+///Read the fields of the call record at "offset"
+bool HistoryStore::read(qint64 offset, HistoryMap& call)
+{
+   const QByteArray record = readRaw(offset);
+
+   if (record.isEmpty() || static_cast<RecordType>(record[0]) != RecordType::CALL)
+      return false;
+
+   Entry entry;
+
+   return decodeCall(
+      record.mid(RECORD_HEADER_SIZE, record.size() - RECORD_HEADER_SIZE - CHECKSUM_SIZE),
+      &call, entry
+   );
+}
+
+/**
+ * Read the fields of the live call "historyId".
+ *
+ * Unlike the offsets, the id stays valid when the log is compacted.
+ */
+bool HistoryStore::read(const QString& historyId, HistoryMap& call)
+{
+   if (historyId.isEmpty())
+      return false;
+
+   const auto it = m_hLive.constFind(historyId);
+
+   return it != m_hLive.constEnd() && read(it->offset, call);
+}
+
+QByteArray HistoryStore::encodeCall(const HistoryMap& call)
+{
+   QByteArray ret;
+   QDataStream s(&ret, QIODevice::WriteOnly);
+   s.setVersion(QDataStream::Qt_5_0);
+
+   s << static_cast<qint64>(call[Call::HistoryMapFields::TIMESTAMP_START].toLongLong())
+     << call[Call::HistoryMapFields::CALLID     ].toUtf8()
+     << call[Call::HistoryMapFields::PEER_NUMBER].toUtf8();
+
+   QVector<QPair<quint8, HistoryMap::const_iterator>> fields;
+
+   for (auto i = call.constBegin(); i != call.constEnd() && fields.size() < CUSTOM_FIELD; ++i) {
+      if (i.key() == Call::HistoryMapFields::CALLID
+       || i.key() == Call::HistoryMapFields::PEER_NUMBER
+       || i.key() == Call::HistoryMapFields::TIMESTAMP_START)
+         continue;
+
+      quint8 id = CUSTOM_FIELD;
+
+      for (int f = 0; f < FIELD_COUNT; f++) {
+         if (i.key() == FIELDS[f]) {
+            id = f;
+            break;
+         }
+      }
+
+      fields << qMakePair(id, i);
+   }
+
+   s << static_cast<quint8>(fields.size());
+
+   for (const auto& f : fields) {
+      s << f.first;
+
+      if (f.first == CUSTOM_FIELD)
+         s << f.second.key().toUtf8();
+
+      s << f.second.value().toUtf8();
+   }
+
+   return ret;
+}
+
+/**
+ * Decode a call record payload. The fields are only decoded when "call"
+ * isn't null, otherwise only "entry" is filled.
+ */
+bool HistoryStore::decodeCall(const QByteArray& payload, HistoryMap* call, Entry& entry)
+{
+   QDataStream s(payload);
+   s.setVersion(QDataStream::Qt_5_0);
+
+   qint64     start;
+   QByteArray id, peer;
+
+   s >> start >> id >> peer;
+
+   entry.startTimeStamp = static_cast<time_t>(start);
+   entry.historyId      = QString::fromUtf8(id  );
+   entry.peerUri        = QString::fromUtf8(peer);
+
+   if (call) {
+      (*call)[Call::HistoryMapFields::CALLID         ] = entry.historyId;
+      (*call)[Call::HistoryMapFields::PEER_NUMBER    ] = entry.peerUri;
+      (*call)[Call::HistoryMapFields::TIMESTAMP_START] = QString::number(start);
+
+      quint8 count = 0;
+      s >> count;
+
+      for (int i = 0; i < count && s.status() == QDataStream::Ok; i++) {
+         quint8     field;
+         QByteArray name, value;
+
+         s >> field;
+
+         if (field == CUSTOM_FIELD)
+            s >> name;
+
+         s >> value;
+
+         if (field == CUSTOM_FIELD)
+            (*call)[QString::fromUtf8(name)] = QString::fromUtf8(value);
+         else if (field < FIELD_COUNT)
+            (*call)[FIELDS[field]] = QString::fromUtf8(value);
+      }
+   }
+
+   return s.status() == QDataStream::Ok;
+}
@@ -0,0 +1,95 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//Qt
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+//libSTDC++
+#include <ctime>
+
+/**
+ * Append-only binary log of the call history.
+ *
+ * Each call is a record holding the same fields as the history maps used by
+ * Call::buildHistoryCall(). Saving a call again appends a new record which
+ * supersedes the previous one and removing or expiring a call appends a
+ * tombstone, the file is never rewritten for a single change. The dead records are dropped
+ * by compact(), which is done automatically once they outnumber the live
+ * ones.
+ *
+ * Every record is checksummed, a record truncated by a crash is discarded
+ * when the log is opened.
+ */
+class HistoryStore final
+{
+public:
+   using HistoryMap = QMap<QString,QString>;
+
+   ///The part of a call record known without reading its fields
+   struct Entry {
+      qint64  offset        ;
+      time_t  startTimeStamp;
+      QString historyId     ;
+      QString peerUri       ;
+   };
+
+   explicit HistoryStore(const QString& path);
+   ~HistoryStore();
+
+   //Mutators
+   bool open     (                             );
+   bool append   ( const HistoryMap& call      );
+   bool remove   ( const QString&    historyId );
+   int  expire   ( time_t            limit     );
+   bool compact  (                             );
+   bool clear    (                             );
+   bool importIni( const QString&    path      );
+
+   //Getters
+   bool           exists (                                  ) const;
+   QVector<Entry> entries(                                  ) const;
+   bool           read   ( qint64 offset, HistoryMap& call  );
+   bool           read   ( const QString& historyId, HistoryMap& call );
+
+private:
+   enum class RecordType : quint8 {
+      CALL      = 1,
+      TOMBSTONE = 2,
+   };
+
+   constexpr static const int COMPACTION_MIN_DEAD = 256;
+
+   QString              m_Path ;
+   QFile                m_File ;
+   QHash<QString,Entry> m_hLive; /*!< By history id           */
+   int                  m_Dead ; /*!< Superseded or tombstones */
+
+   //Helpers
+   bool       scan        (                                                               );
+   QByteArray readRaw     ( qint64 offset                                                 );
+   bool       writeRecord ( RecordType type, const QByteArray& payload, qint64* offset    );
+   void       track       ( const Entry& entry                                            );
+   void       maybeCompact(                                                               );
+
+   static QByteArray encodeCall(const HistoryMap& call);
+   static bool       decodeCall(const QByteArray& payload, HistoryMap* call, Entry& entry);
+};
@@ -19,6 +19,8 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QHash>
+#include <QtCore/QQueue>
+#include <QtCore/QVector>
 
 class Account;
 class Call;
@@ -38,6 +40,22 @@ public:
 
    static IMConversationManagerPrivate& instance();
 
+   //Getter
+   QHash<uint64_t,int> messageStatus(const QVector<uint64_t>& ids);
+
+private:
+   //Constants
+   constexpr static const int MAX_CACHED_STATUS = 1024;
+
+   ///The final status of the messages not loaded yet, by id
+   QHash<uint64_t,int> m_hStatus;
+
+   ///The ids of m_hStatus, oldest first. It may contain ids handed over since
+   QQueue<uint64_t>    m_lStatusOrder;
+
+   //Helper
+   void cacheStatus(uint64_t id, int status);
+
 private Q_SLOTS:
    void newMessage       (const QString& callId   , const QString& from, const QMap<QString,QString>& payloads);
    void newAccountMessage(const QString& accountId, const QString& from, const QMap<QString,QString>& payloads);
@@ -0,0 +1,253 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//Qt
+#include <QtCore/QVector>
+
+//libSTDC++
+#include <functional>
+
+/**
+ * Sorted container giving the position (rank) of its elements.
+ *
+ * It is a treap where every node knows the size of its subtree, so the
+ * insertion, removal, rank and positional access are all O(log n). This is
+ * what models need to keep sorted rows without renumbering them after each
+ * change.
+ *
+ * The insertion returns a handle to the element. It stays valid until the
+ * element is removed and is the way to query its rank.
+ */
+template<typename Key, typename T, typename Less = std::less<Key>>
+class OrderStatisticTree final
+{
+public:
+   class Node {
+      friend class OrderStatisticTree;
+   public:
+      const Key& key  () const { return m_Key;   }
+      const T&   value() const { return m_Value; }
+   private:
+      Node(const Key& k, const T& v, quint32 p) : m_Key(k), m_Value(v), m_Priority(p) {}
+
+      Key     m_Key              ;
+      T       m_Value            ;
+      quint32 m_Priority         ;
+      int     m_Size   {   1   } ;
+      Node*   m_pLeft  {nullptr} ;
+      Node*   m_pRight {nullptr} ;
+      Node*   m_pParent{nullptr} ;
+   };
+
+   OrderStatisticTree() {}
+   OrderStatisticTree(const OrderStatisticTree&) = delete;
+   OrderStatisticTree& operator=(const OrderStatisticTree&) = delete;
+   ~OrderStatisticTree() { clear(); }
+
+   int size() const { return size(m_pRoot); }
+   bool isEmpty() const { return !m_pRoot; }
+
+   ///Insert after the elements with an equivalent key
+   Node* insert(const Key& key, const T& value)
+   {
+      Node* n = new Node(key, value, nextPriority());
+      Node *a, *b;
+      split(m_pRoot, key, a, b, true);
+      m_pRoot = merge(merge(a, n), b);
+      m_pRoot->m_pParent = nullptr;
+      return n;
+   }
+
+   void remove(Node* n)
+   {
+      Node* m = merge(n->m_pLeft, n->m_pRight);
+      Node* p = n->m_pParent;
+
+      if (m)
+         m->m_pParent = p;
+
+      if (!p)
+         m_pRoot = m;
+      else if (p->m_pLeft == n)
+         p->m_pLeft = m;
+      else
+         p->m_pRight = m;
+
+      for (; p; p = p->m_pParent)
+         p->m_Size--;
+
+      delete n;
+   }
+
+   ///The position of "n" in the sorted order
+   int rank(const Node* n) const
+   {
+      int ret = size(n->m_pLeft);
+
+      for (; n->m_pParent; n = n->m_pParent) {
+         if (n == n->m_pParent->m_pRight)
+            ret += size(n->m_pParent->m_pLeft) + 1;
+      }
+
+      return ret;
+   }
+
+   ///The number of elements strictly ordered before "key"
+   int lowerBound(const Key& key) const
+   {
+      int ret = 0;
+
+      for (const Node* n = m_pRoot; n;) {
+         if (m_Less(n->m_Key, key)) {
+            ret += size(n->m_pLeft) + 1;
+            n    = n->m_pRight;
+         }
+         else
+            n = n->m_pLeft;
+      }
+
+      return ret;
+   }
+
+   ///The element at "position", which must be in [0, size())
+   const Node* at(int position) const
+   {
+      const Node* n = m_pRoot;
+
+      while (n) {
+         const int left = size(n->m_pLeft);
+
+         if (position < left)
+            n = n->m_pLeft;
+         else if (position == left)
+            return n;
+         else {
+            position -= left + 1;
+            n         = n->m_pRight;
+         }
+      }
+
+      return nullptr;
+   }
+
+   ///All the values, in order
+   QVector<T> values() const
+   {
+      QVector<T> ret;
+      ret.reserve(size());
+      collect(m_pRoot, ret);
+      return ret;
+   }
+
+   void clear()
+   {
+      destroy(m_pRoot);
+      m_pRoot = nullptr;
+   }
+
+private:
+   Node*   m_pRoot {nullptr};
+   quint32 m_Seed  {2463534242u};
+   Less    m_Less  ;
+
+   static int size(const Node* n) { return n ? n->m_Size : 0; }
+
+   ///xorshift, the priorities only need to be well distributed
+   quint32 nextPriority()
+   {
+      m_Seed ^= m_Seed << 13;
+      m_Seed ^= m_Seed >> 17;
+      m_Seed ^= m_Seed << 5;
+      return m_Seed;
+   }
+
+   static void update(Node* n)
+   {
+      n->m_Size = 1 + size(n->m_pLeft) + size(n->m_pRight);
+
+      if (n->m_pLeft)
+         n->m_pLeft->m_pParent = n;
+
+      if (n->m_pRight)
+         n->m_pRight->m_pParent = n;
+   }
+
+   /*
+    * Split "t" in "a" (before "key") and "b". When "after" is set, the
+    * elements equivalent to "key" go in "a".
+    */
+   void split(Node* t, const Key& key, Node*& a, Node*& b, bool after) const
+   {
+      if (!t) {
+         a = b = nullptr;
+         return;
+      }
+
+      const bool goesLeft = after ? !m_Less(key, t->m_Key) : m_Less(t->m_Key, key);
+
+      if (goesLeft) {
+         split(t->m_pRight, key, t->m_pRight, b, after);
+         a = t;
+         update(a);
+      }
+      else {
+         split(t->m_pLeft, key, a, t->m_pLeft, after);
+         b = t;
+         update(b);
+      }
+   }
+
+   static Node* merge(Node* a, Node* b)
+   {
+      if (!a)
+         return b;
+
+      if (!b)
+         return a;
+
+      if (a->m_Priority > b->m_Priority) {
+         a->m_pRight = merge(a->m_pRight, b);
+         update(a);
+         return a;
+      }
+
+      b->m_pLeft = merge(a, b->m_pLeft);
+      update(b);
+      return b;
+   }
+
+   static void collect(const Node* n, QVector<T>& out)
+   {
+      if (!n)
+         return;
+
+      collect(n->m_pLeft, out);
+      out << n->m_Value;
+      collect(n->m_pRight, out);
+   }
+
+   static void destroy(Node* n)
+   {
+      if (!n)
+         return;
+
+      destroy(n->m_pLeft );
+      destroy(n->m_pRight);
+      delete n;
+   }
+};
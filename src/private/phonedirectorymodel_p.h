@@ -23,6 +23,7 @@
 class PhoneDirectoryModel;
 #include "contactmethod.h"
 #include "namedirectory.h"
+#include "private/prefixindex.h"
 
 //Internal data structures
 ///@struct NumberWrapper Wrap phone numbers to prevent collisions
@@ -82,16 +83,22 @@ public:
    void indexNumber(ContactMethod* number, const QStringList& names   );
    void setAccount (ContactMethod* number,       Account*     account );
    ContactMethod* fillDetails(NumberWrapper* wrap, const URI& strippedUri, Account* account, Person* contact, const QString& type);
+   void indexUri   (const QString& uri, NumberWrapper* wrap);
+   void lookupName  (ContactMethod* number);
+   void addToHistory(ContactMethod* number);
 
    //Attributes
    QVector<ContactMethod*>         m_lNumbers         ;
    QHash<QString,NumberWrapper*> m_hDirectory       ;
    QVector<ContactMethod*>         m_lPopularityIndex ;
-   QMap<QString,NumberWrapper*>  m_lSortedNames     ;
-   QMap<QString,NumberWrapper*>  m_hSortedNumbers   ;
+   PrefixIndex<NumberWrapper*>   m_NameIndex        ; /*!< Lower case names and name chunks */
+   PrefixIndex<NumberWrapper*>   m_NumberIndex      ; /*!< Lower case URIs                  */
    QHash<QString,NumberWrapper*> m_hNumbersByNames  ;
    bool                          m_CallWithAccount  ;
    MostPopularNumberModel*       m_pPopularModel    ;
+   int                           m_BulkDepth {0}    ; /*!< Nested beginBulkInsertion() */
+   QVector<ContactMethod*>       m_lPendingLookups  ; /*!< Deferred by the bulk insertion */
+   QVector<ContactMethod*>       m_lPendingHistory  ; /*!< Deferred by the bulk insertion */
 
    Q_DECLARE_PUBLIC(PhoneDirectoryModel)
 
@@ -0,0 +1,75 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//Qt
+#include <QtCore/QString>
+
+//libSTDC++
+#include <memory>
+#include <vector>
+
+/**
+ * Compressed trie (radix tree) mapping strings to one or more values.
+ *
+ * It is used to find all values whose key start with a prefix without
+ * scanning or copying the whole key set. Inserting is O(key length).
+ *
+ * The nodes are shared between copies and are only cloned when a shared
+ * node is modified (copy on write). This make snapshot() cheap, a snapshot
+ * can be read from another thread while the original keeps being updated.
+ * A single instance must not be used by multiple threads at once.
+ */
+template<typename T>
+class PrefixIndex
+{
+public:
+   explicit PrefixIndex();
+
+   //Mutators
+   void insert(const QString& key, const T& value);
+   void clear ();
+
+   //Getters
+   int  size   () const;
+   bool isEmpty() const;
+   PrefixIndex<T> snapshot() const;
+
+   /// Call "f(const T&)" for each value whose key start with "prefix"
+   template<typename F>
+   void forEachWithPrefix(const QString& prefix, F&& f) const;
+
+private:
+   struct Node {
+      QString                            label   ; /*!< Edge from the parent node */
+      std::vector<T>                     values  ;
+      std::vector<std::shared_ptr<Node>> children; /*!< Sorted by first char      */
+   };
+
+   std::shared_ptr<Node> m_pRoot;
+   int                   m_Size ;
+
+   //Helpers
+   static Node* detach(std::shared_ptr<Node>& node);
+   static int   commonPrefix(const QString& a, int aPos, const QString& b);
+   static typename std::vector<std::shared_ptr<Node>>::iterator findChild(Node* n, QChar c);
+
+   template<typename F>
+   static void visit(const Node* n, F& f);
+};
+
+#include "prefixindex.hpp"
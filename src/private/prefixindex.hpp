@@ -0,0 +1,178 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//libSTDC++
+#include <algorithm>
+#include <atomic>
+
+template<typename T>
+PrefixIndex<T>::PrefixIndex() : m_pRoot(std::make_shared<Node>()), m_Size(0)
+{
+}
+
+template<typename T>
+int PrefixIndex<T>::size() const
+{
+   return m_Size;
+}
+
+template<typename T>
+bool PrefixIndex<T>::isEmpty() const
+{
+   return !m_Size;
+}
+
+template<typename T>
+void PrefixIndex<T>::clear()
+{
+   m_pRoot = std::make_shared<Node>();
+   m_Size  = 0;
+}
+
+///Share all the nodes, they will be cloned when one of the copy change
+template<typename T>
+PrefixIndex<T> PrefixIndex<T>::snapshot() const
+{
+   return *this;
+}
+
+/**
+ * Make sure "node" is not shared with a snapshot before modifying it.
+ *
+ * A snapshot may have been released by another thread. use_count() is a
+ * relaxed load, the fence pairs it with the release of the reference count
+ * decrement so the reads made through the snapshot happen before the node
+ * is modified in place.
+ */
+template<typename T>
+typename PrefixIndex<T>::Node* PrefixIndex<T>::detach(std::shared_ptr<Node>& node)
+{
+   if (node.use_count() > 1)
+      node = std::make_shared<Node>(*node);
+   else
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+   return node.get();
+}
+
+///Length of the common prefix between a.mid(aPos) and b
+template<typename T>
+int PrefixIndex<T>::commonPrefix(const QString& a, int aPos, const QString& b)
+{
+   const int len = std::min(a.size() - aPos, b.size());
+
+   int i = 0;
+   while (i < len && a[aPos + i] == b[i])
+      ++i;
+
+   return i;
+}
+
+template<typename T>
+typename std::vector<std::shared_ptr<typename PrefixIndex<T>::Node>>::iterator
+PrefixIndex<T>::findChild(Node* n, QChar c)
+{
+   return std::lower_bound(n->children.begin(), n->children.end(), c,
+      [](const std::shared_ptr<Node>& child, QChar ch) {
+         return child->label[0] < ch;
+   });
+}
+
+/**
+ * Add "value" to "key". A value is only stored once per key.
+ */
+template<typename T>
+void PrefixIndex<T>::insert(const QString& key, const T& value)
+{
+   Node* n   = detach(m_pRoot);
+   int   pos = 0;
+
+   while (pos < key.size()) {
+      auto it = findChild(n, key[pos]);
+
+      // No edge start with this char, add a leaf
+      if (it == n->children.end() || (*it)->label[0] != key[pos]) {
+         auto leaf   = std::make_shared<Node>();
+         leaf->label = key.mid(pos);
+         leaf->values.push_back(value);
+         n->children.insert(it, leaf);
+         ++m_Size;
+         return;
+      }
+
+      Node*     child = detach(*it);
+      const int len   = commonPrefix(key, pos, child->label);
+
+      // The edge is longer than the common part, split it
+      if (len < child->label.size()) {
+         auto tail      = std::make_shared<Node>();
+         tail->label    = child->label.mid(len);
+         tail->values   = std::move(child->values  );
+         tail->children = std::move(child->children);
+
+         child->label    = child->label.left(len);
+         child->values   = {};
+         child->children = {tail};
+      }
+
+      n    = child;
+      pos += len;
+   }
+
+   if (std::find(n->values.begin(), n->values.end(), value) == n->values.end()) {
+      n->values.push_back(value);
+      ++m_Size;
+   }
+}
+
+template<typename T>
+template<typename F>
+void PrefixIndex<T>::visit(const Node* n, F& f)
+{
+   for (const T& v : n->values)
+      f(v);
+
+   for (const auto& child : n->children)
+      visit(child.get(), f);
+}
+
+template<typename T>
+template<typename F>
+void PrefixIndex<T>::forEachWithPrefix(const QString& prefix, F&& f) const
+{
+   const Node* n   = m_pRoot.get();
+   int         pos = 0;
+
+   while (pos < prefix.size()) {
+      auto it = findChild(const_cast<Node*>(n), prefix[pos]);
+
+      if (it == n->children.end() || (*it)->label[0] != prefix[pos])
+         return;
+
+      const Node* child = it->get();
+      const int   len   = commonPrefix(prefix, pos, child->label);
+
+      // Either the prefix end inside this edge or it doesn't match
+      if (len < child->label.size() && pos + len < prefix.size())
+         return;
+
+      n    = child;
+      pos += len;
+   }
+
+   visit(n, f);
+}
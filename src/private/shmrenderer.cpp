@@ -35,16 +35,14 @@
 #define CLOCK_REALTIME 0
 #endif
 
-#include <QtCore/QTimer>
 #include <chrono>
+#include <atomic>
+#include <memory>
 
 #include "private/videorenderermanager.h"
 #include "video/resolution.h"
 #include "private/videorenderer_p.h"
 
-// Uncomment following line to output in console the FPS value
-//#define DEBUG_FPS
-
 /* Shared memory object
  * Implementation note: double-buffering
  * Shared memory is divided in two regions, each representing one frame.
@@ -70,6 +68,33 @@ struct SHMHeader {
 
 namespace Video {
 
+/**
+ * Block on the SHM frameGenMutex semaphore and notify the renderer when the
+ * daemon publishes a new frame.
+ *
+ * The waiter use its own mapping of the header so it is not affected when
+ * ShmRendererPrivate::remapShm() moves the main mapping around.
+ */
+class ShmFrameWaiter final : public QThread
+{
+   Q_OBJECT
+public:
+   ShmFrameWaiter(ShmRenderer* renderer, RendererPrivate* stats, int fd);
+   virtual ~ShmFrameWaiter();
+
+   //Mutators
+   void stop();
+
+protected:
+   virtual void run() override;
+
+private:
+   ShmRenderer*     m_pRenderer;
+   RendererPrivate* m_pStats   ;
+   SHMHeader*       m_pHeader  ;
+   std::atomic_bool m_Running  ;
+};
+
 class ShmRendererPrivate final : public QObject
 {
    Q_OBJECT
@@ -77,30 +102,27 @@ class ShmRendererPrivate final : public QObject
 public:
    ShmRendererPrivate(ShmRenderer* parent);
 
-   //Types
-   using TimePoint = std::chrono::time_point<std::chrono::system_clock>;
-
    // Attributes
    QString    m_ShmPath       ;
    int        m_fd            ;
    SHMHeader* m_pShmArea      ;
    unsigned   m_ShmAreaLen    ;
    uint       m_FrameGen      ;
-   int        m_fpsC          ;
-   int        m_Fps           ;
-   TimePoint  m_lastFrameDebug;
-   QTimer*    m_pTimer        ;
+   qint64     m_LockedAt      ;
+   ShmFrameWaiter* m_pWaiter  ;
+   std::shared_ptr<Frame> m_pLease; /*!< Reused once the client released it */
 
    // Constants
-   constexpr static const int FPS_RATE_SEC        = 1  ;
    constexpr static const int FRAME_CHECK_RATE_HZ = 120;
+   constexpr static const int FRAME_WAIT_MS       = 100;
 
    // Helpers
-   timespec createTimeout(           );
+   static timespec createTimeout( int ms );
    bool     shmLock      (           );
    void     shmUnlock    (           );
-   bool     getNewFrame  ( bool wait );
+   bool     getNewFrame  ( bool wait, Frame* copy = nullptr );
    bool     remapShm     (           );
+   void     stopWaiter   (           );
 
 private:
    Video::ShmRenderer* q_ptr;
@@ -110,16 +132,11 @@ ShmRendererPrivate::ShmRendererPrivate(ShmRenderer* parent)
    : QObject     ( parent                              )
    , q_ptr       ( parent                              )
    , m_fd        ( -1                                  )
-   , m_fpsC      ( 0                                   )
-   , m_Fps       ( 0                                   )
    , m_pShmArea  ( (SHMHeader*)MAP_FAILED              )
    , m_ShmAreaLen( 0                                   )
    , m_FrameGen  ( 0                                   )
-   , m_pTimer    ( nullptr                             )
-#ifdef DEBUG_FPS
-   , m_frameCount( 0                                   )
-   , m_lastFrameDebug(std::chrono::system_clock::now() )
-#endif
+   , m_LockedAt  ( 0                                   )
+   , m_pWaiter   ( nullptr                             )
 {
 }
 
@@ -135,27 +152,45 @@ ShmRenderer::ShmRenderer(const QByteArray& id, const QString& shmPath, const QSi
 /// Destructor
 ShmRenderer::~ShmRenderer()
 {
-   if (d_ptr->m_pTimer) {
-      d_ptr->m_pTimer->stop();
-      d_ptr->m_pTimer = nullptr;
-   }
    stopShm();
 }
 
+/// Create an absolute timeout suitable for sem_timedwait()
+timespec ShmRendererPrivate::createTimeout(int ms)
+{
+   timespec timeout;
+   ::clock_gettime(CLOCK_REALTIME, &timeout);
+
+   timeout.tv_sec  += ms / 1000;
+   timeout.tv_nsec += (ms % 1000) * 1000000L;
+
+   if (timeout.tv_nsec >= 1000000000L) {
+      timeout.tv_nsec -= 1000000000L;
+      ++timeout.tv_sec;
+   }
+
+   return timeout;
+}
+
 /// Wait new frame data from shared memory and save pointer
-bool ShmRendererPrivate::getNewFrame(bool wait)
+/// If "copy" is set, the frame is also copied into it while locked
+bool ShmRendererPrivate::getNewFrame(bool wait, Frame* copy)
 {
    if (!shmLock())
       return false;
 
+   auto stats = q_ptr->Video::Renderer::d_ptr;
+
    if (m_FrameGen == m_pShmArea->frameGen) {
       shmUnlock();
 
-      if (not wait)
+      if (not wait) {
+         stats->frameDuplicated();
          return false;
+      }
 
       // wait for a new frame, max 33ms
-      static const struct timespec timeout = {0, 33000000};
+      const timespec timeout = createTimeout(33);
       if (::sem_timedwait(&m_pShmArea->frameGenMutex, &timeout) < 0)
          return false;
 
@@ -182,23 +217,24 @@ bool ShmRendererPrivate::getNewFrame(bool wait)
    frame_ptr->storage.clear();
    frame_ptr->ptr = m_pShmArea->data + m_pShmArea->readOffset;
    frame_ptr->size = m_pShmArea->frameSize;
-   m_FrameGen = m_pShmArea->frameGen;
+
+   if (copy) {
+      copy->storage.assign(frame_ptr->ptr, frame_ptr->ptr + frame_ptr->size);
+      copy->ptr  = copy->storage.data();
+      copy->size = copy->storage.size();
+   }
+
+   // Every frameGen skipped since the last frame was never seen by the client
+   const unsigned gen = m_pShmArea->frameGen;
+   const quint64 skipped = (m_FrameGen && gen > m_FrameGen) ? gen - m_FrameGen - 1 : 0;
+   m_FrameGen = gen;
 
    shmUnlock();
 
-   ++m_fpsC;
-
-   // Compute the FPS shown to the client
-   auto currentTime = std::chrono::system_clock::now();
-   const std::chrono::duration<double> seconds = currentTime - m_lastFrameDebug;
-   if (seconds.count() >= FPS_RATE_SEC) {
-      m_Fps = (int)(m_fpsC / seconds.count());
-      m_fpsC = 0;
-      m_lastFrameDebug = currentTime;
-#ifdef DEBUG_FPS
-      qDebug() << this << ": FPS " << m_fps;
-#endif
-   }
+   if (skipped)
+      stats->framesDropped(skipped);
+
+   stats->frameDelivered();
 
    return true;
 }
@@ -223,6 +259,7 @@ bool ShmRendererPrivate::remapShm()
 
       if (m_pShmArea == MAP_FAILED) {
          qDebug() << "Could not remap shared area: " << strerror(errno);
+         m_ShmAreaLen = 0;
          return false;
       }
 
@@ -230,11 +267,98 @@ bool ShmRendererPrivate::remapShm()
          return false;
 
       m_ShmAreaLen = mapSize;
+      q_ptr->Video::Renderer::d_ptr->shmRemapped();
    }
 
    return true;
 }
 
+/*****************************************************************************
+ *                                                                           *
+ *                               Frame waiter                                *
+ *                                                                           *
+ ****************************************************************************/
+
+ShmFrameWaiter::ShmFrameWaiter(ShmRenderer* renderer, RendererPrivate* stats, int fd) : QThread(nullptr),
+m_pRenderer(renderer), m_pStats(stats), m_pHeader((SHMHeader*)MAP_FAILED), m_Running(false)
+{
+   // The header never move, map it once for the lifetime of the waiter
+   m_pHeader = (SHMHeader*) ::mmap(nullptr, sizeof(SHMHeader),
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0
+   );
+
+   if (m_pHeader == MAP_FAILED)
+      qDebug() << "Could not map shared area header: " << strerror(errno);
+   else
+      m_Running = true;
+}
+
+ShmFrameWaiter::~ShmFrameWaiter()
+{
+   stop();
+
+   if (m_pHeader != MAP_FAILED)
+      ::munmap(m_pHeader, sizeof(SHMHeader));
+}
+
+/// Ask the waiter to exit and wait until it does
+void ShmFrameWaiter::stop()
+{
+   if (m_Running.exchange(false) && m_pHeader != MAP_FAILED) {
+      // Wake up the thread now rather than waiting for the timeout. The
+      // extra post is harmless, the frameGen is always compared.
+      ::sem_post(&m_pHeader->frameGenMutex);
+   }
+
+   wait();
+}
+
+void ShmFrameWaiter::run()
+{
+   if (m_pHeader == MAP_FAILED)
+      return;
+
+   unsigned lastGen = 0;
+
+   while (m_Running) {
+      const timespec timeout = ShmRendererPrivate::createTimeout(
+         ShmRendererPrivate::FRAME_WAIT_MS
+      );
+
+      if (::sem_timedwait(&m_pHeader->frameGenMutex, &timeout) < 0) {
+         if (errno == ETIMEDOUT || errno == EINTR)
+            continue;
+
+         qDebug() << "Waiting for a new frame failed: " << strerror(errno);
+         break;
+      }
+
+      // The header has no timestamp, the daemon posts frameGenMutex as soon
+      // as the frame is published. Take the time before contending on the
+      // header mutex so the client side delays are part of the latency.
+      const qint64 postedAt = RendererPrivate::now();
+
+      if (!m_Running)
+         break;
+
+      if (::sem_wait(&m_pHeader->mutex) < 0)
+         continue;
+
+      const unsigned gen  = m_pHeader->frameGen ;
+      const unsigned size = m_pHeader->frameSize;
+
+      ::sem_post(&m_pHeader->mutex);
+
+      // Only notify when the daemon really produced something new
+      if (size && gen != lastGen) {
+         lastGen = gen;
+         m_pStats->frameProduced(postedAt);
+         emit m_pRenderer->frameUpdated();
+      }
+   }
+}
+
 /// Connect to the shared memory
 bool ShmRenderer::startShm()
 {
@@ -273,10 +397,8 @@ void ShmRenderer::stopShm()
    if (d_ptr->m_fd < 0)
       return;
 
-   if (d_ptr->m_pTimer) {
-      d_ptr->m_pTimer->stop();
-      d_ptr->m_pTimer = nullptr;
-   }
+   // The waiter has to be gone before the file and mapping are released
+   d_ptr->stopWaiter();
 
    // reset the frame so it doesn't point to an old value
    Video::Renderer::d_ptr->m_pFrame.reset();
@@ -293,19 +415,41 @@ void ShmRenderer::stopShm()
 
    ::munmap(d_ptr->m_pShmArea, d_ptr->m_ShmAreaLen);
    d_ptr->m_ShmAreaLen = 0;
+   d_ptr->m_FrameGen   = 0;
    d_ptr->m_pShmArea = (SHMHeader*) MAP_FAILED;
 }
 
+/**
+ * Join the frame waiter thread.
+ *
+ * This must not be called with mutex() held, the slots directly connected
+ * to frameUpdated() run in the waiter thread and can block on it.
+ */
+void ShmRendererPrivate::stopWaiter()
+{
+   if (!m_pWaiter)
+      return;
+
+   m_pWaiter->stop();
+   delete m_pWaiter;
+   m_pWaiter = nullptr;
+}
+
 /// Lock the memory while the copy is being made
 bool ShmRendererPrivate::shmLock()
 {
-   return ::sem_wait(&m_pShmArea->mutex) >= 0;
+   if (::sem_wait(&m_pShmArea->mutex) < 0)
+      return false;
+
+   m_LockedAt = RendererPrivate::now();
+   return true;
 }
 
 /// Remove the lock, allow a new frame to be drawn
 void ShmRendererPrivate::shmUnlock()
 {
    ::sem_post(&m_pShmArea->mutex);
+   q_ptr->Video::Renderer::d_ptr->lockReleased(RendererPrivate::now() - m_LockedAt);
 }
 
 /*****************************************************************************
@@ -324,15 +468,12 @@ void ShmRenderer::startRendering()
 
    Video::Renderer::d_ptr->m_isRendering = true;
 
-   if (!d_ptr->m_pTimer) {
-      d_ptr->m_pTimer = new QTimer(this);
-      d_ptr->m_pTimer->setInterval(33);
-      connect(d_ptr->m_pTimer,&QTimer::timeout,[this]() {
-         emit this->frameUpdated();
-      });
+   // frameUpdated() is emitted by the waiter each time the daemon
+   // increments the frameGen
+   if (!d_ptr->m_pWaiter) {
+      d_ptr->m_pWaiter = new ShmFrameWaiter(this, Video::Renderer::d_ptr, d_ptr->m_fd);
+      d_ptr->m_pWaiter->start();
    }
-   //FIXME This is a temporary hack as frameUpdated() is no longer emitted
-   d_ptr->m_pTimer->start();
 
    emit started();
 }
@@ -340,14 +481,12 @@ void ShmRenderer::startRendering()
 /// Stop the rendering loop
 void ShmRenderer::stopRendering()
 {
+   // Join the waiter before locking, it may be emitting frameUpdated()
+   d_ptr->stopWaiter();
+
    QMutexLocker locker {mutex()};
    Video::Renderer::d_ptr->m_isRendering = false;
 
-   if (d_ptr->m_pTimer) {
-      d_ptr->m_pTimer->stop();
-      d_ptr->m_pTimer = nullptr;
-   }
-
    stopShm();
 }
 
@@ -360,7 +499,7 @@ void ShmRenderer::stopRendering()
 /// Get the current frame rate of this renderer
 int ShmRenderer::fps() const
 {
-   return d_ptr->m_Fps;
+   return qRound(statistics().fps);
 }
 
 /// Get frame data pointer from shared memory
@@ -377,6 +516,33 @@ Frame ShmRenderer::currentFrame() const
     return {};
 }
 
+/**
+ * Get a copy of the current frame.
+ *
+ * The SHM path always copies. The daemon owns the double buffer and reuses
+ * the readable region for the frame after the next one, so it cannot be
+ * pinned from here. The frame is copied while the shared memory is locked.
+ *
+ * The copy is made in the buffer of the previous lease once the client
+ * released it, so there is no allocation per frame.
+ */
+FrameLease ShmRenderer::leaseFrame() const
+{
+    if (not isRendering())
+        return {};
+
+    QMutexLocker lk {mutex()};
+
+    auto& lease = d_ptr->m_pLease;
+    if ((!lease) || lease.use_count() > 1)
+        lease = std::make_shared<Frame>();
+
+    if (not d_ptr->getNewFrame(false, lease.get()))
+        return {};
+
+    return lease;
+}
+
 Video::Renderer::ColorSpace ShmRenderer::colorSpace() const
 {
    return Video::Renderer::ColorSpace::BGRA;
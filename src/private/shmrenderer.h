@@ -55,6 +55,7 @@ public:
    //Getters
    int fps() const;
    virtual Frame currentFrame() const override;
+   virtual FrameLease leaseFrame() const override;
    virtual ColorSpace colorSpace  () const override;
 
    //Setters
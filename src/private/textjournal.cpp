@@ -0,0 +1,418 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "textjournal.h"
+
+//Qt
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+//Ring
+#include "private/threadworker.h"
+
+//libSTDC++
+#include <functional>
+
+namespace {
+
+/// Protect the files, the compaction runs on a worker thread
+QMutex& mutex()
+{
+   static QMutex m;
+   return m;
+}
+
+/// Incremented each time a full snapshot is written, a compaction started
+/// before it is outdated
+QHash<QByteArray,int>& generations()
+{
+   static QHash<QByteArray,int> g;
+   return g;
+}
+
+/// The conversations being compacted
+QSet<QByteArray>& inFlight()
+{
+   static QSet<QByteArray> s;
+   return s;
+}
+
+QString snapshotPath(const QString& dir, const QByteArray& sha1)
+{
+   return QStringLiteral("%1/%2.json").arg(dir, QString(sha1));
+}
+
+QString journalPath(const QString& dir, const QByteArray& sha1)
+{
+   return QStringLiteral("%1/%2.journal").arg(dir, QString(sha1));
+}
+
+QString compactingPath(const QString& dir, const QByteArray& sha1)
+{
+   return QStringLiteral("%1/%2.journal.compacting").arg(dir, QString(sha1));
+}
+
+QString metadataPath(const QString& dir, const QByteArray& sha1)
+{
+   return QStringLiteral("%1/%2.meta").arg(dir, QString(sha1));
+}
+
+QByteArray readAll(const QString& path)
+{
+   QFile file(path);
+
+   if (!file.open(QIODevice::ReadOnly))
+      return {};
+
+   return file.readAll();
+}
+
+bool saveFile(const QString& path, const QByteArray& content)
+{
+   QSaveFile file(path);
+
+   if (!file.open(QIODevice::WriteOnly)) {
+      qWarning() << "Unable to save" << path << file.errorString();
+      return false;
+   }
+
+   file.write(content);
+
+   return file.commit();
+}
+
+///If the metadata was written after the last change to the conversation
+bool isMetadataCurrent(const QString& dir, const QByteArray& sha1)
+{
+   const QFileInfo info(metadataPath(dir, sha1));
+
+   return info.exists()
+      && info.lastModified().toMSecsSinceEpoch() >= TextJournal::lastModified(dir, sha1);
+}
+
+QByteArray record(const char* op, int group, int message, const QJsonObject& data)
+{
+   QJsonObject r;
+   r[ QStringLiteral("op")    ] = QLatin1String(op);
+   r[ QStringLiteral("group") ] = group;
+
+   if (message >= 0)
+      r[ QStringLiteral("message") ] = message;
+
+   r[ QStringLiteral("data")  ] = data;
+
+   return QJsonDocument(r).toJson(QJsonDocument::Compact);
+}
+
+}
+
+QByteArray TextJournal::groupRecord(int group, const QJsonObject& data)
+{
+   return record("group", group, -1, data);
+}
+
+QByteArray TextJournal::messageRecord(int group, int message, const QJsonObject& data)
+{
+   return record("message", group, message, data);
+}
+
+QByteArray TextJournal::updateRecord(int group, int message, const QJsonObject& data)
+{
+   return record("update", group, message, data);
+}
+
+/**
+ * Apply the records of "journal" to a conversation snapshot.
+ *
+ * The group messages are detached from the document while the records are
+ * applied, otherwise each record would copy the whole conversation.
+ */
+void TextJournal::replay(QJsonObject& root, const QByteArray& journal)
+{
+   if (journal.isEmpty())
+      return;
+
+   QVector<QJsonObject> groups  ;
+   QVector<QJsonArray>  messages;
+
+   const QJsonArray g = root.take(QStringLiteral("groups")).toArray();
+
+   for (const QJsonValue& v : g) {
+      QJsonObject group = v.toObject();
+      messages << group.take(QStringLiteral("messages")).toArray();
+      groups   << group;
+   }
+
+   int start = 0;
+
+   while (start < journal.size()) {
+      int end = journal.indexOf('\n', start);
+
+      if (end == -1)
+         end = journal.size();
+
+      const QByteArray line = journal.mid(start, end - start);
+      start = end + 1;
+
+      if (line.trimmed().isEmpty())
+         continue;
+
+      QJsonParseError err;
+      const QJsonObject r = QJsonDocument::fromJson(line, &err).object();
+
+      // Most likely the last record was interrupted
+      if (err.error != QJsonParseError::NoError) {
+         qWarning() << "Ignoring a damaged text recording journal record" << err.errorString();
+         continue;
+      }
+
+      const QString     op      = r[ QStringLiteral("op")      ].toString();
+      const int         group   = r[ QStringLiteral("group")   ].toInt(-1);
+      const int         message = r[ QStringLiteral("message") ].toInt(-1);
+      const QJsonObject data    = r[ QStringLiteral("data")    ].toObject();
+
+      if (op == QLatin1String("group")) {
+         if (group == groups.size()) {
+            QJsonObject newGroup = data;
+            messages << newGroup.take(QStringLiteral("messages")).toArray();
+            groups   << newGroup;
+         }
+         continue;
+      }
+
+      if (group < 0 || group >= groups.size())
+         continue;
+
+      QJsonArray& msgs = messages[group];
+
+      if (op == QLatin1String("message")) {
+         if (message == msgs.size())
+            msgs.append(data);
+      }
+      else if (op == QLatin1String("update")) {
+         if (message >= 0 && message < msgs.size()) {
+            QJsonObject m = msgs[message].toObject();
+
+            for (auto i = data.constBegin(); i != data.constEnd(); ++i)
+               m[i.key()] = i.value();
+
+            msgs[message] = m;
+         }
+      }
+   }
+
+   QJsonArray merged;
+
+   for (int i = 0; i < groups.size(); i++) {
+      groups[i][QStringLiteral("messages")] = messages[i];
+      merged.append(groups[i]);
+   }
+
+   root[QStringLiteral("groups")] = merged;
+}
+
+///Load a conversation snapshot with its journals applied
+QJsonObject TextJournal::load(const QString& dir, const QByteArray& sha1, bool* ok)
+{
+   QByteArray snapshot, compacting, journal;
+
+   {
+      QMutexLocker lk(&mutex());
+      snapshot   = readAll(snapshotPath  (dir, sha1));
+      compacting = readAll(compactingPath(dir, sha1));
+      journal    = readAll(journalPath   (dir, sha1));
+   }
+
+   QJsonParseError err;
+   QJsonDocument doc = QJsonDocument::fromJson(snapshot, &err);
+
+   if (ok)
+      *ok = err.error == QJsonParseError::NoError && doc.isObject();
+
+   if (err.error != QJsonParseError::NoError) {
+      qWarning() << "Error Decoding Text Message History Json" << sha1 << err.errorString();
+      return {};
+   }
+
+   QJsonObject root = doc.object();
+
+   replay(root, compacting);
+   replay(root, journal   );
+
+   return root;
+}
+
+///Replace the snapshot, the journals are discarded
+bool TextJournal::writeSnapshot(const QString& dir, const QByteArray& sha1, const QByteArray& json)
+{
+   QMutexLocker lk(&mutex());
+
+   generations()[sha1]++;
+
+   if (!saveFile(snapshotPath(dir, sha1), json))
+      return false;
+
+   QFile::remove(journalPath   (dir, sha1));
+   QFile::remove(compactingPath(dir, sha1));
+
+   return true;
+}
+
+/**
+ * Append records to the journal. If it become too large, it is merged
+ * into the snapshot in the background.
+ */
+bool TextJournal::append(const QString& dir, const QByteArray& sha1, const QList<QByteArray>& records)
+{
+   QMutexLocker lk(&mutex());
+
+   QFile file(journalPath(dir, sha1));
+
+   if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      qWarning() << "Unable to save the text recording journal" << file.errorString();
+      return false;
+   }
+
+   QByteArray content;
+
+   for (const QByteArray& r : records)
+      content += r + '\n';
+
+   const bool written = file.write(content) == content.size();
+   const qint64 size  = file.size();
+
+   file.close();
+
+   const qint64 snapshotSize = QFileInfo(snapshotPath(dir, sha1)).size();
+
+   if (size < COMPACTION_MIN_SIZE || size < snapshotSize / 2 || inFlight().contains(sha1))
+      return written;
+
+   // A previous compaction was interrupted, merge into it
+   if (QFile::exists(compactingPath(dir, sha1))) {
+      QFile compacting(compactingPath(dir, sha1));
+
+      if (!compacting.open(QIODevice::WriteOnly | QIODevice::Append))
+         return written;
+
+      compacting.write(readAll(journalPath(dir, sha1)));
+      compacting.close();
+      QFile::remove(journalPath(dir, sha1));
+   }
+   else if (!QFile::rename(journalPath(dir, sha1), compactingPath(dir, sha1)))
+      return written;
+
+   inFlight() << sha1;
+
+   new ThreadWorker([dir, sha1]() {
+      compact(dir, sha1);
+   });
+
+   return written;
+}
+
+///Merge the ".compacting" journal into the snapshot, runs on a worker thread
+void TextJournal::compact(const QString& dir, const QByteArray& sha1)
+{
+   QByteArray snapshot, journal;
+   int        generation;
+
+   {
+      QMutexLocker lk(&mutex());
+      generation = generations().value(sha1);
+      snapshot   = readAll(snapshotPath  (dir, sha1));
+      journal    = readAll(compactingPath(dir, sha1));
+   }
+
+   QJsonParseError err;
+   const QJsonDocument doc = QJsonDocument::fromJson(snapshot, &err);
+
+   QByteArray merged;
+
+   if (err.error == QJsonParseError::NoError) {
+      QJsonObject root = doc.object();
+      replay(root, journal);
+      merged = QJsonDocument(root).toJson();
+   }
+
+   QMutexLocker lk(&mutex());
+
+   inFlight().remove(sha1);
+
+   // A full snapshot was written meanwhile, it already contains everything
+   if (merged.isEmpty() || generation != generations().value(sha1))
+      return;
+
+   // The content didn't change, the metadata is still valid
+   const bool metadataCurrent = isMetadataCurrent(dir, sha1);
+
+   if (!saveFile(snapshotPath(dir, sha1), merged))
+      return;
+
+   QFile::remove(compactingPath(dir, sha1));
+
+   if (metadataCurrent)
+      saveFile(metadataPath(dir, sha1), readAll(metadataPath(dir, sha1)));
+}
+
+///The last time the conversation was modified, in msecs since epoch
+qint64 TextJournal::lastModified(const QString& dir, const QByteArray& sha1)
+{
+   qint64 ret = 0;
+
+   for (const QString& path : {snapshotPath(dir, sha1), journalPath(dir, sha1), compactingPath(dir, sha1)}) {
+      const QFileInfo info(path);
+
+      if (info.exists())
+         ret = qMax(ret, info.lastModified().toMSecsSinceEpoch());
+   }
+
+   return ret;
+}
+
+///The conversation metadata, empty if it is missing or outdated
+QJsonObject TextJournal::metadata(const QString& dir, const QByteArray& sha1)
+{
+   QByteArray content;
+
+   {
+      QMutexLocker lk(&mutex());
+
+      if (!isMetadataCurrent(dir, sha1))
+         return {};
+
+      content = readAll(metadataPath(dir, sha1));
+   }
+
+   return QJsonDocument::fromJson(content).object();
+}
+
+///Write the metadata, it has to be done after the conversation is saved
+bool TextJournal::writeMetadata(const QString& dir, const QByteArray& sha1, const QJsonObject& metadata)
+{
+   QMutexLocker lk(&mutex());
+
+   return saveFile(metadataPath(dir, sha1), QJsonDocument(metadata).toJson(QJsonDocument::Compact));
+}
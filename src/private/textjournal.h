@@ -0,0 +1,71 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//Qt
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+/**
+ * Storage of the text recordings as a snapshot and a journal.
+ *
+ * Each conversation (Serializable::Peers) is stored as a json snapshot in
+ * "<sha1>.json" and a journal of the changes made since the snapshot in
+ * "<sha1>.journal". The journal has one compact json record per line:
+ *
+ *    {"op":"group"  ,"group":g,             "data":{group without messages}}
+ *    {"op":"message","group":g,"message":i, "data":{message}               }
+ *    {"op":"update" ,"group":g,"message":i, "data":{changed fields}        }
+ *
+ * Positions are explicit, replaying a record twice has no effect. This way
+ * a journal which was already merged into the snapshot when the application
+ * was interrupted can safely be replayed again.
+ *
+ * Once the journal become large compared to the snapshot, it is renamed to
+ * "<sha1>.journal.compacting" and merged into a new snapshot by a worker
+ * thread while the new records keep being appended to a new journal.
+ *
+ * When the conversations are loaded by pages, a small "<sha1>.meta" file
+ * describes each of them so they can be listed without being parsed. It is
+ * ignored once older than the snapshot or the journals.
+ */
+class TextJournal final
+{
+public:
+   //Records
+   static QByteArray groupRecord  ( int group,              const QJsonObject& data );
+   static QByteArray messageRecord( int group, int message, const QJsonObject& data );
+   static QByteArray updateRecord ( int group, int message, const QJsonObject& data );
+
+   //Storage
+   static QJsonObject load         ( const QString& dir, const QByteArray& sha1, bool* ok = nullptr );
+   static bool        writeSnapshot( const QString& dir, const QByteArray& sha1, const QByteArray& json );
+   static bool        append       ( const QString& dir, const QByteArray& sha1, const QList<QByteArray>& records );
+   static qint64      lastModified ( const QString& dir, const QByteArray& sha1 );
+
+   //Metadata
+   static QJsonObject metadata     ( const QString& dir, const QByteArray& sha1 );
+   static bool        writeMetadata( const QString& dir, const QByteArray& sha1, const QJsonObject& metadata );
+
+private:
+   constexpr static const int COMPACTION_MIN_SIZE = 64 * 1024;
+
+   static void compact(const QString& dir, const QByteArray& sha1);
+   static void replay (QJsonObject& root, const QByteArray& journal);
+};
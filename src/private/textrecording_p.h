@@ -46,6 +46,9 @@ namespace Media {
  */
 namespace Serializable {
 
+class Group;
+class Peers;
+
 class Payload {
 public:
    QString payload;
@@ -62,6 +65,12 @@ public:
       STATUS, /*!< "Room status" message, such as new participants or participants that left */
    };
 
+   ///A link in the plain text payload
+   struct LinkSpan {
+      int start ;
+      int length;
+   };
+
    ///The time associated with this message
    time_t                  timestamp ;
    ///A group of alternate payloads (mimetype as key)
@@ -88,11 +97,23 @@ public:
    QString m_HTML;
    QString m_FormattedHtml;
    QList<QUrl> m_LinkList;
-   bool    m_HasText;
+   bool    m_HasText {false};
+
+   ///The links of m_PlainText, they are saved once detected
+   QVector<LinkSpan> m_lLinkSpans;
+   bool              m_LinksDetected {false};
+
+   ///Position in the conversation, used by the journal
+   Group*  m_pGroup {nullptr};
+   int     m_Index  {  -1   };
 
    void read (const QJsonObject &json);
    void write(QJsonObject       &json) const;
    const QString& getFormattedHtml();
+   const QList<QUrl>& linkList();
+   void detectLinks();
+
+   static QVector<LinkSpan> findLinks(const QString& text, const QRegularExpression& re);
 };
 
 class Peer {
@@ -124,6 +145,10 @@ public:
    int nextGroupId;
    ///The account used for this conversation
 
+   ///Position in the conversation, used by the journal
+   Peers* m_pPeers {nullptr};
+   int    m_Index  {  -1   };
+
    void read (const QJsonObject &json, const QHash<QString,ContactMethod*> sha1s);
    void write(QJsonObject       &json) const;
 };
@@ -139,15 +164,33 @@ public:
    ///Information about every (non self) peer involved in this group
    QList<Peer*> peers;
 
-   ///This attribute store if the file has changed
+   ///If a full snapshot need to be written, otherwise the journal is used
    bool hasChanged;
 
+   ///False when only the metadata was read, the groups are read on demand
+   bool isLoaded {true};
+
    ///Keep a cache of the peers sha1
    QHash<QString,ContactMethod*> m_hSha1;
 
+   ///The journal records not saved yet
+   QList<QByteArray> m_lJournal;
+
    void read (const QJsonObject &json);
    void write(QJsonObject       &json) const;
 
+   //Metadata
+   void readHeader   (const QJsonObject &json);
+   void readGroups   (const QJsonObject &json);
+   void writeHeader  (QJsonObject       &json) const;
+   void writeMetadata(QJsonObject       &json) const;
+
+   //Journal
+   void addGroup     (Group*   group  );
+   void addMessage   (Group*   group, Message* message);
+   static void messageChanged(const Message* message);
+   static void linksDetected (const Message* message);
+
 private:
    Peers() : hasChanged(false) {}
 };
@@ -177,12 +220,26 @@ public:
    QAbstractItemModel*         m_pTextMessagesModel {nullptr};
    QAbstractItemModel*         m_pUnreadTextMessagesModel {nullptr};
    QHash<uint64_t, TextMessageNode*> m_hPendingMessages;
+   QVector<Serializable::Message*> m_lOlder   ; /*!< Not in the model yet, oldest first */
+   bool                        m_IsPartial     {false}; /*!< Only the metadata was read */
+   int                         m_UnloadedCount {0    }; /*!< Messages not read yet      */
+   int                         m_LinkGeneration{0    }; /*!< Incremented when cleared   */
 
    //Helper
+   void materialize  (                       );
+   void queueMessages( const ContactMethod* cm );
+   void loadFirstPage(                       );
+   int  loadOlder    ( int count             );
+   void clearMessages(                       );
+   void detectLinks  ( const QVector<Serializable::Message*>& messages );
+   void applyLinks   ( const QVector<Serializable::Message*>& messages,
+                       const QVector<QVector<Serializable::Message::LinkSpan>>& spans, int generation );
    void insertNewMessage(const QMap<QString,QString>& message, ContactMethod* cm, Media::Media::Direction direction, uint64_t id = 0);
    QHash<QByteArray,QByteArray> toJsons() const;
-   void accountMessageStatusChanged(const uint64_t id, DRing::Account::MessageStates status);
+   QHash<QByteArray,QList<QByteArray>> takeJournals() const;
+   bool accountMessageStatusChanged(const uint64_t id, DRing::Account::MessageStates status);
    bool updateMessageStatus(Serializable::Message* m, TextRecording::Status status);
+   static bool isFinalStatus(TextRecording::Status status);
 
    void clear();
 
@@ -204,6 +261,7 @@ public:
    static Serializable::Peers* peers(QList<const ContactMethod*> cms);
    static Serializable::Peers* fromSha1(const QByteArray& sha1);
    static Serializable::Peers* fromJson(const QJsonObject& obj, const ContactMethod* cm = nullptr);
+   static Serializable::Peers* fromMetadata(const QJsonObject& obj);
 private:
    static QHash<QByteArray,Serializable::Peers*> m_hPeers;
 };
@@ -244,6 +302,8 @@ public:
    virtual Qt::ItemFlags flags    ( const QModelIndex& index                                 ) const override;
    virtual bool  setData  ( const QModelIndex& index, const QVariant &value, int role)       override;
    virtual QHash<int,QByteArray> roleNames() const override;
+   virtual bool  canFetchMore( const QModelIndex& parent                                ) const override;
+   virtual void  fetchMore   ( const QModelIndex& parent                                )       override;
 
    void clear();
 
@@ -253,4 +313,6 @@ public:
    //Helper
    void addRowBegin();
    void addRowEnd();
+   void prependRowsBegin(int count);
+   void prependRowsEnd();
 };
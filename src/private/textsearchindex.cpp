@@ -0,0 +1,573 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "textsearchindex.h"
+
+//Qt
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+
+//Ring
+#include "private/textjournal.h"
+#include "private/threadworker.h"
+
+//libSTDC++
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+constexpr const quint32 MAGIC   = 0x52545349; // "RTSI"
+constexpr const quint16 VERSION = 1;
+
+}
+
+///The text/plain payload of a serialized message (see Serializable::Message)
+QString TextSearchIndex::plainText(const QJsonObject& message)
+{
+   const QJsonArray payloads = message[QStringLiteral("payloads")].toArray();
+
+   for (const QJsonValue& v : payloads) {
+      const QJsonObject payload = v.toObject();
+
+      if (payload[QStringLiteral("mimeType")].toString() == QLatin1String("text/plain"))
+         return payload[QStringLiteral("payload")].toString();
+   }
+
+   //Older conversations had a single payload
+   return message[QStringLiteral("payload")].toString();
+}
+
+TextSearchIndex& TextSearchIndex::instance()
+{
+   static TextSearchIndex index;
+   return index;
+}
+
+QString TextSearchIndex::snapshotPath() const
+{
+   return m_Dir + QStringLiteral("/search.index");
+}
+
+QString TextSearchIndex::logPath() const
+{
+   return m_Dir + QStringLiteral("/search.log");
+}
+
+///The log being merged into the snapshot, see compact()
+QString TextSearchIndex::oldLogPath() const
+{
+   return m_Dir + QStringLiteral("/search.log.old");
+}
+
+///Identify a message, there is at most 2^20 groups and messages per group
+quint64 TextSearchIndex::key(const Posting& p)
+{
+   return (static_cast<quint64>(p.conversation         ) << 40)
+        | (static_cast<quint64>(p.group   & 0xFFFFF    ) << 20)
+        |  static_cast<quint64>(p.message & 0xFFFFF    );
+}
+
+///Split "text" into lower case words, each word is only returned once
+QStringList TextSearchIndex::tokenize(const QString& text)
+{
+   QStringList   ret;
+   QSet<QString> seen;
+   QString       current;
+
+   const auto flush = [&]() {
+      if (current.size() >= MIN_TOKEN_SIZE && !seen.contains(current)) {
+         seen << current;
+         ret  << current;
+      }
+      current.clear();
+   };
+
+   for (const QChar c : text) {
+      if (c.isLetterOrNumber()) {
+         if (current.size() < MAX_TOKEN_SIZE)
+            current += c.toLower();
+      }
+      else
+         flush();
+   }
+
+   flush();
+
+   return ret;
+}
+
+int TextSearchIndex::conversation(const QByteArray& sha1)
+{
+   const auto i = m_hConversations.constFind(sha1);
+
+   if (i != m_hConversations.constEnd())
+      return i.value();
+
+   m_lConversations << sha1;
+   m_hConversations[sha1] = m_lConversations.size() - 1;
+
+   return m_lConversations.size() - 1;
+}
+
+///Add the postings of a message, unless it is already indexed
+bool TextSearchIndex::insert(const Posting& p, const QStringList& tokens)
+{
+   const quint64 k = key(p);
+
+   if (m_lIndexed.contains(k))
+      return false;
+
+   m_lIndexed << k;
+
+   for (const QString& token : tokens)
+      m_mTokens[token] << p;
+
+   return true;
+}
+
+///Load the snapshot and the log, the mutex has to be locked
+void TextSearchIndex::open()
+{
+   if (m_IsOpen || m_Dir.isEmpty())
+      return;
+
+   m_IsOpen = true;
+
+   readSnapshot();
+
+   // A compaction was interrupted, the old log may not be in the snapshot
+   readLog(oldLogPath());
+   readLog(logPath());
+}
+
+bool TextSearchIndex::readSnapshot()
+{
+   QFile file(snapshotPath());
+
+   if (!file.open(QIODevice::ReadOnly))
+      return false;
+
+   QDataStream stream(&file);
+   stream.setVersion(QDataStream::Qt_5_0);
+
+   quint32 magic;
+   quint16 version;
+   stream >> magic >> version;
+
+   if (magic != MAGIC || version != VERSION) {
+      qWarning() << "Ignoring an incompatible text search index" << file.fileName();
+      return false;
+   }
+
+   QVector<QByteArray> conversations;
+   QSet<QByteArray>    built;
+   quint32             tokenCount;
+
+   stream >> conversations >> built >> tokenCount;
+
+   QMap<QString,QVector<Posting>> tokens;
+   QSet<quint64>                  indexed;
+
+   for (quint32 i = 0; i < tokenCount && stream.status() == QDataStream::Ok; i++) {
+      QString token;
+      quint32 count;
+      stream >> token >> count;
+
+      QVector<Posting>& postings = tokens[token];
+      postings.reserve(count);
+
+      for (quint32 j = 0; j < count && stream.status() == QDataStream::Ok; j++) {
+         qint32 conversation, group, message;
+         qint64 timestamp;
+         stream >> conversation >> group >> message >> timestamp;
+
+         const Posting p { conversation, group, message, timestamp };
+         postings << p;
+         indexed  << key(p);
+      }
+   }
+
+   // The messages will be indexed again
+   if (stream.status() != QDataStream::Ok) {
+      qWarning() << "The text search index is damaged" << file.fileName();
+      return false;
+   }
+
+   m_lConversations = conversations;
+   m_lBuilt         = built;
+   m_mTokens        = tokens;
+   m_lIndexed       = indexed;
+
+   m_hConversations.clear();
+   for (int i = 0; i < m_lConversations.size(); i++)
+      m_hConversations[m_lConversations[i]] = i;
+
+   return true;
+}
+
+///Replay a log, a record interrupted by a crash is truncated
+void TextSearchIndex::readLog(const QString& path)
+{
+   QFile file(path);
+
+   if (!(file.exists() && file.open(QIODevice::ReadWrite)))
+      return;
+
+   QDataStream stream(&file);
+   stream.setVersion(QDataStream::Qt_5_0);
+
+   qint64 pos = 0;
+
+   while (!stream.atEnd()) {
+      quint8      type;
+      QByteArray  sha1;
+      qint32      group, message;
+      qint64      timestamp;
+      QStringList tokens;
+
+      stream >> type >> sha1 >> group >> message >> timestamp >> tokens;
+
+      if (stream.status() != QDataStream::Ok || type != static_cast<quint8>(RecordType::MESSAGE))
+         break;
+
+      insert({ conversation(sha1), group, message, timestamp }, tokens);
+
+      m_LogRecords++;
+      pos = file.pos();
+   }
+
+   if (pos != file.size()) {
+      qWarning() << "Truncating the damaged end of the text search log";
+      file.resize(pos);
+   }
+}
+
+/**
+ * Copy the index and move the log aside, the mutex has to be locked.
+ *
+ * The copy is cheap, the containers are implicitly shared. From now on the
+ * new messages are logged to a new file, the old one is only removed once
+ * the snapshot is committed. If a previous snapshot failed, the log is
+ * appended to the old one instead.
+ */
+bool TextSearchIndex::beginSnapshot(Snapshot& snapshot)
+{
+   if (m_IsWriting)
+      return false;
+
+   if (QFile::exists(logPath())) {
+      if (QFile::exists(oldLogPath())) {
+         QFile log(logPath()), old(oldLogPath());
+
+         if (!(log.open(QIODevice::ReadOnly) && old.open(QIODevice::WriteOnly | QIODevice::Append)
+          && old.write(log.readAll()) == log.size()))
+            return false;
+
+         log.remove();
+      }
+      else if (!QFile::rename(logPath(), oldLogPath()))
+         return false;
+   }
+
+   m_IsWriting  = true;
+   m_LogRecords = 0;
+
+   snapshot = {
+      snapshotPath(), m_Generation, m_lConversations, m_lBuilt, m_mTokens
+   };
+
+   return true;
+}
+
+/**
+ * Write the whole index and discard the old log, without holding the mutex.
+ *
+ * Nothing is committed if the index was cleared meanwhile.
+ */
+bool TextSearchIndex::writeSnapshot(const Snapshot& snapshot)
+{
+   QSaveFile file(snapshot.path);
+
+   if (file.open(QIODevice::WriteOnly)) {
+      QDataStream stream(&file);
+      stream.setVersion(QDataStream::Qt_5_0);
+
+      stream << MAGIC << VERSION << snapshot.conversations << snapshot.built
+             << static_cast<quint32>(snapshot.tokens.size());
+
+      for (auto i = snapshot.tokens.constBegin(); i != snapshot.tokens.constEnd(); ++i) {
+         stream << i.key() << static_cast<quint32>(i.value().size());
+
+         for (const Posting& p : i.value())
+            stream << static_cast<qint32>(p.conversation) << static_cast<qint32>(p.group)
+                   << static_cast<qint32>(p.message     ) << p.timestamp;
+      }
+   }
+   else
+      qWarning() << "Unable to save the text search index" << file.errorString();
+
+   QMutexLocker lk(&m_Mutex);
+
+   m_IsWriting = false;
+
+   if (snapshot.generation != m_Generation) {
+      file.cancelWriting();
+      return false;
+   }
+
+   // The old log is kept and merged by the next snapshot
+   if (!file.commit())
+      return false;
+
+   QFile::remove(oldLogPath());
+
+   return true;
+}
+
+///Merge the log into the snapshot on a worker, the mutex has to be locked
+void TextSearchIndex::compact()
+{
+   Snapshot snapshot;
+
+   if (!beginSnapshot(snapshot))
+      return;
+
+   new ThreadWorker([this, snapshot]() {
+      writeSnapshot(snapshot);
+   });
+}
+
+/**
+ * Log a message already inserted in the index. When the log is compacted,
+ * the message is part of the snapshot but it is still logged in case the
+ * snapshot can't be written.
+ */
+void TextSearchIndex::appendLog(const QByteArray& sha1, const Posting& p, const QStringList& tokens)
+{
+   if (++m_LogRecords >= COMPACTION_RECORDS)
+      compact();
+
+   QFile file(logPath());
+
+   if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      qWarning() << "Unable to save the text search log" << file.errorString();
+      return;
+   }
+
+   QDataStream stream(&file);
+   stream.setVersion(QDataStream::Qt_5_0);
+
+   stream << static_cast<quint8>(RecordType::MESSAGE) << sha1 << static_cast<qint32>(p.group)
+          << static_cast<qint32>(p.message) << p.timestamp << tokens;
+}
+
+/**
+ * Open the index stored in "dir" and index the conversations it doesn't
+ * contain yet, this is done on a worker thread.
+ */
+void TextSearchIndex::build(const QString& dir)
+{
+   int generation;
+
+   {
+      QMutexLocker lk(&m_Mutex);
+
+      if (!m_Dir.isEmpty())
+         return;
+
+      m_Dir      = dir;
+      generation = m_Generation;
+   }
+
+   new ThreadWorker([this, dir, generation]() {
+      QList<QByteArray> todo;
+
+      {
+         QMutexLocker lk(&m_Mutex);
+         open();
+
+         for (const QFileInfo& info : QDir(dir).entryInfoList({QStringLiteral("*.json")}, QDir::Files)) {
+            const QByteArray sha1 = info.completeBaseName().toLatin1();
+
+            if (!m_lBuilt.contains(sha1))
+               todo << sha1;
+         }
+      }
+
+      bool changed = false;
+
+      for (const QByteArray& sha1 : todo) {
+         bool ok = false;
+         const QJsonObject root = TextJournal::load(dir, sha1, &ok);
+
+         if (!ok)
+            continue;
+
+         // Tokenize without holding the lock
+         QVector<QPair<Posting,QStringList>> messages;
+
+         const QJsonArray groups = root[QStringLiteral("groups")].toArray();
+
+         for (int g = 0; g < groups.size(); g++) {
+            const QJsonArray msgs = groups[g].toObject()[QStringLiteral("messages")].toArray();
+
+            for (int m = 0; m < msgs.size(); m++) {
+               const QJsonObject message = msgs[m].toObject();
+               const QStringList tokens  = tokenize(plainText(message));
+
+               if (!tokens.isEmpty()) {
+                  const qint64 timestamp = message[QStringLiteral("timestamp")].toInt();
+                  messages << qMakePair(Posting { -1, g, m, timestamp }, tokens);
+               }
+            }
+         }
+
+         QMutexLocker lk(&m_Mutex);
+
+         // The history was cleared meanwhile
+         if (generation != m_Generation)
+            return;
+
+         const int c = conversation(sha1);
+
+         for (QPair<Posting,QStringList>& message : messages) {
+            message.first.conversation = c;
+            insert(message.first, message.second);
+         }
+
+         m_lBuilt << sha1;
+         changed   = true;
+      }
+
+      Snapshot snapshot;
+
+      {
+         QMutexLocker lk(&m_Mutex);
+
+         if (!(changed && generation == m_Generation && beginSnapshot(snapshot)))
+            return;
+      }
+
+      // This is already a worker, write it right away
+      writeSnapshot(snapshot);
+   });
+}
+
+///Index a new message, it is appended to the log right away
+void TextSearchIndex::addMessage(const QByteArray& sha1, int group, int message, qint64 timestamp, const QString& text)
+{
+   const QStringList tokens = tokenize(text);
+
+   if (tokens.isEmpty())
+      return;
+
+   QMutexLocker lk(&m_Mutex);
+
+   // The collection wasn't loaded, there is nowhere to store it
+   if (m_Dir.isEmpty())
+      return;
+
+   open();
+
+   const Posting p { conversation(sha1), group, message, timestamp };
+
+   if (insert(p, tokens))
+      appendLog(sha1, p, tokens);
+}
+
+///Forget everything, used when the history is cleared
+void TextSearchIndex::clear()
+{
+   QMutexLocker lk(&m_Mutex);
+
+   m_Generation++;
+   m_mTokens       .clear();
+   m_lConversations.clear();
+   m_hConversations.clear();
+   m_lBuilt        .clear();
+   m_lIndexed      .clear();
+   m_LogRecords = 0;
+
+   if (!m_Dir.isEmpty()) {
+      QFile::remove(snapshotPath());
+      QFile::remove(logPath());
+      QFile::remove(oldLogPath());
+   }
+}
+
+/**
+ * The messages with all the words of "query" (as prefixes), the most recent
+ * first. Up to "maximum" hits are returned, 0 for all of them.
+ */
+QVector<TextSearchIndex::Hit> TextSearchIndex::search(const QString& query, int maximum) const
+{
+   const QStringList tokens = tokenize(query);
+
+   if (tokens.isEmpty())
+      return {};
+
+   QMutexLocker lk(&m_Mutex);
+
+   QHash<quint64,Posting> matches;
+
+   for (int i = 0; i < tokens.size(); i++) {
+      const QString& token = tokens[i];
+
+      QHash<quint64,Posting> tokenMatches;
+
+      for (auto it = m_mTokens.lowerBound(token); it != m_mTokens.constEnd() && it.key().startsWith(token); ++it) {
+         for (const Posting& p : it.value()) {
+            const quint64 k = key(p);
+
+            if (i == 0 || matches.contains(k))
+               tokenMatches.insert(k, p);
+         }
+      }
+
+      matches = tokenMatches;
+
+      if (matches.isEmpty())
+         return {};
+   }
+
+   QVector<Posting> sorted;
+   sorted.reserve(matches.size());
+
+   for (const Posting& p : matches)
+      sorted << p;
+
+   std::sort(sorted.begin(), sorted.end(), [](const Posting& a, const Posting& b) {
+      return a.timestamp > b.timestamp;
+   });
+
+   if (maximum > 0 && sorted.size() > maximum)
+      sorted.resize(maximum);
+
+   QVector<Hit> ret;
+   ret.reserve(sorted.size());
+
+   for (const Posting& p : sorted)
+      ret << Hit { m_lConversations[p.conversation], p.group, p.message, p.timestamp };
+
+   return ret;
+}
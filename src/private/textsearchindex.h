@@ -0,0 +1,129 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//Qt
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+/**
+ * Inverted index of the text messages words.
+ *
+ * Each token points to the messages containing it, identified by their
+ * conversation sha1 and their position (group and message index, the same as
+ * used by TextJournal). The existing conversations are indexed by a worker
+ * thread, then the new messages are added as they are inserted.
+ *
+ * It is stored in the text recordings directory as a snapshot of the whole
+ * index ("search.index") and a log of the messages added since
+ * ("search.log"). The log is merged into the snapshot once it grows large.
+ * The snapshot is then written by a worker thread, the log is moved aside
+ * ("search.log.old") until the snapshot is committed.
+ *
+ * All methods are thread safe.
+ */
+class TextSearchIndex final
+{
+public:
+   ///A message containing all the query tokens
+   struct Hit {
+      QByteArray sha1     ;
+      int        group    ;
+      int        message  ;
+      qint64     timestamp;
+   };
+
+   static TextSearchIndex& instance();
+
+   //Mutators
+   void build     ( const QString& dir                                                          );
+   void addMessage( const QByteArray& sha1, int group, int message, qint64 timestamp,
+                    const QString& text                                                         );
+   void clear     (                                                                             );
+
+   //Getters
+   QVector<Hit> search(const QString& query, int maximum) const;
+
+   static QStringList tokenize (const QString& text       );
+   static QString     plainText(const QJsonObject& message);
+
+private:
+   ///Where a token is found
+   struct Posting {
+      int    conversation;
+      int    group       ;
+      int    message     ;
+      qint64 timestamp   ;
+   };
+
+   enum class RecordType : quint8 {
+      MESSAGE = 1,
+   };
+
+   ///A copy of the index to write without holding the mutex
+   struct Snapshot {
+      QString                        path         ;
+      int                            generation   ;
+      QVector<QByteArray>            conversations;
+      QSet<QByteArray>               built        ;
+      QMap<QString,QVector<Posting>> tokens       ;
+   };
+
+   constexpr static const int MIN_TOKEN_SIZE    = 2   ;
+   constexpr static const int MAX_TOKEN_SIZE    = 64  ;
+   constexpr static const int COMPACTION_RECORDS= 4096;
+
+   mutable QMutex                  m_Mutex          ;
+   QString                         m_Dir            ;
+   bool                            m_IsOpen {false} ;
+   QMap<QString,QVector<Posting>>  m_mTokens        ; /*!< Sorted for the prefix queries    */
+   QVector<QByteArray>             m_lConversations ;
+   QHash<QByteArray,int>           m_hConversations ;
+   QSet<QByteArray>                m_lBuilt         ; /*!< Conversations indexed from disk  */
+   QSet<quint64>                   m_lIndexed       ; /*!< The indexed messages, see key()  */
+   int                             m_LogRecords {0} ;
+   int                             m_Generation {0} ; /*!< Incremented when cleared         */
+   bool                            m_IsWriting  {false}; /*!< A snapshot is being written   */
+
+   TextSearchIndex() {}
+
+   ///The tests need their own instances
+   friend class TextSearchIndexTest;
+
+   //Helpers
+   void     open         (                                                                     );
+   bool     readSnapshot (                                                                     );
+   void     readLog      ( const QString& path                                                 );
+   bool     beginSnapshot( Snapshot& snapshot                                                  );
+   bool     writeSnapshot( const Snapshot& snapshot                                            );
+   void     compact      (                                                                     );
+   void     appendLog    ( const QByteArray& sha1, const Posting& p, const QStringList& tokens );
+   int      conversation ( const QByteArray& sha1                                              );
+   bool     insert       ( const Posting& p, const QStringList& tokens                         );
+   QString  snapshotPath (                                                                     ) const;
+   QString  logPath      (                                                                     ) const;
+   QString  oldLogPath   (                                                                     ) const;
+
+   static quint64 key(const Posting& p);
+};
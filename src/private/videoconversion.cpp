@@ -0,0 +1,391 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "videoconversion.h"
+
+//libSTDC++
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+ #define LRC_CONVERSION_SSE2
+ #include <emmintrin.h>
+
+ // AVX2 kernels are built with a target attribute and only used when the
+ // CPU supports them, the rest of the library doesn't require AVX2
+ #if defined(__x86_64__) && (__GNUC__ >= 5 || defined(__clang__))
+  #define LRC_CONVERSION_AVX2
+  #include <immintrin.h>
+ #endif
+#endif
+
+namespace Video {
+
+namespace Conversion {
+
+namespace {
+
+/*****************************************************************************
+ *                                                                           *
+ *                                  Scalar                                   *
+ *                                                                           *
+ ****************************************************************************/
+
+inline uint8_t lumaOf(int r, int g, int b)
+{
+   return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uint8_t chromaUOf(int r, int g, int b)
+{
+   return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline uint8_t chromaVOf(int r, int g, int b)
+{
+   return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void swapRedBlueScalar(const uint8_t* src, uint8_t* dst, std::size_t pixels)
+{
+   for (std::size_t i = 0; i < pixels; ++i) {
+      const uint8_t c0 = src[4*i    ];
+      const uint8_t c2 = src[4*i + 2];
+      dst[4*i    ] = c2;
+      dst[4*i + 1] = src[4*i + 1];
+      dst[4*i + 2] = c0;
+      dst[4*i + 3] = src[4*i + 3];
+   }
+}
+
+void lumaRowScalar(const uint8_t* src, uint8_t* dst, int width, bool srcIsRgba)
+{
+   const int ri = srcIsRgba ? 0 : 2;
+   const int bi = srcIsRgba ? 2 : 0;
+
+   for (int x = 0; x < width; ++x)
+      dst[x] = lumaOf(src[4*x + ri], src[4*x + 1], src[4*x + bi]);
+}
+
+void halveRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int dstWidth)
+{
+   for (int x = 0; x < dstWidth; ++x) {
+      for (int c = 0; c < 4; ++c) {
+         const int sum = row0[8*x + c] + row0[8*x + 4 + c]
+                       + row1[8*x + c] + row1[8*x + 4 + c];
+         dst[4*x + c] = static_cast<uint8_t>((sum + 2) >> 2);
+      }
+   }
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *                                   SSE2                                    *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifdef LRC_CONVERSION_SSE2
+
+void swapRedBlueSSE2(const uint8_t* src, uint8_t* dst, std::size_t pixels)
+{
+   const __m128i maskGA = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+
+   std::size_t i = 0;
+   for (; i + 4 <= pixels; i += 4) {
+      const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4*i));
+      const __m128i ga = _mm_and_si128(v, maskGA);
+
+      // 0x00RR00BB -> 0x00BB00RR by swapping the 16bit halves
+      __m128i rb = _mm_andnot_si128(maskGA, v);
+      rb = _mm_shufflelo_epi16(rb, _MM_SHUFFLE(2,3,0,1));
+      rb = _mm_shufflehi_epi16(rb, _MM_SHUFFLE(2,3,0,1));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4*i), _mm_or_si128(ga, rb));
+   }
+
+   swapRedBlueScalar(src + 4*i, dst + 4*i, pixels - i);
+}
+
+void lumaRowSSE2(const uint8_t* src, uint8_t* dst, int width, bool srcIsRgba)
+{
+   const __m128i zero   = _mm_setzero_si128();
+   const __m128i round  = _mm_set1_epi32(128);
+   const __m128i offset = _mm_set1_epi32(16);
+   const __m128i coef   = srcIsRgba ?
+      _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0) :
+      _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+
+   int x = 0;
+   for (; x + 4 <= width; x += 4) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4*x));
+
+      // Each 32bit lane get the sum of 2 channels of a pixel
+      const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), coef);
+      const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), coef);
+
+      const __m128i even = _mm_castps_si128(_mm_shuffle_ps(
+         _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2,0,2,0)
+      ));
+      const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(
+         _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3,1,3,1)
+      ));
+
+      __m128i y = _mm_add_epi32(_mm_add_epi32(even, odd), round);
+      y = _mm_add_epi32(_mm_srli_epi32(y, 8), offset);
+      y = _mm_packs_epi32(y, y);
+      y = _mm_packus_epi16(y, y);
+
+      const int packed = _mm_cvtsi128_si32(y);
+      std::memcpy(dst + x, &packed, 4);
+   }
+
+   lumaRowScalar(src + 4*x, dst + x, width - x, srcIsRgba);
+}
+
+void halveRowSSE2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int dstWidth)
+{
+   int x = 0;
+   for (; x + 4 <= dstWidth; x += 4) {
+      const __m128i a = _mm_avg_epu8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 8*x     )),
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 8*x     ))
+      );
+      const __m128i b = _mm_avg_epu8(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 8*x + 16)),
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 8*x + 16))
+      );
+
+      const __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2,0,2,0));
+      const __m128 odd  = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3,1,3,1));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4*x),
+         _mm_avg_epu8(_mm_castps_si128(even), _mm_castps_si128(odd))
+      );
+   }
+
+   halveRowScalar(row0 + 8*x, row1 + 8*x, dst + 4*x, dstWidth - x);
+}
+
+#endif //LRC_CONVERSION_SSE2
+
+/*****************************************************************************
+ *                                                                           *
+ *                                   AVX2                                    *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifdef LRC_CONVERSION_AVX2
+
+__attribute__((target("avx2")))
+void swapRedBlueAVX2(const uint8_t* src, uint8_t* dst, std::size_t pixels)
+{
+   const __m256i shuffle = _mm256_setr_epi8(
+      2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15,
+      2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15
+   );
+
+   std::size_t i = 0;
+   for (; i + 8 <= pixels; i += 8) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4*i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4*i), _mm256_shuffle_epi8(v, shuffle));
+   }
+
+   swapRedBlueSSE2(src + 4*i, dst + 4*i, pixels - i);
+}
+
+__attribute__((target("avx2")))
+void halveRowAVX2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int dstWidth)
+{
+   int x = 0;
+   for (; x + 8 <= dstWidth; x += 8) {
+      const __m256i a = _mm256_avg_epu8(
+         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + 8*x     )),
+         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 8*x     ))
+      );
+      const __m256i b = _mm256_avg_epu8(
+         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + 8*x + 32)),
+         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 8*x + 32))
+      );
+
+      // The shuffle works per 128bit lane, fix the pixel order afterward
+      const __m256i even = _mm256_castps_si256(_mm256_shuffle_ps(
+         _mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2,0,2,0)
+      ));
+      const __m256i odd = _mm256_castps_si256(_mm256_shuffle_ps(
+         _mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3,1,3,1)
+      ));
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4*x), _mm256_permute4x64_epi64(
+         _mm256_avg_epu8(even, odd), _MM_SHUFFLE(3,1,2,0)
+      ));
+   }
+
+   halveRowSSE2(row0 + 8*x, row1 + 8*x, dst + 4*x, dstWidth - x);
+}
+
+#endif //LRC_CONVERSION_AVX2
+
+/*****************************************************************************
+ *                                                                           *
+ *                                 Dispatch                                  *
+ *                                                                           *
+ ****************************************************************************/
+
+struct Kernels {
+   void (*swapRedBlue)(const uint8_t*, uint8_t*, std::size_t     );
+   void (*lumaRow    )(const uint8_t*, uint8_t*, int, bool       );
+   void (*halveRow   )(const uint8_t*, const uint8_t*, uint8_t*, int);
+};
+
+InstructionSet detectInstructionSet()
+{
+#ifdef LRC_CONVERSION_AVX2
+   if (__builtin_cpu_supports("avx2"))
+      return InstructionSet::AVX2;
+#endif
+
+#ifdef LRC_CONVERSION_SSE2
+   return InstructionSet::SSE2;
+#else
+   return InstructionSet::SCALAR;
+#endif
+}
+
+Kernels kernelsFor(InstructionSet set)
+{
+   Kernels ret {swapRedBlueScalar, lumaRowScalar, halveRowScalar};
+
+#ifdef LRC_CONVERSION_SSE2
+   if (set >= InstructionSet::SSE2)
+      ret = {swapRedBlueSSE2, lumaRowSSE2, halveRowSSE2};
+#endif
+
+#ifdef LRC_CONVERSION_AVX2
+   if (set >= InstructionSet::AVX2) {
+      ret.swapRedBlue = swapRedBlueAVX2;
+      ret.halveRow    = halveRowAVX2   ;
+   }
+#endif
+
+   static_cast<void>(set); // Unused without SSE2
+   return ret;
+}
+
+Kernels& kernels()
+{
+   static Kernels k = kernelsFor(detectInstructionSet());
+   return k;
+}
+
+/// Y plane followed by the chroma, either planar (I420) or interleaved (NV12)
+void toYuv420(const uint8_t* src, uint8_t* dst, int width, int height, bool srcIsRgba, bool interleaved)
+{
+   const Kernels& k = kernels();
+
+   for (int y = 0; y < height; ++y)
+      k.lumaRow(src + 4*width*y, dst + width*y, width, srcIsRgba);
+
+   const int cw = (width  + 1) / 2;
+   const int ch = (height + 1) / 2;
+   const int ri = srcIsRgba ? 0 : 2;
+   const int bi = srcIsRgba ? 2 : 0;
+
+   uint8_t* u = dst + width*height;
+   uint8_t* v = interleaved ? u + 1 : u + cw*ch;
+   const int step = interleaved ? 2 : 1;
+
+   // Average the 2x2 block, the last row/column is duplicated for odd sizes
+   for (int y = 0; y < ch; ++y) {
+      const uint8_t* row0 = src + 4*width*(2*y);
+      const uint8_t* row1 = src + 4*width*(2*y + 1 < height ? 2*y + 1 : 2*y);
+
+      for (int x = 0; x < cw; ++x) {
+         const int x0 = 4*(2*x);
+         const int x1 = 4*(2*x + 1 < width ? 2*x + 1 : 2*x);
+
+         const int r = (row0[x0+ri] + row0[x1+ri] + row1[x0+ri] + row1[x1+ri] + 2) >> 2;
+         const int g = (row0[x0+1 ] + row0[x1+1 ] + row1[x0+1 ] + row1[x1+1 ] + 2) >> 2;
+         const int b = (row0[x0+bi] + row0[x1+bi] + row1[x0+bi] + row1[x1+bi] + 2) >> 2;
+
+         const int idx = (y*cw + x) * step;
+         u[idx] = chromaUOf(r, g, b);
+         v[idx] = chromaVOf(r, g, b);
+      }
+   }
+}
+
+} // anonymous namespace
+
+void swapRedBlue(const uint8_t* src, uint8_t* dst, std::size_t pixels)
+{
+   kernels().swapRedBlue(src, dst, pixels);
+}
+
+void toI420(const uint8_t* src, uint8_t* dst, int width, int height, bool srcIsRgba)
+{
+   toYuv420(src, dst, width, height, srcIsRgba, false);
+}
+
+void toNV12(const uint8_t* src, uint8_t* dst, int width, int height, bool srcIsRgba)
+{
+   toYuv420(src, dst, width, height, srcIsRgba, true);
+}
+
+void halve(const uint8_t* src, uint8_t* dst, int width, int height)
+{
+   const Kernels& k = kernels();
+
+   for (int y = 0; y < height / 2; ++y) {
+      k.halveRow(
+         src + 4*width*(2*y    ),
+         src + 4*width*(2*y + 1),
+         dst + 4*(width/2)*y    ,
+         width / 2
+      );
+   }
+}
+
+void resize(const uint8_t* src, int srcWidth, int srcHeight,
+            uint8_t* dst, int dstWidth, int dstHeight)
+{
+   for (int y = 0; y < dstHeight; ++y) {
+      const uint8_t* row = src + 4*srcWidth*((y * srcHeight) / dstHeight);
+      uint8_t* out = dst + 4*dstWidth*y;
+
+      for (int x = 0; x < dstWidth; ++x)
+         std::memcpy(out + 4*x, row + 4*((x * srcWidth) / dstWidth), 4);
+   }
+}
+
+std::size_t yuv420Size(int width, int height)
+{
+   return static_cast<std::size_t>(width*height + 2 * ((width + 1) / 2) * ((height + 1) / 2));
+}
+
+InstructionSet bestInstructionSet()
+{
+   static const InstructionSet best = detectInstructionSet();
+   return best;
+}
+
+void setInstructionSet(InstructionSet set)
+{
+   kernels() = kernelsFor(std::min(set, bestInstructionSet()));
+}
+
+} // namespace Conversion
+
+} // namespace Video
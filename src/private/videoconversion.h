@@ -0,0 +1,72 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+//libSTDC++
+#include <cstdint>
+#include <cstddef>
+
+namespace Video {
+
+/**
+ * Pixel conversion kernels used by Renderer::convertedFrame().
+ *
+ * The source is always a tightly packed 32bit frame (BGRA or RGBA). Each
+ * kernel has a scalar implementation and, on x86, SSE2 and/or AVX2 ones
+ * selected at runtime depending on the CPU.
+ */
+namespace Conversion {
+
+/// Swap the red and blue channels (BGRA <-> RGBA), src and dst can be equal
+void swapRedBlue(const uint8_t* src, uint8_t* dst, std::size_t pixels);
+
+/// Convert to planar Y, U, V 4:2:0 (BT.601, limited range)
+void toI420(const uint8_t* src, uint8_t* dst, int width, int height, bool srcIsRgba);
+
+/// Convert to planar Y followed by interleaved UV 4:2:0 (BT.601, limited range)
+void toNV12(const uint8_t* src, uint8_t* dst, int width, int height, bool srcIsRgba);
+
+/// Average each 2x2 block, dst is (width/2)x(height/2)
+void halve(const uint8_t* src, uint8_t* dst, int width, int height);
+
+/// Nearest neighbour resize, used for the last non power of two step
+void resize(const uint8_t* src, int srcWidth, int srcHeight,
+            uint8_t* dst, int dstWidth, int dstHeight);
+
+/// Size of a 4:2:0 frame
+std::size_t yuv420Size(int width, int height);
+
+enum class InstructionSet {
+   SCALAR,
+   SSE2  ,
+   AVX2  ,
+};
+
+/// Best instruction set supported by both this build and the CPU
+InstructionSet bestInstructionSet();
+
+/**
+ * Restrict the kernels to an instruction set, capped to bestInstructionSet().
+ *
+ * This is intended for the tests, the kernels must not be running while it
+ * is changed.
+ */
+void setInstructionSet(InstructionSet set);
+
+} // namespace Conversion
+
+} // namespace Video
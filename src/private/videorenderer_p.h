@@ -19,19 +19,22 @@
 #pragma once
 
 //Qt
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
 #include <QtCore/QSize>
 
 // Std
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <vector>
 
-class QMutex;
+//Ring
+#include "video/renderer.h"
 
-namespace Video {
+class QMutexLocker;
 
-class Renderer;
-struct Frame;
+namespace Video {
 
 class RendererPrivate final : public QObject
 {
@@ -45,8 +48,46 @@ public:
     QString              m_Id          ;
     QSize                m_pSize       ;
     std::shared_ptr<Frame> m_pFrame; // frame given by daemon for direct rendering
+
+    // Conversion stage
+    QMutex               m_ConversionMutex;
+    Renderer::ColorSpace m_OutputColorSpace;
+    bool                 m_HasOutputColorSpace;
+    QSize                m_OutputSize  ;
+    std::vector<uint8_t> m_ScaleBuffer ;
+    std::vector<uint8_t> m_ScaleBuffer2;
+    std::vector<uint8_t> m_OutputBuffer;
+
+    // Statistics
+    using Clock = std::chrono::steady_clock;
+    constexpr static const int STATISTICS_PERIOD_MS = 1000;
+    constexpr static const int LATENCY_SAMPLES      = 256 ;
+
+    QMutex               m_StatisticsMutex;
+    RendererStatistics   m_Statistics  ;
+    Clock::time_point    m_PeriodStart ;
+    quint64              m_PeriodFrames;
+    qint64               m_PeriodLockNs;
+    std::vector<qint64>  m_lLatencies  ; // ns, ring buffer of the current period
+    std::atomic<qint64>  m_ProducedAt  ; // ns since epoch of the last produced frame
+
+    //Statistics helpers, called by the implementations
+    void frameProduced ( qint64 producedAt );
+    void frameDelivered(                   );
+    void frameDuplicated(                  );
+    void framesDropped ( quint64 count     );
+    void lockReleased  ( qint64 heldNs     );
+    void shmRemapped   (                   );
+    static qint64 now  (                   );
+
 private:
+    void updatePeriod(QMutexLocker& lk);
+
     Video::Renderer* q_ptr;
+
+Q_SIGNALS:
+    /// Queued to statisticsUpdated(), the frame path may hold the renderer mutex
+    void periodEnded(const Video::RendererStatistics& stats);
 };
 
 } // namespace Video
@@ -134,6 +134,7 @@ Video::Renderer* VideoRendererManager::previewRenderer()
 
 #ifdef ENABLE_LIBWRAP
       r = new Video::DirectRenderer(PREVIEW_RENDERER_ID, res->size());
+      static_cast<Video::DirectRenderer*>(r)->setBufferSize(d_ptr->m_BufferSize);
 #else //ENABLE_LIBWRAP
       r = new Video::ShmRenderer(PREVIEW_RENDERER_ID,"",res->size());
 #endif
@@ -179,10 +180,21 @@ bool VideoRendererManager::isPreviewing() const
    return d_ptr->m_PreviewState;
 }
 
-///@todo Set the video buffer size
+/**
+ * Set the number of frame buffers each renderer can use.
+ *
+ * This only affects the renderers receiving frames directly from the daemon,
+ * shared memory renderers use the buffers allocated by the daemon. A size of
+ * 0 restores the default.
+ */
 void VideoRendererManager::setBufferSize(uint size)
 {
    d_ptr->m_BufferSize = size;
+
+#ifdef ENABLE_LIBWRAP
+   for (Video::Renderer* r : d_ptr->m_hRenderers)
+      static_cast<Video::DirectRenderer*>(r)->setBufferSize(size);
+#endif
 }
 
 ///A video is not being rendered
@@ -201,6 +213,7 @@ void VideoRendererManagerPrivate::startedDecoding(const QString& id, const QStri
 #ifdef ENABLE_LIBWRAP
 
       r = new Video::DirectRenderer(rid, res);
+      static_cast<Video::DirectRenderer*>(r)->setBufferSize(m_BufferSize);
 
       qWarning() << "Calling registerFrameListener";
       m_hRenderers[rid] = r;
@@ -42,6 +42,7 @@
 #include "certificate.h"
 #include "availableaccountmodel.h"
 #include "pendingcontactrequestmodel.h"
+#include "private/orderstatistictree.h"
 
 struct CallGroup
 {
@@ -51,6 +52,23 @@ struct CallGroup
    time_t          m_LastUsed ;
 };
 
+/**
+ * The sort key of the top level nodes, the most recent first. For the same
+ * time, the node (re)inserted last comes first.
+ */
+struct RecentKey
+{
+   time_t  m_Time    ;
+   quint64 m_Sequence;
+
+   bool operator<(const RecentKey& other) const {
+      return m_Time > other.m_Time || (m_Time == other.m_Time && m_Sequence > other.m_Sequence);
+   }
+};
+
+struct RecentViewNode;
+typedef OrderStatisticTree<RecentKey, RecentViewNode*> RecentTree;
+
 struct RecentViewNode
 {
    //Types
@@ -73,7 +91,8 @@ struct RecentViewNode
 
    //Attributes
    RecentModelPrivate*    m_pModel   ;
-   long int               m_Index    ;
+   long int               m_Index    ; /*!< The row of the children, see row() */
+   RecentTree::Node*      m_pEntry   {nullptr}; /*!< Top level nodes position    */
    Type                   m_Type     ;
    RecentViewNode*        m_pParent  ;
    QList<RecentViewNode*> m_lChildren;
@@ -87,10 +106,24 @@ struct RecentViewNode
       //ImConversationIterator;
    } m_uContent;
 
+   ///What the PeopleProxy filter matches, for each ContactMethod
+   struct SearchKey {
+      const ContactMethod* m_pContactMethod;
+      QStringList          m_lFields       ; /*!< For the regular expressions      */
+      QString              m_Text          ; /*!< The fields, each after a newline */
+      QString              m_FoldedText    ; /*!< m_Text, case folded              */
+   };
+
+   mutable QVector<SearchKey>             m_lSearchKeys         ;
+   mutable bool                           m_HasSearchKeys {false};
+   mutable QList<QMetaObject::Connection> m_lSearchConnections  ;
+
    //Helpers
    inline time_t   lastUsed (          ) const;
+   inline int      row      (          ) const;
    RecentViewNode* childNode(Call *call) const;
    void            slotChanged(        );
+   const QVector<SearchKey>& searchKeys() const;
 };
 
 class PeopleProxy : public QSortFilterProxyModel
@@ -100,9 +133,19 @@ public:
     PeopleProxy(RecentModel* source_model);
 
     virtual QVariant data(const QModelIndex& index, int role) const override;
+
+    //Attributes
+    RecentModel::PeopleFilterMode m_Mode {RecentModel::PeopleFilterMode::PATTERN};
+    QRegExp                       m_ModeFilter; /*!< m_Mode only applies to this filter */
+
 protected:
     virtual bool filterAcceptsRow ( int sourceRow, const QModelIndex & sourceParent ) const override;
 
+private:
+    mutable QSet<const ContactMethod*> m_lActiveCallCMs            ;
+    mutable bool                       m_IsActiveCallsDirty {true} ;
+
+    const QSet<const ContactMethod*>& activeCallContactMethods() const;
 };
 
 class RecentModelPrivate : public QObject
@@ -112,12 +155,12 @@ public:
    RecentModelPrivate(RecentModel* p);
 
    /*
-   * m_lTopLevelReverted hold the elements in the reverse order of
-   * QAbstractItemModel::index. This cause most of the energy to be
-   * in the bottom half of the vector, preventing std::move every time
-   * someone is contacted
+   * m_lTopLevel hold the elements in the QAbstractItemModel::index order.
+   * The rows are not stored but computed in O(log n), so moving someone to
+   * the top doesn't require renumbering everything in between.
    */
-   QList<RecentViewNode*>                m_lTopLevelReverted;
+   RecentTree                            m_lTopLevel        ;
+   quint64                               m_Sequence {0}     ;
    QHash<const Person*,RecentViewNode*>  m_hPersonsToNodes  ;
    QHash<ContactMethod*,RecentViewNode*> m_hCMsToNodes      ;
    QHash<Call*,RecentViewNode*>          m_hCallsToNodes    ;
@@ -197,7 +240,7 @@ RecentModel::getParticipantNumber(Call *call) const
 
 void RecentModelPrivate::selectNode(RecentViewNode* node) const
 {
-   const auto idx = q_ptr->createIndex(node->m_Index, 0, node);
+   const auto idx = q_ptr->createIndex(node->row(), 0, node);
 
    q_ptr->selectionModel()->setCurrentIndex(idx, QItemSelectionModel::ClearAndSelect);
 }
@@ -260,7 +303,7 @@ RecentModel::RecentModel(QObject* parent) : QAbstractItemModel(parent), d_ptr(ne
 
 RecentModel::~RecentModel()
 {
-   for (RecentViewNode* n : d_ptr->m_lTopLevelReverted)
+   for (RecentViewNode* n : d_ptr->m_lTopLevel.values())
       delete n;
 
    delete d_ptr;
@@ -304,11 +347,84 @@ RecentViewNode::RecentViewNode(ContactMethod *cm, RecentModelPrivate *model)
 RecentViewNode::~RecentViewNode()
 {
     QObject::disconnect(m_ConnectionChanged);
+    for (const auto& c : m_lSearchConnections)
+        QObject::disconnect(c);
     for (RecentViewNode* n : m_lChildren) {
         delete n;
     }
 }
 
+///The model row, the top level nodes rows are computed from their position
+int RecentViewNode::row() const
+{
+   if (m_pParent || !m_pEntry)
+      return m_Index;
+
+   return m_pModel->m_lTopLevel.rank(m_pEntry);
+}
+
+/**
+ * The names and URIs the PeopleProxy filter is matched against. They are
+ * cached until the node or one of its ContactMethod changes.
+ */
+const QVector<RecentViewNode::SearchKey>& RecentViewNode::searchKeys() const
+{
+   if (m_HasSearchKeys)
+      return m_lSearchKeys;
+
+   for (const auto& c : m_lSearchConnections)
+      QObject::disconnect(c);
+
+   m_lSearchConnections.clear();
+   m_lSearchKeys.clear();
+
+   QVector<ContactMethod*> cms;
+   const Person* person = nullptr;
+
+   switch(m_Type) {
+      case Type::PERSON:
+         person = m_uContent.m_pPerson;
+         cms    = person->phoneNumbers();
+         break;
+      case Type::CONTACT_METHOD:
+         cms << m_uContent.m_pContactMethod;
+         break;
+      case Type::CALL:
+      case Type::CALL_GROUP:
+      case Type::CONFERENCE:
+      case Type::TEXT_MESSAGE:
+      case Type::TEXT_MESSAGE_GROUP:
+         break;
+   }
+
+   m_lSearchKeys.reserve(cms.size());
+
+   for (ContactMethod* cm : cms) {
+      SearchKey key;
+      key.m_pContactMethod = cm;
+
+      if (person)
+         key.m_lFields << person->formattedName();
+
+      key.m_lFields << cm->uri().full() << cm->registeredName() << cm->primaryName();
+
+      for (const QString& field : key.m_lFields)
+         key.m_Text += QLatin1Char('\n') + field;
+
+      key.m_FoldedText = key.m_Text.toCaseFolded();
+
+      m_lSearchKeys << key;
+
+      m_lSearchConnections << QObject::connect(cm, &ContactMethod::changed, [this]() {
+         m_HasSearchKeys = false;
+      });
+   }
+
+   m_HasSearchKeys = true;
+
+   return m_lSearchKeys;
+}
+
 time_t RecentViewNode::lastUsed() const
 {
    switch(m_Type) {
@@ -373,11 +489,11 @@ RecentModel::getIndex(Call *call) const
 {
     // first check if it is a conference
     if (auto confNode = d_ptr->m_hConfToNodes.value(call))
-        return index(confNode->m_Index, 0);
+        return index(confNode->row(), 0);
 
     if (auto callNode = d_ptr->m_hCallsToNodes.value(call)) {
         if (callNode->m_pParent)
-            return index(callNode->m_Index, 0, index(callNode->m_pParent->m_Index, 0));
+            return index(callNode->m_Index, 0, index(callNode->m_pParent->row(), 0));
     }
 
     return {};
@@ -392,7 +508,7 @@ RecentModel::getIndex(Person *p) const
 {
     if (d_ptr->m_hPersonsToNodes.contains(p)) {
         if (auto node = d_ptr->m_hPersonsToNodes.value(p))
-            return index(node->m_Index, 0);
+            return index(node->row(), 0);
     }
 
     return {};
@@ -408,7 +524,7 @@ RecentModel::getIndex(ContactMethod *cm) const
     // check if the CM is an item the RecentModel
     if (d_ptr->m_hCMsToNodes.contains(cm)) {
         if (auto node = d_ptr->m_hCMsToNodes.value(cm))
-            return index(node->m_Index, 0);
+            return index(node->row(), 0);
     }
 
     // otherwise, its possible the CM is contained within a Person item
@@ -562,12 +678,32 @@ QVariant RecentModel::data( const QModelIndex& index, int role ) const
 int RecentModel::rowCount( const QModelIndex& parent ) const
 {
    if (!parent.isValid())
-      return d_ptr->m_lTopLevelReverted.size();
+      return d_ptr->m_lTopLevel.size();
 
    RecentViewNode* node = static_cast<RecentViewNode*>(parent.internalPointer());
    return node->m_lChildren.size();
 }
 
+/**
+ * The history may only be partially loaded, see
+ * CategorizedHistoryModel::setLoadingWindow(). The next window of calls is
+ * loaded when the view reaches the end of the list.
+ */
+bool RecentModel::canFetchMore( const QModelIndex& parent ) const
+{
+   if (parent.isValid())
+      return false;
+
+   return CategorizedHistoryModel::instance().canFetchMore(QModelIndex());
+}
+
+///The new calls update the last used time of their nodes, which adds the rows
+void RecentModel::fetchMore( const QModelIndex& parent )
+{
+   if (!parent.isValid())
+      CategorizedHistoryModel::instance().fetchMore(QModelIndex());
+}
+
 Qt::ItemFlags RecentModel::flags( const QModelIndex& index ) const
 {
    return index.isValid() ? Qt::ItemIsEnabled | Qt::ItemIsSelectable : Qt::NoItemFlags;
@@ -589,13 +725,13 @@ QModelIndex RecentModel::parent( const QModelIndex& index ) const
    if (!node->m_pParent)
       return QModelIndex();
 
-   return createIndex(node->m_pParent->m_Index, 0, node->m_pParent);
+   return createIndex(node->m_pParent->row(), 0, node->m_pParent);
 }
 
 QModelIndex RecentModel::index( int row, int column, const QModelIndex& parent) const
 {
-   if (!parent.isValid() && row >= 0 && row < d_ptr->m_lTopLevelReverted.size() && !column)
-      return createIndex(row, 0, d_ptr->m_lTopLevelReverted[d_ptr->m_lTopLevelReverted.size() - 1 - row]);
+   if (!parent.isValid() && row >= 0 && row < d_ptr->m_lTopLevel.size() && !column)
+      return createIndex(row, 0, d_ptr->m_lTopLevel.at(row)->value());
 
    if (!parent.isValid())
       return QModelIndex();
@@ -619,74 +755,57 @@ QVariant RecentModel::headerData( int section, Qt::Orientation orientation, int
 /*
  * Move rows around to keep the person/contactmethods ordered
  *
- * Further optimization:
- *  * Invert m_Index to avoid the O(N) loop when adding an item
+ * Both the insertion point and the current row are found in O(log n).
  */
 void RecentModelPrivate::insertNode(RecentViewNode* n, time_t t, bool isNew)
 {
-   //Don't bother with the sorted insertion and indexes housekeeping
-   if (m_lTopLevelReverted.isEmpty()) {
-      q_ptr->beginInsertRows(QModelIndex(),0,0);
-      m_lTopLevelReverted << n;
+   const RecentKey key {t, ++m_Sequence};
+
+   //Nodes created for an existing ContactMethod are not in the tree yet
+   if (isNew || !n->m_pEntry) {
+      const int newPos = m_lTopLevel.lowerBound(key);
+
+      q_ptr->beginInsertRows(QModelIndex(), newPos, newPos);
+      n->m_pEntry = m_lTopLevel.insert(key, n);
       q_ptr->endInsertRows();
       return;
    }
 
    //Compute the bounds, this is needed to use beginMoveRows
-   int newPos = 0;
-
-   if (m_lTopLevelReverted.last()->lastUsed() > t) {
-      //NOTE std::lower_bound need the "value" argument to be the same type as the iterator
-      //this use the m_Index field to hold the time_t
-      static RecentViewNode fake;
-      fake.m_Index = static_cast<long int>(t);
-
-      //NOTE Using std::lower_bound is officially supported on QList on all platforms
-      auto lower = std::lower_bound(m_lTopLevelReverted.begin(), m_lTopLevelReverted.end(), &fake,
-      [t](const RecentViewNode* a, const RecentViewNode* t2) -> bool {
-         return a->lastUsed() < t2->m_Index;
-      });
+   const int oldPos = m_lTopLevel.rank(n->m_pEntry);
+   const int lower  = m_lTopLevel.lowerBound(key);
+
+   //The position once the node is removed
+   const int newPos = oldPos < lower ? lower - 1 : lower;
 
-      // the value pointed by the iterator returned by this function may also
-      // be equivalent to val, and not only greater
-      if (!isNew && n->m_Index == (*lower)->m_Index) {
-         newPos = (*lower)->m_Index;
-      } else
-         newPos = (*lower)->m_Index+1;
+   if (newPos == oldPos) {
+      //Only the key changes, the order stays the same
+      m_lTopLevel.remove(n->m_pEntry);
+      n->m_pEntry = m_lTopLevel.insert(key, n);
+      return;
    }
 
-   //Begin the transaction
-   if (!isNew) {
-      if (newPos == n->m_Index)
-         return; //Nothing to do
-      if (not q_ptr->beginMoveRows(QModelIndex(), n->m_Index, n->m_Index, QModelIndex(), newPos)) {
-          qWarning() << "RecentModel: Invalid move detected index : " << n->m_Index
-                     << "newPos: " << newPos << "size: " << m_lTopLevelReverted.size();
-          return;
-      }
-      m_lTopLevelReverted.removeAt(m_lTopLevelReverted.size()-1-n->m_Index);
+   //Begin the transaction, Qt want the destination before the move
+   if (not q_ptr->beginMoveRows(QModelIndex(), oldPos, oldPos, QModelIndex(), newPos > oldPos ? newPos + 1 : newPos)) {
+       qWarning() << "RecentModel: Invalid move detected index : " << oldPos
+                  << "newPos: " << newPos << "size: " << m_lTopLevel.size();
+       return;
    }
-   else
-      q_ptr->beginInsertRows(QModelIndex(),newPos,newPos);
 
    //Apply the transaction
-   m_lTopLevelReverted.insert(m_lTopLevelReverted.size() - newPos,n);
-   for (int i = 0 ; i < m_lTopLevelReverted.size(); ++i) {
-      m_lTopLevelReverted[i]->m_Index = m_lTopLevelReverted.size() - 1 - i;
-   }
+   m_lTopLevel.remove(n->m_pEntry);
+   n->m_pEntry = m_lTopLevel.insert(key, n);
 
    //Notify that the transaction is complete
-   if (!isNew)
-      q_ptr->endMoveRows();
-   else
-      q_ptr->endInsertRows();
+   q_ptr->endMoveRows();
 
 #if 0
     //Uncomment if there is issues
-    qDebug() << "\n\nList:" << m_lTopLevelReverted.size() << isNew;
-    for (int i = 0; i<m_lTopLevelReverted.size();i++) {
-        qDebug() << "|||" << m_lTopLevelReverted[i]->lastUsed() << m_lTopLevelReverted[i]->m_Index << q_ptr->data(q_ptr->index(m_lTopLevelReverted.size()-1-i,0),Qt::DisplayRole);
-        for (auto child : m_lTopLevelReverted[i]->m_lChildren) {
+    qDebug() << "\n\nList:" << m_lTopLevel.size() << isNew;
+    for (int i = 0; i<m_lTopLevel.size();i++) {
+        const RecentViewNode* node = m_lTopLevel.at(i)->value();
+        qDebug() << "|||" << node->lastUsed() << node->row() << q_ptr->data(q_ptr->index(i,0),Qt::DisplayRole);
+        for (auto child : node->m_lChildren) {
             qDebug() << "|||" << "|||" << child << child->m_uContent.m_pCall->formattedName();
         }
      }
@@ -695,19 +814,15 @@ void RecentModelPrivate::insertNode(RecentViewNode* n, time_t t, bool isNew)
 
 void RecentModelPrivate::removeNode(RecentViewNode* n)
 {
-   const int idx  = n->m_Index;
+   const int idx  = n->row();
 
    q_ptr->beginRemoveRows(QModelIndex(), idx, idx);
 
-   m_lTopLevelReverted.removeOne(n);
+   m_lTopLevel.remove(n->m_pEntry);
+   n->m_pEntry = nullptr;
 
    delete n;
 
-   // update all indices after this one
-   for (int i = m_lTopLevelReverted.size() - 1 - idx; i >= 0; --i) {
-      --m_lTopLevelReverted[i]->m_Index;
-   }
-
    q_ptr->endRemoveRows();
 }
 
@@ -802,7 +917,7 @@ void RecentModelPrivate::slotContactChanged(ContactMethod* contactMethod, const
 
             // check if the node we will remove is the selected node and select the new node
             auto selectedIdx = q_ptr->selectionModel()->currentIndex();
-            auto oldIdx = q_ptr->createIndex(oldParentNode->m_Index, 0, oldParentNode);
+            auto oldIdx = q_ptr->createIndex(oldParentNode->row(), 0, oldParentNode);
             if (selectedIdx == oldIdx)
                 selectNode(newParentNode);
 
@@ -837,7 +952,7 @@ RecentModelPrivate::insertCallNode(RecentViewNode *parent, RecentViewNode* callN
     callNode->m_pParent = parent;
     callNode->m_Index = parent->m_lChildren.size();
 
-    auto parentIdx = q_ptr->index(parent->m_Index,0);
+    auto parentIdx = q_ptr->index(parent->row(),0);
 
     q_ptr->beginInsertRows(parentIdx, callNode->m_Index, callNode->m_Index);
     parent->m_lChildren.append(callNode);
@@ -877,7 +992,7 @@ RecentModelPrivate::moveCallNode(RecentViewNode* destination, RecentViewNode* ca
     }
 
     auto parentNode = callNode->m_pParent;
-    auto parent = q_ptr->index(parentNode->m_Index, 0);
+    auto parent = q_ptr->index(parentNode->row(), 0);
     const auto removedIndex = callNode->m_Index;
 
     // check if this call was selected, so that we can re-select the same one after its moved
@@ -900,7 +1015,7 @@ RecentModelPrivate::moveCallNode(RecentViewNode* destination, RecentViewNode* ca
 
     callNode->m_pParent = destination;
     callNode->m_Index = destination->m_lChildren.size();
-    auto destIdx = q_ptr->index(destination->m_Index, 0);
+    auto destIdx = q_ptr->index(destination->row(), 0);
     q_ptr->beginInsertRows(destIdx, callNode->m_Index, callNode->m_Index);
     destination->m_lChildren.append(callNode);
     q_ptr->endInsertRows();
@@ -929,7 +1044,7 @@ RecentModelPrivate::removeCall(RecentViewNode* callNode)
 
     // if it was in the RecentModel, then we need to emit rowsRemoved
     if (auto parentNode = callNode->m_pParent) {
-        auto parent = q_ptr->index(parentNode->m_Index, 0);
+        auto parent = q_ptr->index(parentNode->row(), 0);
         const auto removedIndex = callNode->m_Index;
 
         q_ptr->beginRemoveRows(parent, removedIndex, removedIndex);
@@ -1001,7 +1116,8 @@ RecentModelPrivate::slotChanged(RecentViewNode *node)
         case RecentViewNode::Type::CONTACT_METHOD:
         case RecentViewNode::Type::CONFERENCE:
         {
-            auto idx = q_ptr->index(node->m_Index, 0);
+            node->m_HasSearchKeys = false;
+            auto idx = q_ptr->index(node->row(), 0);
             emit q_ptr->dataChanged(idx, idx);
         }
         break;
@@ -1009,7 +1125,7 @@ RecentModelPrivate::slotChanged(RecentViewNode *node)
         {
             // make sure the Call has a parent, else try to find one
             if (node->m_pParent) {
-                auto parent = q_ptr->index(node->m_pParent->m_Index, 0);
+                auto parent = q_ptr->index(node->m_pParent->row(), 0);
                 auto idx = q_ptr->index(node->m_Index, 0, parent);
                 emit q_ptr->dataChanged(parent, parent);
                 emit q_ptr->dataChanged(idx, idx);
@@ -1169,6 +1285,32 @@ RecentModel::peopleProxy() const
    return p;
 }
 
+/**
+ * Match the peopleProxy() filter as plain text instead of using its regular
+ * expression. This is a lot faster on large lists and is what the search
+ * boxes need most of the time.
+ *
+ * Calling setFilterFixedString() on the proxy directly is the same as
+ * PeopleFilterMode::SUBSTRING.
+ */
+void RecentModel::setPeopleFilter(const QString& text, PeopleFilterMode mode)
+{
+   auto p = static_cast<PeopleProxy*>(peopleProxy());
+
+   // Same as setFilterRegExp() and setFilterFixedString()
+   const QRegExp re(text, p->filterCaseSensitivity(),
+      mode == PeopleFilterMode::PATTERN ? QRegExp::RegExp : QRegExp::FixedString);
+
+   // A filter later set directly on the proxy uses its own syntax again
+   p->m_Mode       = mode;
+   p->m_ModeFilter = re;
+
+   p->setFilterRegExp(re);
+
+   // Switching between SUBSTRING and PREFIX doesn't change the filter string
+   p->invalidate();
+}
+
 PeopleProxy::PeopleProxy(RecentModel* sourceModel)
 {
     setSourceModel(sourceModel);
@@ -1177,6 +1319,33 @@ PeopleProxy::PeopleProxy(RecentModel* sourceModel)
      * when the selected account changes automatically */
     connect( AvailableAccountModel::instance().selectionModel(),
         &QItemSelectionModel::currentChanged, [this]() {this->invalidateFilter();});
+
+    // Keep track of the calls instead of listing them for each row
+    auto dirty = [this]() { m_IsActiveCallsDirty = true; };
+
+    connect(&CallModel::instance(), &QAbstractItemModel::rowsInserted , this, dirty);
+    connect(&CallModel::instance(), &QAbstractItemModel::rowsRemoved  , this, dirty);
+    connect(&CallModel::instance(), &QAbstractItemModel::modelReset   , this, dirty);
+    connect(&CallModel::instance(), &CallModel::callAdded             , this, dirty);
+    connect(&CallModel::instance(), &CallModel::callStateChanged      , this, dirty);
+    connect(&CallModel::instance(), &CallModel::dialNumberChanged     , this, dirty);
+    connect(&CallModel::instance(), &CallModel::conferenceCreated     , this, dirty);
+    connect(&CallModel::instance(), &CallModel::conferenceRemoved     , this, dirty);
+}
+
+///The ContactMethods with an active call, rebuilt only after the calls change
+const QSet<const ContactMethod*>& PeopleProxy::activeCallContactMethods() const
+{
+    if (m_IsActiveCallsDirty) {
+        m_lActiveCallCMs.clear();
+
+        for (auto call : CallModel::instance().getActiveCalls())
+            m_lActiveCallCMs << call->peerContactMethod();
+
+        m_IsActiveCallsDirty = false;
+    }
+
+    return m_lActiveCallCMs;
 }
 
 
@@ -1196,70 +1365,73 @@ PeopleProxy::PeopleProxy(RecentModel* sourceModel)
 bool
 PeopleProxy::filterAcceptsRow(int sourceRow, const QModelIndex & sourceParent) const
 {
-    auto chosenAccount = AvailableAccountModel::instance().currentDefaultAccount();
-
     //we filter only on top nodes
     if (!sourceParent.isValid()) {
-        auto idx = sourceModel()->index(sourceRow, 0);
-        auto type = idx.data(static_cast<int>(Ring::Role::ObjectType)).value<Ring::ObjectType>();
-        auto object = idx.data(static_cast<int>(Ring::Role::Object));
+        const auto idx  = sourceModel()->index(sourceRow, 0);
+        const auto node = static_cast<const RecentViewNode*>(idx.internalPointer());
+
+        //we want to filter on name and number; note that Person object may have many numbers
+        switch (node->m_Type) {
+            case RecentViewNode::Type::PERSON:
+            case RecentViewNode::Type::CONTACT_METHOD:
+                break;
+            case RecentViewNode::Type::CALL:
+            case RecentViewNode::Type::CONFERENCE:
+                return true;
 
-        // get set of CMs with active calls
-        auto activeCalls = CallModel::instance().getActiveCalls();
-        QSet<const ContactMethod *> activeCallCMs;
-        for (auto call : activeCalls) {
-            activeCallCMs << call->peerContactMethod();
+            // top nodes are only of type Person, ContactMethod or Call
+            case RecentViewNode::Type::CALL_GROUP:
+            case RecentViewNode::Type::TEXT_MESSAGE:
+            case RecentViewNode::Type::TEXT_MESSAGE_GROUP:
+                return false;
         }
 
-        Person *person = nullptr;
-        auto filterFunction = [&person, chosenAccount, this, activeCallCMs] (const ContactMethod* cm) {
-            auto passesFilter = false;
+        const auto  chosenAccount = AvailableAccountModel::instance().currentDefaultAccount();
+        const auto& activeCallCMs = activeCallContactMethods();
+        const auto& re            = filterRegExp();
+        const auto  mode          = re == m_ModeFilter ? m_Mode : RecentModel::PeopleFilterMode::PATTERN;
 
-            // never filter out items with active calls
-            if (activeCallCMs.contains(cm)) return true;
+        // The plain modes compare the cached text, without any regular expression
+        const bool isPlain  = mode != RecentModel::PeopleFilterMode::PATTERN
+            || re.patternSyntax() == QRegExp::FixedString;
+        const bool isFolded = re.caseSensitivity() == Qt::CaseInsensitive;
 
-            // filter everything out if there is no account chosen
-            if (not chosenAccount) return false;
+        // Each field is preceded by a newline, so a leading newline matches the field start
+        QString needle;
 
-            // only proceed if there is no account set yet, or if it matches the chosen account
-            if ( !cm->account() or (cm->account() == chosenAccount)) {
-                /* we need to check the Person name as well as any identifier of the
-                 * ContactMethod.
-                 * note: QString::contains() will return true for an empty param string
-                 */
-                passesFilter =
-                    (person and person->formattedName().contains(filterRegExp())) or
-                    cm->uri().full().contains(filterRegExp()) or
-                    cm->registeredName().contains(filterRegExp()) or
-                    cm->primaryName().contains(filterRegExp());
-            }
-            return passesFilter;
-        };
+        if (isPlain) {
+            needle = isFolded ? re.pattern().toCaseFolded() : re.pattern();
 
-        //we want to filter on name and number; note that Person object may have many numbers
-        switch (type) {
-            case Ring::ObjectType::Person:
-            {
-                person = object.value<Person *>();
-                const auto personCMs = person->phoneNumbers();
+            if (mode == RecentModel::PeopleFilterMode::PREFIX)
+                needle.prepend(QLatin1Char('\n'));
+        }
 
-                return std::any_of(std::begin(personCMs), std::end(personCMs), filterFunction);
-            }
-            case Ring::ObjectType::ContactMethod:
-            {
-                auto cm = object.value<ContactMethod *>();
+        for (const auto& key : node->searchKeys()) {
+            const ContactMethod* cm = key.m_pContactMethod;
 
-                return filterFunction(cm);
-            }
-            case Ring::ObjectType::Call:
+            // never filter out items with active calls
+            if (activeCallCMs.contains(cm))
                 return true;
 
-            // top nodes are only of type Person, ContactMethod or Call
-            case Ring::ObjectType::Media:
-            case Ring::ObjectType::Certificate:
-            case Ring::ObjectType::ContactRequest:
-            case Ring::ObjectType::COUNT__:
-            break;
+            // filter everything out if there is no account chosen
+            if (not chosenAccount)
+                continue;
+
+            // only proceed if there is no account set yet, or if it matches the chosen account
+            if (cm->account() and cm->account() != chosenAccount)
+                continue;
+
+            /* we need to check the Person name as well as any identifier of the
+             * ContactMethod.
+             * note: QString::contains() will return true for an empty param string
+             */
+            if (isPlain) {
+                if ((isFolded ? key.m_FoldedText : key.m_Text).contains(needle))
+                    return true;
+            }
+            else if (std::any_of(key.m_lFields.constBegin(), key.m_lFields.constEnd(),
+              [&re](const QString& field) { return field.contains(re); }))
+                return true;
         }
 
         return false; // no matches
@@ -45,9 +45,19 @@ public:
    virtual QModelIndex   index       ( int row, int column, const QModelIndex& parent=QModelIndex()) const override;
    virtual QVariant      headerData  ( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
    virtual QHash<int,QByteArray> roleNames() const override;
+   virtual bool          canFetchMore( const QModelIndex& parent                                   ) const override;
+   virtual void          fetchMore   ( const QModelIndex& parent                                   ) override;
+
+   ///How peopleProxy() match its filter string
+   enum class PeopleFilterMode {
+      PATTERN  , /*!< Use the proxy filterRegExp() (default)                */
+      SUBSTRING, /*!< A name or URI contains the string, no regex           */
+      PREFIX   , /*!< A name or URI starts with the string, no regex        */
+   };
 
    //Proxy
    QSortFilterProxyModel* peopleProxy() const;
+   void setPeopleFilter(const QString& text, PeopleFilterMode mode = PeopleFilterMode::SUBSTRING);
 
    //Singleton
    static RecentModel& instance();
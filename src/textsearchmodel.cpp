@@ -0,0 +1,206 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "textsearchmodel.h"
+
+//Qt
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+
+//Ring
+#include "contactmethod.h"
+#include "localtextrecordingcollection.h"
+
+//Private
+#include "private/textrecording_p.h"
+#include "private/textsearchindex.h"
+
+class TextSearchModelPrivate
+{
+public:
+   struct Result {
+      TextSearchIndex::Hit hit          ;
+      ContactMethod*       contactMethod;
+      QString              text         ;
+      bool                 hasText      ;
+   };
+
+   //Attributes
+   QString                       m_Query             ;
+   int                           m_MaxResults  {100} ;
+   QVector<Result>               m_lResults          ;
+   QHash<QByteArray,QJsonObject> m_hConversations    ; /*!< Read from the disk for text() */
+
+   //Helpers
+   const QString& text(Result& r);
+};
+
+TextSearchModel::TextSearchModel(QObject* parent) : QAbstractListModel(parent),
+d_ptr(new TextSearchModelPrivate())
+{
+}
+
+TextSearchModel::~TextSearchModel()
+{
+   delete d_ptr;
+}
+
+QHash<int,QByteArray> TextSearchModel::roleNames() const
+{
+   static QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
+   static bool initRoles = false;
+   if (!initRoles) {
+      initRoles = true;
+      roles[ static_cast<int>(Role::Timestamp    ) ] = "timestamp"    ;
+      roles[ static_cast<int>(Role::FormattedDate) ] = "formattedDate";
+      roles[ static_cast<int>(Role::ContactMethod) ] = "contactMethod";
+      roles[ static_cast<int>(Role::Conversation ) ] = "conversation" ;
+   }
+   return roles;
+}
+
+QVariant TextSearchModel::data(const QModelIndex& index, int role) const
+{
+   if ((!index.isValid()) || index.row() >= d_ptr->m_lResults.size())
+      return QVariant();
+
+   const TextSearchModelPrivate::Result& r = d_ptr->m_lResults[index.row()];
+
+   switch (role) {
+      case Qt::DisplayRole:
+         return d_ptr->text(d_ptr->m_lResults[index.row()]);
+      case static_cast<int>(Role::Timestamp):
+         return static_cast<uint>(r.hit.timestamp);
+      case static_cast<int>(Role::FormattedDate):
+         return QDateTime::fromTime_t(r.hit.timestamp).toString();
+      case static_cast<int>(Role::ContactMethod):
+         return QVariant::fromValue(r.contactMethod);
+      case static_cast<int>(Role::Conversation):
+         return r.hit.sha1;
+      case static_cast<int>(Ring::Role::Name):
+         return r.contactMethod ? r.contactMethod->roleData(static_cast<int>(Ring::Role::Name)) : QVariant();
+   }
+
+   return QVariant();
+}
+
+int TextSearchModel::rowCount(const QModelIndex& parent) const
+{
+   return parent.isValid() ? 0 : d_ptr->m_lResults.size();
+}
+
+Qt::ItemFlags TextSearchModel::flags(const QModelIndex& index) const
+{
+   return index.isValid() ? Qt::ItemIsEnabled | Qt::ItemIsSelectable : Qt::NoItemFlags;
+}
+
+/**
+ * The text of a hit, resolved the first time it is displayed. When only the
+ * conversation metadata is loaded, it is read from the disk once for all of
+ * its hits. The views only ask for the visible rows.
+ */
+const QString& TextSearchModelPrivate::text(Result& r)
+{
+   if (r.hasText)
+      return r.text;
+
+   r.hasText = true;
+
+   const TextSearchIndex::Hit& hit = r.hit;
+
+   if (const Serializable::Peers* p = SerializableEntityManager::fromSha1(hit.sha1)) {
+      if (p->isLoaded) {
+         if (hit.group < p->groups.size() && hit.message < p->groups[hit.group]->messages.size())
+            r.text = p->groups[hit.group]->messages[hit.message]->m_PlainText;
+
+         return r.text;
+      }
+   }
+
+   auto i = m_hConversations.constFind(hit.sha1);
+
+   if (i == m_hConversations.constEnd())
+      i = m_hConversations.insert(hit.sha1, LocalTextRecordingCollection::instance().fetchConversation(hit.sha1));
+
+   const QJsonArray groups   = i.value()[QStringLiteral("groups")].toArray();
+   const QJsonArray messages = groups.at(hit.group).toObject()[QStringLiteral("messages")].toArray();
+
+   r.text = TextSearchIndex::plainText(messages.at(hit.message).toObject());
+
+   return r.text;
+}
+
+///Run the query again, the new messages are not added automatically
+void TextSearchModel::refresh()
+{
+   const QVector<TextSearchIndex::Hit> hits = TextSearchIndex::instance().search(
+      d_ptr->m_Query, d_ptr->m_MaxResults
+   );
+
+   QVector<TextSearchModelPrivate::Result> results;
+   results.reserve(hits.size());
+
+   for (const TextSearchIndex::Hit& hit : hits) {
+      const Serializable::Peers* p = SerializableEntityManager::fromSha1(hit.sha1);
+
+      ContactMethod* cm = (p && !p->peers.isEmpty()) ? p->peers.first()->m_pContactMethod : nullptr;
+
+      results << TextSearchModelPrivate::Result { hit, cm, {}, false };
+   }
+
+   beginResetModel();
+   d_ptr->m_lResults = results;
+   d_ptr->m_hConversations.clear();
+   endResetModel();
+}
+
+void TextSearchModel::setQuery(const QString& query)
+{
+   if (query == d_ptr->m_Query)
+      return;
+
+   d_ptr->m_Query = query;
+   refresh();
+}
+
+QString TextSearchModel::query() const
+{
+   return d_ptr->m_Query;
+}
+
+///The maximum number of hits, 0 for all of them (100 by default)
+void TextSearchModel::setMaximumResults(int value)
+{
+   if (value == d_ptr->m_MaxResults)
+      return;
+
+   d_ptr->m_MaxResults = value;
+   refresh();
+}
+
+int TextSearchModel::maximumResults() const
+{
+   return d_ptr->m_MaxResults;
+}
+
+ContactMethod* TextSearchModel::contactMethod(const QModelIndex& idx) const
+{
+   if ((!idx.isValid()) || idx.row() >= d_ptr->m_lResults.size())
+      return nullptr;
+
+   return d_ptr->m_lResults[idx.row()].contactMethod;
+}
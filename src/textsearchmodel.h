@@ -0,0 +1,76 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#pragma once
+
+#include <QtCore/QAbstractListModel>
+#include "typedefs.h"
+#include <itemdataroles.h>
+
+//Ring
+class ContactMethod;
+
+//Private
+class TextSearchModelPrivate;
+
+/**
+ * Search the text messages of every conversation.
+ *
+ * The hits are the messages containing all the words of the query (each word
+ * being matched as a prefix), the most recent first.
+ */
+class LIB_EXPORT TextSearchModel : public QAbstractListModel {
+   Q_OBJECT
+
+public:
+
+   //Properties
+   Q_PROPERTY(QString query READ query WRITE setQuery)
+   Q_PROPERTY(int maximumResults READ maximumResults WRITE setMaximumResults)
+
+   enum class Role {
+      Timestamp     = static_cast<int>(Ring::Role::UserRole) + 1,
+      FormattedDate ,
+      ContactMethod ,
+      Conversation  , /*!< The conversation sha1 */
+   };
+
+   explicit TextSearchModel(QObject* parent = nullptr);
+   virtual ~TextSearchModel();
+
+   //Abstract model member
+   virtual QVariant      data    ( const QModelIndex& index, int role = Qt::DisplayRole ) const override;
+   virtual int           rowCount( const QModelIndex& parent = QModelIndex()            ) const override;
+   virtual Qt::ItemFlags flags   ( const QModelIndex& index                             ) const override;
+
+   virtual QHash<int,QByteArray> roleNames() const override;
+
+   //Setters
+   void setQuery(const QString& query);
+   void setMaximumResults(int value);
+
+   //Getters
+   QString query() const;
+   int maximumResults() const;
+   ContactMethod* contactMethod(const QModelIndex& idx) const;
+
+public Q_SLOTS:
+   void refresh();
+
+private:
+   TextSearchModelPrivate* d_ptr;
+   Q_DECLARE_PRIVATE(TextSearchModel)
+};
@@ -17,11 +17,18 @@
  ***************************************************************************/
 #include "uri.h"
 
+//Qt
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+
+//Ring
 #include "private/matrixutils.h"
 
-#include <QRegularExpression>
+//libSTDC++
+#include <algorithm>
+#include <atomic>
 
-class URIPrivate
+class URIPrivate final : public QSharedData
 {
 public:
    ///Strings associated with SchemeType
@@ -30,11 +37,6 @@ public:
    ///String associated with the transport name
    static const Matrix1D<URI::Transport, const char*> transportNames;
 
-   static const QString whitespaceCharClass;
-
-   static const QRegularExpression startWhitespaceMatcher;
-   static const QRegularExpression endWhitespaceMatcher;
-
    ///Attributes names
    struct Constants {
       constexpr static const char TRANSPORT[] = "transport";
@@ -42,40 +44,53 @@ public:
    };
 
    //Constructor
-   URIPrivate(URI* uri);
-   void commonCopyConstructor(const URI& o);
+   URIPrivate() {}
+   explicit URIPrivate(const QString& uri);
 
    //Attributes
-   QString           m_ExtHostname ;
-   QString           m_Userinfo    ;
-   QStringList       m_lAttributes ;
-   QString           m_Stripped    ;
-   QString           m_Hostname2   ;
-   QByteArray        m_Tag         ;
-   URI::SchemeType   m_HeaderType  ;
-   URI::Transport    m_Transport   ;
-   bool              m_hasChevrons ;
-   bool              m_Parsed      ;
-   bool              m_HasAt       ;
-   URI::ProtocolHint m_ProtocolHint;
-   bool              m_HintParsed  ;
-   bool              m_IsHNParsed  ;
-   int               m_Port        ;
+   QString           m_Stripped     ; /*!< The sections are built from it on access */
+   QByteArray        m_Tag          ;
+   URI::SchemeType   m_HeaderType   {URI::SchemeType::NONE      };
+   URI::Transport    m_Transport    {URI::Transport::NOT_SET    };
+   URI::ProtocolHint m_ProtocolHint {URI::ProtocolHint::SIP_OTHER};
+   int               m_Port         { -1  };
+
+   //Sections offsets in m_Stripped
+   int               m_At           { -1  }; /*!< The '@', -1 if there is none */
+   int               m_HostEnd      {  0  }; /*!< End of the ext hostname      */
+   int               m_NameEnd      { -1  }; /*!< End of the hostname, or -1   */
+
+   //Interning
+   static std::atomic<bool>                                        s_IsInterning;
+   static QMutex                                                   s_InternMutex;
+   static QHash<QString, QExplicitlySharedDataPointer<URIPrivate>> s_hInterned  ;
+
+   //Factories
+   static QExplicitlySharedDataPointer<URIPrivate> empty();
+   static QExplicitlySharedDataPointer<URIPrivate> fromString(const QString& uri);
+
+   //Sections
+   QStringRef userinfo   () const;
+   QStringRef extHostname() const;
+   QStringRef hostname   () const;
 
    //Helper
    static QString strip(const QString& uri, URI::SchemeType& scheme);
+   static bool isWhitespace(ushort c);
    void parse();
-   void parseHostname();
-   static bool checkIp(const QString& str, bool &isHash, const URI::SchemeType& scheme);
-   URI::Transport nameToTransport(const QByteArray& name);
-   void parseAttribute(const QByteArray& extHn, const int start, const int pos);
-private:
-   URI* q_ptr;
+   void parseAttribute(int start, int end);
+   void updateProtocolHint();
+   static bool checkIp(const QStringRef& str, bool &isHash, const URI::SchemeType& scheme);
+   static URI::Transport nameToTransport(const QStringRef& name);
 };
 
 constexpr const char  URIPrivate::Constants::TRANSPORT[];
 constexpr const char  URIPrivate::Constants::TAG      [];
 
+std::atomic<bool>                                        URIPrivate::s_IsInterning {false};
+QMutex                                                   URIPrivate::s_InternMutex;
+QHash<QString, QExplicitlySharedDataPointer<URIPrivate>> URIPrivate::s_hInterned  ;
+
 const Matrix1D<URI::Transport, const char*> URIPrivate::transportNames = {{
    /*NOT_SET*/ "NOT_SET",
    /*TLS    */ "TLS"    ,
@@ -97,96 +112,139 @@ const Matrix1D<URI::SchemeType, const char*> URIPrivate::schemeNames = {{
    /*RING = */ "ring:",
 }};
 
-const QString URIPrivate::whitespaceCharClass = QStringLiteral("[\\h\\x{200B}\\x{200C}\\x{200D}\\x{FEFF}]+");
+URIPrivate::URIPrivate(const QString& uri)
+{
+   m_Stripped = strip(uri, m_HeaderType);
+   parse();
+   updateProtocolHint();
+}
 
-const QRegularExpression URIPrivate::startWhitespaceMatcher = QRegularExpression(
-                                                   "^" + URIPrivate::whitespaceCharClass,
-                                                   QRegularExpression::UseUnicodePropertiesOption);
-const QRegularExpression URIPrivate::endWhitespaceMatcher = QRegularExpression(
-                                                   URIPrivate::whitespaceCharClass + "$",
-                                                   QRegularExpression::UseUnicodePropertiesOption);
+///Shared by all the empty URIs
+QExplicitlySharedDataPointer<URIPrivate> URIPrivate::empty()
+{
+   static QExplicitlySharedDataPointer<URIPrivate> e(new URIPrivate());
+   return e;
+}
 
-URIPrivate::URIPrivate(URI* uri) : m_Parsed(false),m_HeaderType(URI::SchemeType::NONE),q_ptr(uri),
-m_hasChevrons(false),m_HasAt(false),m_ProtocolHint(URI::ProtocolHint::SIP_OTHER),m_HintParsed(false),
-m_IsHNParsed(false),m_Port(-1),m_Transport(URI::Transport::NOT_SET)
+/**
+ * Parse "uri", or reuse the interned result when interning is enabled.
+ *
+ * The interned reference is taken while the lock is held, another thread
+ * can drop the table entry as soon as it is released.
+ */
+QExplicitlySharedDataPointer<URIPrivate> URIPrivate::fromString(const QString& uri)
 {
+   if (uri.isEmpty())
+      return empty();
+
+   if (!s_IsInterning)
+      return QExplicitlySharedDataPointer<URIPrivate>(new URIPrivate(uri));
+
+   QMutexLocker locker(&s_InternMutex);
+
+   auto i = s_hInterned.constFind(uri);
+
+   if (i == s_hInterned.constEnd())
+      i = s_hInterned.insert(uri, QExplicitlySharedDataPointer<URIPrivate>(new URIPrivate(uri)));
+
+   return i.value();
 }
 
 ///Default constructor
-URI::URI() : QString(), d_ptr(new URIPrivate(this))
+URI::URI() : QString(), d_ptr(URIPrivate::empty())
 {
 
 }
 
 ///Constructor
-URI::URI(const QString& other) : URI()
+URI::URI(const QString& other) : QString(), d_ptr(URIPrivate::fromString(other))
 {
-   d_ptr->m_Stripped              = URIPrivate::strip(other,d_ptr->m_HeaderType);
-   (*static_cast<QString*>(this)) = d_ptr->m_Stripped                           ;
+   (*static_cast<QString*>(this)) = d_ptr->m_Stripped;
 }
 
-///Copy constructor
-URI::URI(const URI& o) : URI()
+///Copy constructor, the parsed sections are shared
+URI::URI(const URI& o) : QString(o), d_ptr(o.d_ptr)
 {
-   d_ptr->commonCopyConstructor(o);
 }
 
 ///Destructor
 URI::~URI()
 {
-   (*static_cast<QString*>(this)) = QString();
-   d_ptr->m_Stripped = QString();
-//    delete d_ptr;
-}
-
-void URIPrivate::commonCopyConstructor(const URI& o)
-{
-   //TODO see if a copy on write kind of algo could be used for this
-   m_Parsed       = o.d_ptr->m_Parsed      ;
-   m_HintParsed   = o.d_ptr->m_HintParsed  ;
-   m_ExtHostname  = o.d_ptr->m_ExtHostname ;
-   m_HasAt        = o.d_ptr->m_HasAt       ;
-   m_ProtocolHint = o.d_ptr->m_ProtocolHint;
-   m_HeaderType   = o.d_ptr->m_HeaderType  ;
-   m_Userinfo     = o.d_ptr->m_Userinfo    ;
-   m_Stripped     = o.d_ptr->m_Stripped    ;
-   m_IsHNParsed   = o.d_ptr->m_IsHNParsed  ;
-   m_Port         = o.d_ptr->m_Port        ;
-   m_Transport    = o.d_ptr->m_Transport   ;
-   m_Tag          = o.d_ptr->m_Tag         ;
-
-   (*static_cast<QString*>(q_ptr)) = o.d_ptr->m_Stripped;
 }
 
 /// Copy operator, make sure the cache is also copied
 URI& URI::operator=(const URI& o)
 {
-   d_ptr->commonCopyConstructor(o);
+   d_ptr = o.d_ptr;
+   (*static_cast<QString*>(this)) = o.d_ptr->m_Stripped;
    return (*this);
 }
 
+/**
+ * Share the storage and the parsing of identical URIs.
+ *
+ * The URIs are constructed over and over from the same few strings. When
+ * enabled, each distinct string is parsed once and the copies share the
+ * same buffer, so comparing them stops at the pointer check.
+ *
+ * The interned URIs are kept until interning is disabled again.
+ */
+void URI::setInterningEnabled(bool value)
+{
+   QMutexLocker locker(&URIPrivate::s_InternMutex);
+
+   URIPrivate::s_IsInterning = value;
+
+   if (!value)
+      URIPrivate::s_hInterned.clear();
+}
+
+bool URI::isInterningEnabled()
+{
+   return URIPrivate::s_IsInterning;
+}
+
+///The horizontal whitespace (like the \h class) and the zero width characters
+bool URIPrivate::isWhitespace(ushort c)
+{
+   switch (c) {
+      case 0x0009: case 0x0020: case 0x00A0: case 0x1680: case 0x180E:
+      case 0x202F: case 0x205F: case 0x3000:
+      case 0x200B: case 0x200C: case 0x200D: case 0xFEFF:
+         return true;
+   }
+
+   return c >= 0x2000 && c <= 0x200A;
+}
+
 ///Strip out <sip:****> from the URI
 QString URIPrivate::strip(const QString& uri, URI::SchemeType& scheme)
 {
-   if (uri.isEmpty())
-      return {};
+   const QChar* data = uri.constData();
 
    /* remove whitespace at the start and end */
-   auto uriTrimmed = uri;
-   uriTrimmed.replace(startWhitespaceMatcher, "");
-   uriTrimmed.replace(endWhitespaceMatcher, "");
+   int first(0), end(uri.size()-1);
 
-   int start(uriTrimmed[0] == '<'?1:0),end(uriTrimmed.size()-1); //Other type of comparisons were too slow
+   while (first <= end && isWhitespace(data[first].unicode()))
+      first++;
+
+   while (end >= first && isWhitespace(data[end].unicode()))
+      end--;
+
+   if (first > end)
+      return {};
+
+   int start(data[first] == '<' ? first+1 : first); //Other type of comparisons were too slow
 
    if (start == end+1)
       return {};
 
-   const char c = uriTrimmed[start].toLatin1();
+   const char c = data[start].toLatin1();
 
    //Assume the scheme is either sip or ring using the first letter and length, this
    //is dangerous and can cause undefined behaviour that will cause the call to fail
    //later on, but this is not really a problem for now
-   if (end > start+3 && uriTrimmed[start+3] == ':') {
+   if (end > start+3 && data[start+3] == ':') {
       switch (c) {
          case 's':
             scheme = URI::SchemeType::SIP;
@@ -194,7 +252,7 @@ QString URIPrivate::strip(const QString& uri, URI::SchemeType& scheme)
       }
       start = start +4;
    }
-   else if (end > start+4 && uriTrimmed[start+4] == ':') {
+   else if (end > start+4 && data[start+4] == ':') {
       switch (c) {
          case 'r':
             scheme = URI::SchemeType::RING;
@@ -206,13 +264,14 @@ QString URIPrivate::strip(const QString& uri, URI::SchemeType& scheme)
       start = start +5;
    }
 
-   if (end && uriTrimmed[end] == '>')
+   if (end > first && data[end] == '>')
       end--;
    else if (start) {
       //TODO there may be a ';' section with arguments, check
    }
 
-   return uriTrimmed.mid(start,end-start+1);
+   //When nothing is stripped, this shares the original string
+   return uri.mid(start, std::max(0, end-start+1));
 }
 
 /**
@@ -222,9 +281,7 @@ QString URIPrivate::strip(const QString& uri, URI::SchemeType& scheme)
  */
 QString URI::hostname() const
 {
-   if (!d_ptr->m_Parsed)
-      const_cast<URI*>(this)->d_ptr->parse();
-   return d_ptr->m_ExtHostname;
+   return d_ptr->extHostname().toString();
 }
 
 /**
@@ -234,20 +291,15 @@ QString URI::hostname() const
  */
 bool URI::hasHostname() const
 {
-   if (!d_ptr->m_Parsed)
-      const_cast<URI*>(this)->d_ptr->parse();
-   return !d_ptr->m_ExtHostname.isEmpty();
+   return !d_ptr->extHostname().isEmpty();
 }
 
 /**
- * If hasHostname() is true, this does a second parsing of the hostname to
- * extract the port.
+ * If hasHostname() is true, this checks if the hostname is followed by a
+ * port.
  */
 bool URI::hasPort() const
 {
-   if (!d_ptr->m_IsHNParsed) {
-      d_ptr->parseHostname();
-   }
    return d_ptr->m_Port != -1;
 }
 
@@ -256,9 +308,6 @@ bool URI::hasPort() const
  */
 int  URI::port() const
 {
-   if (!d_ptr->m_IsHNParsed) {
-      d_ptr->parseHostname();
-   }
    return d_ptr->m_Port;
 }
 
@@ -267,8 +316,6 @@ int  URI::port() const
  */
 URI::SchemeType URI::schemeType() const
 {
-   if (!d_ptr->m_Parsed)
-      const_cast<URI*>(this)->d_ptr->parse();
    return d_ptr->m_HeaderType;
 }
 
@@ -279,9 +326,9 @@ URI::SchemeType URI::schemeType() const
  * @param str an uservalue (faster the scheme and before the "at" sign)
  * @param [out] isHash if the content is pure hexadecimal ASCII
  */
-bool URIPrivate::checkIp(const QString& str, bool &isHash, const URI::SchemeType& scheme)
+bool URIPrivate::checkIp(const QStringRef& str, bool &isHash, const URI::SchemeType& scheme)
 {
-   const QByteArray raw = str.toLatin1();
+   const QChar* raw = str.constData();
    int max = str.size();
 
    if (max < 3 || max > 45 || (!isHash && scheme == URI::SchemeType::RING))
@@ -290,7 +337,7 @@ bool URIPrivate::checkIp(const QString& str, bool &isHash, const URI::SchemeType
    uchar dc(0),sc(0),i(0),d(0),hx(1);
 
    while (i < max) {
-      switch(raw[i]) {
+      switch(raw[i].unicode()) {
          case '.':
             isHash = false;
             d = 0;
@@ -327,169 +374,136 @@ bool URIPrivate::checkIp(const QString& str, bool &isHash, const URI::SchemeType
  * This method return an hint to guess the protocol that could be used to call
  * this URI. It is a quick guess, not something that should be trusted
  *
- * @warning, this method is O(N) when called for the first time on an URI
+ * @note It is computed when the URI is parsed
  */
- URI::ProtocolHint URI::protocolHint() const
- {
-    if (!d_ptr->m_Parsed)
-       const_cast<URI*>(this)->d_ptr->parse();
+URI::ProtocolHint URI::protocolHint() const
+{
+   return d_ptr->m_ProtocolHint;
+}
 
-    if (!d_ptr->m_HintParsed) {
-       bool isHash = d_ptr->m_Userinfo.size() == 40;
+void URIPrivate::updateProtocolHint()
+{
+   const QStringRef info = userinfo();
 
-       URI::ProtocolHint hint;
+   bool isHash = info.size() == 40;
 
-       //Step 1: Check IP
-       if (URIPrivate::checkIp(d_ptr->m_Userinfo, isHash, d_ptr->m_HeaderType)) {
-           hint = URI::ProtocolHint::IP;
-       }
-       //Step 2: Check RING hash
-       else if (isHash)
-       {
-           hint = URI::ProtocolHint::RING;
-       }
-       //Step 3: Not a hash but it begins with ring:. This is a username.
-       else if (d_ptr->m_HeaderType == URI::SchemeType::RING){
-           hint = URI::ProtocolHint::RING_USERNAME;
-       }
-       //Step 4: Check for SIP URIs
-       else if (d_ptr->m_HeaderType == URI::SchemeType::SIP)
-       {
-           //Step 4.1: Check for SIP URI with hostname
-           if (d_ptr->m_HasAt) {
-               hint = URI::ProtocolHint::SIP_HOST;
-           }
-           //Step 4.2: Assume SIP URI without hostname
-           else {
-               hint = URI::ProtocolHint::SIP_OTHER;
-           }
+   URI::ProtocolHint hint;
+
+   //Step 1: Check IP
+   if (checkIp(info, isHash, m_HeaderType)) {
+       hint = URI::ProtocolHint::IP;
+   }
+   //Step 2: Check RING hash
+   else if (isHash)
+   {
+       hint = URI::ProtocolHint::RING;
+   }
+   //Step 3: Not a hash but it begins with ring:. This is a username.
+   else if (m_HeaderType == URI::SchemeType::RING){
+       hint = URI::ProtocolHint::RING_USERNAME;
+   }
+   //Step 4: Check for SIP URIs
+   else if (m_HeaderType == URI::SchemeType::SIP)
+   {
+       //Step 4.1: Check for SIP URI with hostname
+       if (m_At != -1) {
+           hint = URI::ProtocolHint::SIP_HOST;
        }
-       //Step 5: Assume SIP
+       //Step 4.2: Assume SIP URI without hostname
        else {
            hint = URI::ProtocolHint::SIP_OTHER;
        }
+   }
+   //Step 5: Assume SIP
+   else {
+       hint = URI::ProtocolHint::SIP_OTHER;
+   }
 
-       d_ptr->m_ProtocolHint = hint;
-       d_ptr->m_HintParsed = true;
-    }
-    return d_ptr->m_ProtocolHint;
- }
-
-///Convert the transport name to a string
-URI::Transport URIPrivate::nameToTransport(const QByteArray& name)
-{
-   if (name == transportNames[URI::Transport::NOT_SET  ])
-      return URI::Transport::NOT_SET;
-   else if (name == transportNames[URI::Transport::TLS ])
-      return URI::Transport::TLS    ;
-   else if (name == transportNames[URI::Transport::tls ])
-      return URI::Transport::tls    ;
-   else if (name == transportNames[URI::Transport::TCP ])
-      return URI::Transport::TCP    ;
-   else if (name == transportNames[URI::Transport::tcp ])
-      return URI::Transport::tcp    ;
-   else if (name == transportNames[URI::Transport::UDP ])
-      return URI::Transport::UDP    ;
-   else if (name == transportNames[URI::Transport::udp ])
-      return URI::Transport::udp    ;
-   else if (name == transportNames[URI::Transport::SCTP])
-      return URI::Transport::SCTP   ;
-   else if (name == transportNames[URI::Transport::sctp])
-      return URI::Transport::sctp   ;
-   else if (name == transportNames[URI::Transport::DTLS])
-      return URI::Transport::DTLS   ;
-   else if (name == transportNames[URI::Transport::dtls])
-      return URI::Transport::dtls   ;
-   return URI::Transport::NOT_SET   ;
+   m_ProtocolHint = hint;
 }
 
-///Keep a cache of the values to avoid re-parsing them
-void URIPrivate::parse()
+///Convert the transport name to a string
+URI::Transport URIPrivate::nameToTransport(const QStringRef& name)
 {
-   //FIXME the indexOf is done twice, the second time could be avoided
-   if (q_ptr->indexOf('@') != -1) {
-      const QStringList split = q_ptr->split('@');
-      m_HasAt       = true;
-      m_ExtHostname = split[1];
-      m_Userinfo    = split[0];
-      m_Parsed      = true;
+   for (const URI::Transport t : EnumIterator<URI::Transport>()) {
+      if (name == QLatin1String(transportNames[t]))
+         return t;
    }
-   else
-      m_Userinfo = (*q_ptr);
+
+   return URI::Transport::NOT_SET;
 }
 
-void URIPrivate::parseAttribute(const QByteArray& extHn, const int start, const int pos)
+/**
+ * Locate all the sections in a single pass over the stripped URI.
+ *
+ * <code>
+ *    888@192.168.48.213:5060;transport=TLS;tag=b5c73d9ef
+ *    \_/ \______________/ \__/ \___________/ \_________/
+ *     |          |          |        |____________|
+ *  userinfo  hostname     port    attributes
+ *             \_______________________________________/
+ *                             |
+ *                        ext hostname
+ * </code>
+ *
+ * Only the offsets are kept, the sections are copied when they are read.
+ */
+void URIPrivate::parse()
 {
-   const QList<QByteArray> parts = extHn.mid(start+1,pos-start).split('=');
+   const QChar* data   = m_Stripped.constData();
+   const int    length = m_Stripped.size();
 
-   if (parts.size() == 2) {
-      if (parts[0].toLower() == Constants::TRANSPORT) {
-         m_Transport = nameToTransport(parts[1]);
-      }
-      else if (parts[0].toLower() == Constants::TAG) {
-         m_Tag = parts[1];
-      }
-   }
-}
+   URI::Section section = URI::Section::USER_INFO;
 
-///Extract the hostname, port and attributes
-void URIPrivate::parseHostname()
-{
-   if (!m_Parsed)
-      parse();
+   int at(-1), hostEnd(length), nameEnd(-1), portStart(-1), attrStart(-1);
 
-   const QByteArray extHn = q_ptr->hostname().toLatin1();
-   int length(extHn.size()), start(0);
-   bool inAttributes = false;
+   for (int i = 0; i < length; i++) {
+      const ushort c = data[i].unicode();
 
-   URI::Section section = URI::Section::HOSTNAME;
+      if (c == '@') {
+         //Anything after a second '@' is ignored
+         if (at != -1) {
+            hostEnd = i;
+            break;
+         }
 
-   // in case no port, attributes, etc are provided
-   m_Hostname2 = q_ptr->hostname();
+         at      = i;
+         section = URI::Section::HOSTNAME;
+         continue;
+      }
+
+      if (section == URI::Section::USER_INFO)
+         continue;
 
-   for (int i = 0; i < length; i++) {
-      const char c = extHn[i];
       switch (c) {
          case ':': //Begin port
+            if (section == URI::Section::HOSTNAME) {
+               nameEnd   = i;
+               portStart = i+1;
+               section   = URI::Section::PORT;
+            }
+            break;
+         case ';': //Begin attributes
             switch(section) {
                case URI::Section::HOSTNAME:
-                  m_Hostname2 = extHn.mid(start,i);
-                  start = i;
-                  section = URI::Section::PORT;
+                  nameEnd = i;
+                  break;
+               case URI::Section::PORT:
+                  m_Port = QStringRef(&m_Stripped, portStart, i-portStart).toInt();
+                  break;
+               case URI::Section::TRANSPORT:
+                  parseAttribute(attrStart, i);
                   break;
                case URI::Section::USER_INFO:
                case URI::Section::CHEVRONS :
                case URI::Section::SCHEME   :
-               case URI::Section::TRANSPORT:
                case URI::Section::TAG      :
-               case URI::Section::PORT     :
                   break;
             }
-            break;
-         case ';': //Begin attributes
-
-            if (inAttributes) {
-               parseAttribute(extHn, start, i);
-            }
-            else {
-               switch(section) {
-                  case URI::Section::HOSTNAME:
-                     m_Hostname2 = extHn.mid(start+1,i-start);
-                     break;
-                  case URI::Section::PORT:
-                     m_Port = extHn.mid(start+1,i-start-1).toInt();
-                     break;
-                  case URI::Section::USER_INFO:
-                  case URI::Section::CHEVRONS :
-                  case URI::Section::SCHEME   :
-                  case URI::Section::TRANSPORT:
-                  case URI::Section::TAG      :
-                     break;
-               }
-               inAttributes = true;
-            }
 
-            start = i;
+            // All the attributes are handled the same way
+            section   = URI::Section::TRANSPORT;
+            attrStart = i+1;
             break;
          case '#': //Begin fragments
             //TODO handle fragments to comply to the RFC
@@ -499,10 +513,66 @@ void URIPrivate::parseHostname()
       }
    }
 
-   ///Get the remaining attribute
-   parseAttribute(extHn, start, length-1);
+   if (at == -1)
+      return;
+
+   //Get the remaining section
+   switch(section) {
+      case URI::Section::PORT:
+         m_Port = QStringRef(&m_Stripped, portStart, hostEnd-portStart).toInt();
+         break;
+      case URI::Section::TRANSPORT:
+         parseAttribute(attrStart, hostEnd);
+         break;
+      case URI::Section::HOSTNAME :
+      case URI::Section::USER_INFO:
+      case URI::Section::CHEVRONS :
+      case URI::Section::SCHEME   :
+      case URI::Section::TAG      :
+         break;
+   }
 
-   m_IsHNParsed = true;
+   m_At      = at;
+   m_HostEnd = hostEnd;
+   m_NameEnd = nameEnd;
+}
+
+///The whole buffer when there is no '@'
+QStringRef URIPrivate::userinfo() const
+{
+   return m_At == -1 ? QStringRef(&m_Stripped) : QStringRef(&m_Stripped, 0, m_At);
+}
+
+///The hostname with the port and attributes
+QStringRef URIPrivate::extHostname() const
+{
+   return m_At == -1 ? QStringRef() : QStringRef(&m_Stripped, m_At+1, m_HostEnd-m_At-1);
+}
+
+QStringRef URIPrivate::hostname() const
+{
+   return m_NameEnd == -1 ? extHostname() : QStringRef(&m_Stripped, m_At+1, m_NameEnd-m_At-1);
+}
+
+///Parse a "name=value" attribute in [start, end)
+void URIPrivate::parseAttribute(int start, int end)
+{
+   const QStringRef attribute(&m_Stripped, start, end-start);
+   const int equal = attribute.indexOf('=');
+
+   //There must be exactly one '='
+   if (equal == -1 || attribute.indexOf('=', equal+1) != -1)
+      return;
+
+   const QStringRef name  = attribute.left(equal);
+   const QStringRef value = attribute.mid(equal+1);
+
+   if (name.compare(QLatin1String(Constants::TRANSPORT), Qt::CaseInsensitive) == 0) {
+      m_Transport = nameToTransport(value);
+   }
+   else if (name.compare(QLatin1String(Constants::TAG), Qt::CaseInsensitive) == 0) {
+      m_Tag = value.toLatin1();
+   }
 }
 
 /**
@@ -512,9 +582,7 @@ void URIPrivate::parseHostname()
  */
 QString URI::userinfo() const
 {
-   if (!d_ptr->m_Parsed)
-      const_cast<URI*>(this)->d_ptr->parse();
-   return d_ptr->m_Userinfo;
+   return d_ptr->userinfo().toString();
 }
 
 /**
@@ -523,7 +591,13 @@ QString URI::userinfo() const
  */
 void URI::setSchemeType(SchemeType t)
 {
-    d_ptr->m_HeaderType = t;
+   if (t == d_ptr->m_HeaderType)
+      return;
+
+   //The parsed sections may be shared with other URIs
+   d_ptr.detach();
+   d_ptr->m_HeaderType = t;
+   d_ptr->updateProtocolHint();
 }
 
 /**
@@ -534,10 +608,6 @@ void URI::setSchemeType(SchemeType t)
  */
 QString URI::format(FlagPack<URI::Section> sections) const
 {
-   if (!d_ptr->m_IsHNParsed) {
-      d_ptr->parseHostname();
-   }
-
    QString ret;
 
    if (sections & URI::Section::CHEVRONS)
@@ -567,10 +637,12 @@ QString URI::format(FlagPack<URI::Section> sections) const
    }
 
    if (sections & URI::Section::USER_INFO)
-      ret += d_ptr->m_Userinfo;
+      ret += d_ptr->userinfo();
 
-   if (sections & URI::Section::HOSTNAME && !d_ptr->m_Hostname2.isEmpty())
-      ret += '@' + d_ptr->m_Hostname2;
+   if (sections & URI::Section::HOSTNAME && !d_ptr->hostname().isEmpty()) {
+      ret += '@';
+      ret += d_ptr->hostname();
+   }
 
    if (sections & URI::Section::PORT && d_ptr->m_Port != -1)
       ret += ':' + QString::number(d_ptr->m_Port);
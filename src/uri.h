@@ -20,6 +20,7 @@
 #include "typedefs.h"
 
 #include <QStringList>
+#include <QtCore/QSharedDataPointer>
 
 class URIPrivate;
 class QDataStream;
@@ -181,6 +182,10 @@ public:
    //Setter
    void setSchemeType(SchemeType t);
 
+   //Static
+   static void setInterningEnabled(bool value);
+   static bool isInterningEnabled();
+
    //Converter
    QString format(FlagPack<URI::Section> sections) const;
 
@@ -193,7 +198,7 @@ public:
    URI& operator=(const URI&);
 
 private:
-   const QScopedPointer<URIPrivate> d_ptr;
+   QExplicitlySharedDataPointer<URIPrivate> d_ptr;
 };
 Q_DECLARE_METATYPE(URI)
 
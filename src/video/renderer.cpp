@@ -19,20 +19,40 @@
 
 //Ring
 #include "private/videorenderer_p.h"
+#include "private/videoconversion.h"
 
 //Qt
 #include <QtCore/QMutex>
 
+//libSTDC++
+#include <algorithm>
+
 Video::RendererPrivate::RendererPrivate(Video::Renderer* parent)
     : QObject(parent)
     , m_isRendering(false)
     , m_pMutex(new QMutex())
+    , m_OutputColorSpace(Video::Renderer::ColorSpace::BGRA)
+    , m_HasOutputColorSpace(false)
+    , m_PeriodStart(Clock::now())
+    , m_PeriodFrames(0)
+    , m_PeriodLockNs(0)
+    , m_ProducedAt(0)
     , q_ptr(parent)
 {
+   m_lLatencies.reserve(LATENCY_SAMPLES);
+
+   connect(this, &RendererPrivate::periodEnded, parent, &Renderer::statisticsUpdated,
+      Qt::QueuedConnection);
 }
 
 Video::Renderer::Renderer(const QByteArray& id, const QSize& res) : d_ptr(new RendererPrivate(this))
 {
+   static bool registered = false;
+   if (!registered) {
+      qRegisterMetaType<Video::RendererStatistics>();
+      registered = true;
+   }
+
    setObjectName("Renderer:"+id);
    d_ptr->m_pSize     = res;
    d_ptr->m_Id        = id;
@@ -67,6 +87,250 @@ QSize Video::Renderer::size() const
   return d_ptr->m_pSize;
 }
 
+/**
+ * Get the current frame as a lease.
+ *
+ * The default implementation copies currentFrame() into the lease so
+ * renderers which can't pin their memory keep working.
+ */
+Video::FrameLease Video::Renderer::leaseFrame() const
+{
+  Frame frame = currentFrame();
+
+  if (!frame.ptr)
+     return {};
+
+  auto copy = std::make_shared<Frame>();
+
+  if (frame.storage.size() == frame.size)
+     copy->storage = std::move(frame.storage);
+  else
+     copy->storage.assign(frame.ptr, frame.ptr + frame.size);
+
+  copy->ptr  = copy->storage.data();
+  copy->size = copy->storage.size();
+
+  return copy;
+}
+
+///Return the frame statistics of the last complete period
+Video::RendererStatistics Video::Renderer::statistics() const
+{
+  QMutexLocker lk(&d_ptr->m_StatisticsMutex);
+  return d_ptr->m_Statistics;
+}
+
+///Return the color space of convertedFrame(), colorSpace() unless set
+Video::Renderer::ColorSpace Video::Renderer::outputColorSpace() const
+{
+  return d_ptr->m_HasOutputColorSpace ? d_ptr->m_OutputColorSpace : colorSpace();
+}
+
+///Return the size of convertedFrame(), size() unless a smaller one is set
+QSize Video::Renderer::outputSize() const
+{
+  const QSize s = size();
+
+  if (d_ptr->m_OutputSize.isEmpty() || d_ptr->m_OutputSize.width() > s.width()
+    || d_ptr->m_OutputSize.height() > s.height())
+     return s;
+
+  return d_ptr->m_OutputSize;
+}
+
+/**
+ * Get the current frame after the conversion stage.
+ *
+ * The frame is first downscaled to outputSize() (repeated 2x2 box filter,
+ * then nearest neighbour for the remainder) and converted to
+ * outputColorSpace(). When neither is set, this is the same as
+ * currentFrame(). Otherwise the returned frame points to a buffer owned by
+ * the renderer which is valid until the next call.
+ *
+ * This is intended to replace per pixel loops in the clients, the kernels
+ * use SSE2/AVX2 when the CPU support them.
+ */
+Video::Frame Video::Renderer::convertedFrame() const
+{
+  const ColorSpace source = colorSpace();
+  const ColorSpace target = outputColorSpace();
+  const QSize      from   = size();
+  const QSize      to     = outputSize();
+
+  if (source == target && from == to)
+     return currentFrame();
+
+  // Pin the frame while converting it
+  const FrameLease lease = leaseFrame();
+
+  if ((!lease) || (!lease->ptr) || from.isEmpty()
+    || lease->size < static_cast<std::size_t>(from.width()*from.height()*4))
+     return {};
+
+  QMutexLocker lk(&d_ptr->m_ConversionMutex);
+
+  const uint8_t* src = lease->ptr;
+  int w = from.width ();
+  int h = from.height();
+
+  // Downscale, the buffers grow once and are reused for the next frames
+  std::vector<uint8_t>* buf   = &d_ptr->m_ScaleBuffer ;
+  std::vector<uint8_t>* spare = &d_ptr->m_ScaleBuffer2;
+
+  while (w/2 >= to.width() && h/2 >= to.height()) {
+     buf->resize(static_cast<std::size_t>((w/2)*(h/2)*4));
+     Conversion::halve(src, buf->data(), w, h);
+     src = buf->data();
+     w  /= 2;
+     h  /= 2;
+     std::swap(buf, spare);
+  }
+
+  if (w != to.width() || h != to.height()) {
+     buf->resize(static_cast<std::size_t>(to.width()*to.height()*4));
+     Conversion::resize(src, w, h, buf->data(), to.width(), to.height());
+     src = buf->data();
+     w   = to.width ();
+     h   = to.height();
+  }
+
+  const bool srcIsRgba = source == ColorSpace::RGBA;
+  std::vector<uint8_t>& out = d_ptr->m_OutputBuffer;
+
+  switch (target) {
+     case ColorSpace::BGRA:
+     case ColorSpace::RGBA:
+        out.resize(static_cast<std::size_t>(w*h*4));
+        if (source == target)
+           std::copy(src, src + out.size(), out.begin());
+        else
+           Conversion::swapRedBlue(src, out.data(), static_cast<std::size_t>(w*h));
+        break;
+     case ColorSpace::I420:
+        out.resize(Conversion::yuv420Size(w, h));
+        Conversion::toI420(src, out.data(), w, h, srcIsRgba);
+        break;
+     case ColorSpace::NV12:
+        out.resize(Conversion::yuv420Size(w, h));
+        Conversion::toNV12(src, out.data(), w, h, srcIsRgba);
+        break;
+  }
+
+  Frame frame;
+  frame.ptr  = out.data();
+  frame.size = out.size();
+  return frame;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *                               Statistics                                  *
+ *                                                                           *
+ ****************************************************************************/
+
+qint64 Video::RendererPrivate::now()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now().time_since_epoch()
+   ).count();
+}
+
+/**
+ * A new frame is available (producer side, any thread).
+ *
+ * @param producedAt the now() time at which the producer published the frame
+ */
+void Video::RendererPrivate::frameProduced(qint64 producedAt)
+{
+   m_ProducedAt = producedAt;
+}
+
+///A new frame has been handed to the client
+void Video::RendererPrivate::frameDelivered()
+{
+   const qint64 producedAt = m_ProducedAt;
+
+   QMutexLocker lk(&m_StatisticsMutex);
+
+   ++m_Statistics.deliveredFrames;
+   ++m_PeriodFrames;
+
+   if (producedAt) {
+      const qint64 latency = now() - producedAt;
+
+      if (m_lLatencies.size() < static_cast<std::size_t>(LATENCY_SAMPLES))
+         m_lLatencies.push_back(latency);
+      else
+         m_lLatencies[m_PeriodFrames % LATENCY_SAMPLES] = latency;
+   }
+
+   updatePeriod(lk);
+}
+
+///The client asked for a frame but the last one was already delivered
+void Video::RendererPrivate::frameDuplicated()
+{
+   QMutexLocker lk(&m_StatisticsMutex);
+   ++m_Statistics.duplicateFrames;
+   updatePeriod(lk);
+}
+
+void Video::RendererPrivate::framesDropped(quint64 count)
+{
+   QMutexLocker lk(&m_StatisticsMutex);
+   m_Statistics.droppedFrames += count;
+}
+
+void Video::RendererPrivate::lockReleased(qint64 heldNs)
+{
+   QMutexLocker lk(&m_StatisticsMutex);
+   m_PeriodLockNs += heldNs;
+}
+
+void Video::RendererPrivate::shmRemapped()
+{
+   QMutexLocker lk(&m_StatisticsMutex);
+   ++m_Statistics.remapCount;
+}
+
+///Close the period if it is over and notify the clients
+void Video::RendererPrivate::updatePeriod(QMutexLocker& lk)
+{
+   const auto current = Clock::now();
+   const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      current - m_PeriodStart
+   ).count();
+
+   if (elapsed < STATISTICS_PERIOD_MS)
+      return;
+
+   m_Statistics.fps        = m_PeriodFrames * 1000.0 / elapsed;
+   m_Statistics.lockHoldUs = m_PeriodLockNs / 1000;
+
+   const auto percentile = [this](std::size_t p) -> qint64 {
+      if (m_lLatencies.empty())
+         return 0;
+
+      const auto nth = m_lLatencies.begin() + (m_lLatencies.size() - 1) * p / 100;
+      std::nth_element(m_lLatencies.begin(), nth, m_lLatencies.end());
+      return *nth / 1000;
+   };
+
+   m_Statistics.latencyP50Us = percentile(50);
+   m_Statistics.latencyP90Us = percentile(90);
+   m_Statistics.latencyP99Us = percentile(99);
+
+   m_PeriodStart  = current;
+   m_PeriodFrames = 0;
+   m_PeriodLockNs = 0;
+   m_lLatencies.clear();
+
+   const RendererStatistics stats = m_Statistics;
+   lk.unlock();
+
+   emit periodEnded(stats);
+}
+
 /*****************************************************************************
  *                                                                           *
  *                                 Setters                                   *
@@ -78,4 +342,17 @@ void Video::Renderer::setSize(const QSize& size) const
   d_ptr->m_pSize = size;
 }
 
+///Set the color space of convertedFrame()
+void Video::Renderer::setOutputColorSpace(ColorSpace space)
+{
+  d_ptr->m_OutputColorSpace    = space;
+  d_ptr->m_HasOutputColorSpace = true ;
+}
+
+///Set the size of convertedFrame(), an empty size disable the downscaling
+void Video::Renderer::setOutputSize(const QSize& size)
+{
+  d_ptr->m_OutputSize = size;
+}
+
 #include <renderer.moc>
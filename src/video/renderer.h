@@ -46,7 +46,8 @@ class DirectRenderer;
  * that could be owned by instances of this class or shared.
  * If an instance carries data, "storage.size()" is greater than 0
  * and equals to "size", "ptr" is equals to "storage.data()".
- * If shared data is carried, only "ptr" and "size" are set.
+ * If shared data is carried, only "ptr" and "size" are set and the data
+ * is valid until the next call to Renderer::currentFrame().
  */
 struct Frame {
    uint8_t*             ptr     { nullptr };
@@ -54,6 +55,36 @@ struct Frame {
    std::vector<uint8_t> storage {         };
 };
 
+/**
+ * Reference counted handle on a frame, see Renderer::leaseFrame().
+ *
+ * The frame data stays valid until the last copy of the lease is released
+ * (destroyed or reset()). Depending on the renderer, the lease either pins
+ * the renderer memory (DirectRenderer) or owns a copy of the frame in
+ * "storage" (ShmRenderer and the default implementation). Leases can be
+ * released from any thread, including after the renderer itself is
+ * destroyed.
+ */
+using FrameLease = std::shared_ptr<const Frame>;
+
+/**
+ * Frame delivery statistics of a Renderer, see Renderer::statistics().
+ *
+ * The frame counters are totals since the renderer was created. The frame
+ * rate, lock time and latency percentiles cover the last period only.
+ */
+struct RendererStatistics {
+   double  fps             { 0 }; /*!< Frames delivered per second                       */
+   quint64 deliveredFrames { 0 }; /*!< New frames handed to the client                   */
+   quint64 droppedFrames   { 0 }; /*!< Frames produced but never handed to the client    */
+   quint64 duplicateFrames { 0 }; /*!< Frame requests without a new frame available      */
+   quint64 remapCount      { 0 }; /*!< Shared memory remaps (SHM renderer only)          */
+   qint64  lockHoldUs      { 0 }; /*!< Time spent holding the SHM semaphore              */
+   qint64  latencyP50Us    { 0 }; /*!< Median time between a frame is produced and taken */
+   qint64  latencyP90Us    { 0 }; /*!< 90th percentile of the latency                    */
+   qint64  latencyP99Us    { 0 }; /*!< 99th percentile of the latency                    */
+};
+
 /**
  * This class provide a rendering object to be used by clients
  * to get the video content. This object is not intended to be
@@ -81,8 +112,10 @@ public:
     * client on multiple platforms, they need to check the colorspace.
     */
    enum class ColorSpace {
-      BGRA , /*!< 32bit BLUE  GREEN RED ALPHA */
-      RGBA , /*!< 32bit ALPHA GREEN RED BLUE  */
+      BGRA , /*!< 32bit BLUE  GREEN RED ALPHA                   */
+      RGBA , /*!< 32bit ALPHA GREEN RED BLUE                    */
+      I420 , /*!< 8bit planar Y, U and V, 4:2:0 (output only)   */
+      NV12 , /*!< 8bit planar Y then interleaved UV (output only) */
    };
 
    //Constructor
@@ -92,16 +125,36 @@ public:
    //Getters
    virtual bool       isRendering     () const;
    virtual Frame currentFrame    () const = 0;
+   virtual FrameLease leaseFrame () const;
    virtual QSize      size            () const;
    virtual QMutex*    mutex           () const;
    virtual ColorSpace colorSpace      () const = 0;
 
+   //Conversion stage
+   ColorSpace outputColorSpace() const;
+   QSize      outputSize      () const;
+   Frame      convertedFrame  () const;
+
+   //Instrumentation
+   RendererStatistics statistics() const;
+
    void setSize(const QSize& size) const;
+   void setOutputColorSpace(ColorSpace space);
+   void setOutputSize(const QSize& size);
 
 Q_SIGNALS:
-   void frameUpdated(); // Emitted when a new frame is ready
+   /**
+    * Emitted when a new frame is ready.
+    *
+    * It is emitted from a video thread (the daemon sink callback or the SHM
+    * frame waiter), not from the renderer thread. Connect it with a context
+    * object or a queued connection to handle it in the GUI thread.
+    */
+   void frameUpdated();
    void stopped     ();
    void started     ();
+   /// Emitted at most once per second while frames are requested
+   void statisticsUpdated(const Video::RendererStatistics& stats);
 
 public Q_SLOTS:
    virtual void startRendering() = 0;
@@ -114,3 +167,5 @@ private:
 };
 
 }
+
+Q_DECLARE_METATYPE(Video::RendererStatistics)
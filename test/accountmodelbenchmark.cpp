@@ -0,0 +1,156 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//Qt
+#include <QtTest/QtTest>
+
+//Ring
+#include "account.h"
+#include "accountmodel.h"
+#include "private/accountmodel_p.h"
+
+/**
+ * Measure how the cost of the account related daemon signals grows with the
+ * number of accounts.
+ *
+ * The accounts are only created in the model, they are never saved. Like the
+ * clients, this needs a running daemon to get the account templates.
+ */
+class AccountModelBenchmark : public QObject
+{
+   Q_OBJECT
+
+private:
+   QVector<Account*> m_lAccounts;
+
+   ///Grow the model to "count" benchmark accounts
+   void populate(int count);
+   static QByteArray id(int i);
+
+   static void counts();
+
+private Q_SLOTS:
+   void initTestCase();
+   void cleanupTestCase();
+
+   void getById_data();
+   void getById();
+   void accountIndex_data();
+   void accountIndex();
+   void registrationStateChanged_data();
+   void registrationStateChanged();
+};
+
+QByteArray AccountModelBenchmark::id(int i)
+{
+   return "lrcbenchmark" + QByteArray::number(i);
+}
+
+void AccountModelBenchmark::populate(int count)
+{
+   while (m_lAccounts.size() < count) {
+      const int i = m_lAccounts.size();
+
+      Account* a = AccountModel::instance().add(QString::fromLatin1(id(i)), Account::Protocol::SIP);
+      a->setHostname(QStringLiteral("host%1.example.com").arg(i % 10));
+      a->setId(id(i));
+
+      m_lAccounts << a;
+   }
+}
+
+void AccountModelBenchmark::counts()
+{
+   QTest::addColumn<int>("count");
+
+   for (const int count : {1, 10, 100, 1000})
+      QTest::newRow(qPrintable(QString::number(count))) << count;
+}
+
+void AccountModelBenchmark::initTestCase()
+{
+   AccountModel::instance();
+}
+
+void AccountModelBenchmark::cleanupTestCase()
+{
+   for (Account* a : m_lAccounts)
+      AccountModel::instance().remove(a);
+
+   m_lAccounts.clear();
+}
+
+void AccountModelBenchmark::getById_data()
+{
+   counts();
+}
+
+///The lookup done by every account signal handler
+void AccountModelBenchmark::getById()
+{
+   QFETCH(int, count);
+   populate(count);
+
+   const QByteArray last = id(count - 1);
+
+   QBENCHMARK {
+      QVERIFY(AccountModel::instance().getById(last));
+   }
+}
+
+void AccountModelBenchmark::accountIndex_data()
+{
+   counts();
+}
+
+///Used to emit dataChanged() for an account
+void AccountModelBenchmark::accountIndex()
+{
+   QFETCH(int, count);
+   populate(count);
+
+   Account* a = m_lAccounts[count - 1];
+
+   QBENCHMARK {
+      QVERIFY(a->index().isValid());
+   }
+}
+
+void AccountModelBenchmark::registrationStateChanged_data()
+{
+   counts();
+}
+
+///The whole handler of ConfigurationManagerInterface::registrationStateChanged
+void AccountModelBenchmark::registrationStateChanged()
+{
+   QFETCH(int, count);
+   populate(count);
+
+   AccountModelPrivate* d = AccountModel::instance().findChild<AccountModelPrivate*>();
+   QVERIFY(d);
+
+   const QString last = QString::fromLatin1(id(count - 1));
+
+   QBENCHMARK {
+      d->slotDaemonAccountChanged(last, QStringLiteral("REGISTERED"), 200, QStringLiteral("OK"));
+   }
+}
+
+QTEST_GUILESS_MAIN(AccountModelBenchmark)
+
+#include "accountmodelbenchmark.moc"
@@ -0,0 +1,339 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//Qt
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+//Ring
+#include "call.h"
+#include "private/historystore.h"
+
+using HistoryMap = HistoryStore::HistoryMap;
+
+class HistoryStoreTest : public QObject
+{
+   Q_OBJECT
+
+private:
+   QTemporaryDir m_Dir;
+
+   QString path() const;
+   static HistoryMap call(const QString& id, qint64 start, const QString& name = QString());
+
+private Q_SLOTS:
+   void init();
+
+   void appendAndRead();
+   void supersede();
+   void tombstone();
+   void removeUnknown();
+   void truncatedRecord();
+   void damagedChecksum();
+   void compact();
+   void automaticCompaction();
+   void expire();
+   void readByIdAfterCompaction();
+};
+
+QString HistoryStoreTest::path() const
+{
+   return m_Dir.filePath(QStringLiteral("history.bin"));
+}
+
+HistoryMap HistoryStoreTest::call(const QString& id, qint64 start, const QString& name)
+{
+   HistoryMap ret;
+   ret[Call::HistoryMapFields::CALLID         ] = id;
+   ret[Call::HistoryMapFields::PEER_NUMBER    ] = QStringLiteral("sip:") + id + QStringLiteral("@example.com");
+   ret[Call::HistoryMapFields::TIMESTAMP_START] = QString::number(start);
+   ret[Call::HistoryMapFields::TIMESTAMP_STOP ] = QString::number(start + 60);
+   ret[Call::HistoryMapFields::DISPLAY_NAME   ] = name.isEmpty() ? id : name;
+   ret[QStringLiteral("custom_field")         ] = QStringLiteral("custom value");
+   return ret;
+}
+
+void HistoryStoreTest::init()
+{
+   QVERIFY(m_Dir.isValid());
+   QFile::remove(path());
+}
+
+///The fields, including the unknown ones, survive a reopen
+void HistoryStoreTest::appendAndRead()
+{
+   {
+      HistoryStore store(path());
+      QVERIFY(store.open());
+      QVERIFY(store.append(call("a", 100)));
+      QVERIFY(store.append(call("b", 200)));
+   }
+
+   HistoryStore store(path());
+   QVERIFY(store.open());
+
+   const QVector<HistoryStore::Entry> entries = store.entries();
+   QCOMPARE(entries.size(), 2);
+   QCOMPARE(entries[0].historyId, QStringLiteral("a"));
+   QCOMPARE(entries[1].historyId, QStringLiteral("b"));
+   QCOMPARE(static_cast<qint64>(entries[1].startTimeStamp), qint64(200));
+
+   HistoryMap hc;
+   QVERIFY(store.read(entries[1].offset, hc));
+   QCOMPARE(hc, call("b", 200));
+}
+
+///Saving a call again replaces it
+void HistoryStoreTest::supersede()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+   QVERIFY(store.append(call("a", 100, "first" )));
+   QVERIFY(store.append(call("a", 100, "second")));
+
+   QCOMPARE(store.entries().size(), 1);
+
+   QVERIFY(store.open());
+
+   const QVector<HistoryStore::Entry> entries = store.entries();
+   QCOMPARE(entries.size(), 1);
+
+   HistoryMap hc;
+   QVERIFY(store.read(entries[0].offset, hc));
+   QCOMPARE(hc[Call::HistoryMapFields::DISPLAY_NAME], QStringLiteral("second"));
+}
+
+void HistoryStoreTest::tombstone()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+   QVERIFY(store.append(call("a", 100)));
+   QVERIFY(store.append(call("b", 200)));
+
+   const qint64 size = QFileInfo(path()).size();
+
+   QVERIFY(store.remove("a"));
+   QCOMPARE(store.entries().size(), 1);
+
+   // A tombstone is appended, nothing is rewritten
+   QVERIFY(QFileInfo(path()).size() > size);
+
+   QVERIFY(store.open());
+   QCOMPARE(store.entries().size(), 1);
+   QCOMPARE(store.entries()[0].historyId, QStringLiteral("b"));
+}
+
+///Nothing is written for a call which isn't there
+void HistoryStoreTest::removeUnknown()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+   QVERIFY(store.append(call("a", 100)));
+
+   const qint64 size = QFileInfo(path()).size();
+
+   QVERIFY(!store.remove("b"));
+   QVERIFY(!store.remove(QString()));
+   QVERIFY(store.remove("a"));
+   QVERIFY(!store.remove("a"));
+
+   QVERIFY(QFileInfo(path()).size() > size);
+   QCOMPARE(store.entries().size(), 0);
+}
+
+///A record cut by a crash is dropped, the log stays usable
+void HistoryStoreTest::truncatedRecord()
+{
+   {
+      HistoryStore store(path());
+      QVERIFY(store.open());
+      QVERIFY(store.append(call("a", 100)));
+      QVERIFY(store.append(call("b", 200)));
+   }
+
+   const qint64 size = QFileInfo(path()).size();
+   QVERIFY(QFile::resize(path(), size - 3));
+
+   HistoryStore store(path());
+   QVERIFY(store.open());
+
+   QCOMPARE(store.entries().size(), 1);
+   QCOMPARE(store.entries()[0].historyId, QStringLiteral("a"));
+
+   // The partial record was cut, the next one is appended after "a"
+   QVERIFY(QFileInfo(path()).size() < size - 3);
+   QVERIFY(store.append(call("c", 300)));
+
+   QVERIFY(store.open());
+   QCOMPARE(store.entries().size(), 2);
+   QCOMPARE(store.entries()[1].historyId, QStringLiteral("c"));
+}
+
+void HistoryStoreTest::damagedChecksum()
+{
+   {
+      HistoryStore store(path());
+      QVERIFY(store.open());
+      QVERIFY(store.append(call("a", 100)));
+      QVERIFY(store.append(call("b", 200)));
+   }
+
+   // Flip a byte in the payload of the last record
+   QFile f(path());
+   QVERIFY(f.open(QIODevice::ReadWrite));
+   QVERIFY(f.seek(f.size() - 10));
+   char c;
+   QVERIFY(f.getChar(&c));
+   QVERIFY(f.seek(f.size() - 10));
+   QVERIFY(f.putChar(c ^ 0x5A));
+   f.close();
+
+   HistoryStore store(path());
+   QVERIFY(store.open());
+   QCOMPARE(store.entries().size(), 1);
+   QCOMPARE(store.entries()[0].historyId, QStringLiteral("a"));
+}
+
+///Only the live calls are kept and their offsets are updated
+void HistoryStoreTest::compact()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+
+   for (int i = 0; i < 10; i++)
+      QVERIFY(store.append(call(QString::number(i), i)));
+
+   for (int i = 0; i < 10; i += 2)
+      QVERIFY(store.remove(QString::number(i)));
+
+   QVERIFY(store.append(call("1", 1, "renamed")));
+
+   const qint64 size = QFileInfo(path()).size();
+
+   QVERIFY(store.compact());
+   QVERIFY(QFileInfo(path()).size() < size);
+
+   const auto check = [&store]() {
+      const QVector<HistoryStore::Entry> entries = store.entries();
+      QCOMPARE(entries.size(), 5);
+
+      for (const HistoryStore::Entry& e : entries) {
+         HistoryMap hc;
+         QVERIFY(store.read(e.offset, hc));
+         QCOMPARE(hc[Call::HistoryMapFields::CALLID], e.historyId);
+         QVERIFY(e.historyId.toInt() % 2);
+
+         if (e.historyId == QLatin1String("1"))
+            QCOMPARE(hc[Call::HistoryMapFields::DISPLAY_NAME], QStringLiteral("renamed"));
+      }
+   };
+
+   check();
+
+   // The store can still be written to and the result reopened
+   QVERIFY(store.append(call("20", 20)));
+   QVERIFY(store.remove("20"));
+   QVERIFY(store.open());
+   check();
+}
+
+///Superseded records are eventually compacted without an explicit call
+void HistoryStoreTest::automaticCompaction()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+
+   QVERIFY(store.append(call("a", 100)));
+   const qint64 size = QFileInfo(path()).size();
+
+   for (int i = 0; i < 1000; i++)
+      QVERIFY(store.append(call("a", 100, QString::number(i))));
+
+   QCOMPARE(store.entries().size(), 1);
+
+   // Without compaction, this would be about 1000 times the size
+   QVERIFY(QFileInfo(path()).size() < size * 300);
+
+   HistoryMap hc;
+   QVERIFY(store.read(store.entries()[0].offset, hc));
+   QCOMPARE(hc[Call::HistoryMapFields::DISPLAY_NAME], QStringLiteral("999"));
+}
+
+///The old calls are removed from the log, including the ones without an id
+void HistoryStoreTest::expire()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+
+   QVERIFY(store.append(call("old"  , 100)));
+   QVERIFY(store.append(call(""     , 150)));
+   QVERIFY(store.append(call("limit", 200)));
+   QVERIFY(store.append(call("new"  , 300)));
+   QVERIFY(store.append(call(""     , 400)));
+
+   QCOMPARE(store.expire(200), 3);
+   QCOMPARE(store.expire(200), 0);
+
+   const auto check = [&store]() {
+      const QVector<HistoryStore::Entry> entries = store.entries();
+      QCOMPARE(entries.size(), 2);
+      QCOMPARE(entries[0].historyId, QStringLiteral("new"));
+      QCOMPARE(static_cast<qint64>(entries[1].startTimeStamp), qint64(400));
+   };
+
+   check();
+
+   QVERIFY(store.open());
+   check();
+
+   QVERIFY(store.compact());
+   check();
+
+   QVERIFY(store.open());
+   check();
+}
+
+///The ids stay valid when the offsets are moved by a compaction
+void HistoryStoreTest::readByIdAfterCompaction()
+{
+   HistoryStore store(path());
+   QVERIFY(store.open());
+
+   for (int i = 0; i < 10; i++)
+      QVERIFY(store.append(call(QString::number(i), i)));
+
+   const qint64 offset = store.entries().last().offset;
+
+   for (int i = 0; i < 9; i++)
+      QVERIFY(store.remove(QString::number(i)));
+
+   QVERIFY(store.compact());
+   QVERIFY(store.entries().last().offset != offset);
+
+   HistoryMap hc;
+   QVERIFY(store.read(QStringLiteral("9"), hc));
+   QCOMPARE(hc, call("9", 9));
+
+   QVERIFY(!store.read(QStringLiteral("0"), hc));
+   QVERIFY(!store.read(QString()          , hc));
+}
+
+QTEST_GUILESS_MAIN(HistoryStoreTest)
+
+#include "historystoretest.moc"
@@ -0,0 +1,260 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//Qt
+#include <QtTest/QtTest>
+
+//Ring
+#include "private/orderstatistictree.h"
+
+//libSTDC++
+#include <algorithm>
+
+typedef OrderStatisticTree<int, int> Tree;
+
+/**
+ * Compare the tree with a sorted vector of (key, value) pairs. The values
+ * are unique and identify the elements.
+ */
+class OrderStatisticTreeTest : public QObject
+{
+   Q_OBJECT
+
+private:
+   typedef QVector<QPair<int,int>> Reference;
+
+   quint32 m_Seed {1};
+
+   int random(int max);
+   static void insert(Reference& ref, int key, int value);
+   static void check(const Tree& tree, const Reference& ref, const QHash<int, Tree::Node*>& nodes);
+
+private Q_SLOTS:
+   void init();
+
+   void empty();
+   void insertOrder();
+   void equivalentKeys();
+   void removeRandom();
+   void lowerBound();
+   void moveDestination();
+};
+
+///Deterministic, so a failure can be reproduced
+int OrderStatisticTreeTest::random(int max)
+{
+   m_Seed = m_Seed * 1103515245u + 12345u;
+   return static_cast<int>((m_Seed >> 8) % static_cast<quint32>(max));
+}
+
+///Insert after the equivalent keys, like the tree
+void OrderStatisticTreeTest::insert(Reference& ref, int key, int value)
+{
+   const auto pos = std::upper_bound(ref.begin(), ref.end(), key,
+      [](int k, const QPair<int,int>& e) { return k < e.first; });
+
+   ref.insert(pos, qMakePair(key, value));
+}
+
+void OrderStatisticTreeTest::check(const Tree& tree, const Reference& ref, const QHash<int, Tree::Node*>& nodes)
+{
+   QCOMPARE(tree.size(), ref.size());
+   QCOMPARE(tree.isEmpty(), ref.isEmpty());
+
+   QVector<int> values;
+   for (const auto& e : ref)
+      values << e.second;
+
+   QCOMPARE(tree.values(), values);
+
+   for (int i = 0; i < ref.size(); i++) {
+      const Tree::Node* n = tree.at(i);
+      QVERIFY(n);
+      QCOMPARE(n->key  (), ref[i].first );
+      QCOMPARE(n->value(), ref[i].second);
+      QCOMPARE(tree.rank(nodes[ref[i].second]), i);
+   }
+
+   QVERIFY(!tree.at(ref.size()));
+}
+
+void OrderStatisticTreeTest::init()
+{
+   m_Seed = 1;
+}
+
+void OrderStatisticTreeTest::empty()
+{
+   Tree tree;
+   QVERIFY(tree.isEmpty());
+   QCOMPARE(tree.size(), 0);
+   QCOMPARE(tree.lowerBound(42), 0);
+   QVERIFY(!tree.at(0));
+   QVERIFY(tree.values().isEmpty());
+
+   tree.remove(tree.insert(1, 1));
+   QVERIFY(tree.isEmpty());
+}
+
+void OrderStatisticTreeTest::insertOrder()
+{
+   Tree tree;
+   Reference ref;
+   QHash<int, Tree::Node*> nodes;
+
+   for (int i = 0; i < 500; i++) {
+      const int key = random(1000);
+      nodes[i] = tree.insert(key, i);
+      insert(ref, key, i);
+   }
+
+   check(tree, ref, nodes);
+
+   // Already sorted input is the worst case for an unbalanced tree
+   Tree sorted;
+   Reference sortedRef;
+   QHash<int, Tree::Node*> sortedNodes;
+
+   for (int i = 0; i < 500; i++) {
+      sortedNodes[i] = sorted.insert(i, i);
+      insert(sortedRef, i, i);
+   }
+
+   check(sorted, sortedRef, sortedNodes);
+}
+
+///Equivalent keys keep their insertion order
+void OrderStatisticTreeTest::equivalentKeys()
+{
+   Tree tree;
+   QHash<int, Tree::Node*> nodes;
+
+   for (int i = 0; i < 20; i++)
+      nodes[i] = tree.insert(i % 2, i);
+
+   for (int i = 0; i < 20; i++)
+      QCOMPARE(tree.rank(nodes[i]), (i % 2) * 10 + i / 2);
+}
+
+void OrderStatisticTreeTest::removeRandom()
+{
+   Tree tree;
+   Reference ref;
+   QHash<int, Tree::Node*> nodes;
+
+   for (int i = 0; i < 300; i++) {
+      const int key = random(50);
+      nodes[i] = tree.insert(key, i);
+      insert(ref, key, i);
+   }
+
+   int next = 300;
+
+   while (!ref.isEmpty()) {
+      const int pos   = random(ref.size());
+      const int value = ref[pos].second;
+
+      tree.remove(nodes.take(value));
+      ref.remove(pos);
+
+      // Interleave some insertions
+      if (!random(3)) {
+         const int key = random(50);
+         nodes[next] = tree.insert(key, next);
+         insert(ref, key, next);
+         next++;
+      }
+
+      if (!random(10)) {
+         check(tree, ref, nodes);
+
+         if (QTest::currentTestFailed())
+            return;
+      }
+   }
+
+   QVERIFY(tree.isEmpty());
+}
+
+void OrderStatisticTreeTest::lowerBound()
+{
+   Tree tree;
+
+   for (int i = 0; i < 10; i++) {
+      tree.insert(i * 10, i);
+      tree.insert(i * 10, i + 10);
+   }
+
+   QCOMPARE(tree.lowerBound(-1 ), 0 );
+   QCOMPARE(tree.lowerBound(0  ), 0 );
+   QCOMPARE(tree.lowerBound(1  ), 2 );
+   QCOMPARE(tree.lowerBound(10 ), 2 );
+   QCOMPARE(tree.lowerBound(55 ), 12);
+   QCOMPARE(tree.lowerBound(90 ), 18);
+   QCOMPARE(tree.lowerBound(100), 20);
+}
+
+/**
+ * Replay what RecentModel does when the key of a row changes and check the
+ * destination it gives to beginMoveRows() leads to the order of the tree.
+ *
+ * Like RecentKey, the keys are made unique with a sequence number.
+ */
+void OrderStatisticTreeTest::moveDestination()
+{
+   Tree tree;
+   Reference ref;
+   QHash<int, Tree::Node*> nodes;
+   int sequence = 0;
+
+   for (int i = 0; i < 50; i++) {
+      const int key = random(100) * 10000 + ++sequence;
+      nodes[i] = tree.insert(key, i);
+      insert(ref, key, i);
+   }
+
+   for (int i = 0; i < 500; i++) {
+      const int value = random(50);
+      const int key   = random(100) * 10000 + ++sequence;
+
+      const int oldPos = tree.rank(nodes[value]);
+      const int lower  = tree.lowerBound(key);
+      const int newPos = oldPos < lower ? lower - 1 : lower;
+
+      tree.remove(nodes[value]);
+      nodes[value] = tree.insert(key, value);
+
+      QCOMPARE(tree.rank(nodes[value]), newPos);
+
+      // Apply the move the way the views do, the destination is a row
+      // number from before the move
+      const int destination = newPos > oldPos ? newPos + 1 : newPos;
+
+      QPair<int,int> moved = ref.takeAt(oldPos);
+      moved.first = key;
+      ref.insert(destination > oldPos ? destination - 1 : destination, moved);
+
+      check(tree, ref, nodes);
+
+      if (QTest::currentTestFailed())
+         return;
+   }
+}
+
+QTEST_APPLESS_MAIN(OrderStatisticTreeTest)
+
+#include "orderstatistictreetest.moc"
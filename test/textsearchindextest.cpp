@@ -0,0 +1,277 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//Qt
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+//Ring
+#include "private/textsearchindex.h"
+
+//libSTDC++
+#include <memory>
+
+class TextSearchIndexTest : public QObject
+{
+   Q_OBJECT
+
+private:
+   std::unique_ptr<QTemporaryDir> m_pDir;
+
+   QString file(const QString& name) const;
+
+   ///Open the index stored in the test directory, without indexing the conversations
+   std::unique_ptr<TextSearchIndex> index() const;
+
+   static bool isWriting(TextSearchIndex& index);
+   static int  compactionRecords();
+
+private Q_SLOTS:
+   void init();
+   void cleanup();
+
+   void tokenize();
+   void prefix();
+   void intersection();
+   void recentFirst();
+   void duplicate();
+   void logReplay();
+   void truncatedLog();
+   void compaction();
+   void clear();
+};
+
+QString TextSearchIndexTest::file(const QString& name) const
+{
+   return m_pDir->filePath(name);
+}
+
+std::unique_ptr<TextSearchIndex> TextSearchIndexTest::index() const
+{
+   std::unique_ptr<TextSearchIndex> ret(new TextSearchIndex());
+
+   QMutexLocker lk(&ret->m_Mutex);
+   ret->m_Dir = m_pDir->path();
+   ret->open();
+
+   return ret;
+}
+
+bool TextSearchIndexTest::isWriting(TextSearchIndex& index)
+{
+   QMutexLocker lk(&index.m_Mutex);
+   return index.m_IsWriting;
+}
+
+int TextSearchIndexTest::compactionRecords()
+{
+   return TextSearchIndex::COMPACTION_RECORDS;
+}
+
+void TextSearchIndexTest::init()
+{
+   m_pDir.reset(new QTemporaryDir());
+   QVERIFY(m_pDir->isValid());
+}
+
+void TextSearchIndexTest::cleanup()
+{
+   m_pDir.reset();
+}
+
+///Lower case, at least two chars and each word only once
+void TextSearchIndexTest::tokenize()
+{
+   QCOMPARE(
+      TextSearchIndex::tokenize(QStringLiteral("Hello, hello WORLD! a b2 ok?")),
+      QStringList({"hello", "world", "b2", "ok"})
+   );
+
+   QVERIFY(TextSearchIndex::tokenize(QStringLiteral("a . ! ?")).isEmpty());
+}
+
+///Every query word is matched as a prefix
+void TextSearchIndexTest::prefix()
+{
+   auto idx = index();
+   idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("hello world"));
+   idx->addMessage("aaaa", 0, 1, 200, QStringLiteral("help me"    ));
+   idx->addMessage("bbbb", 0, 0, 300, QStringLiteral("shell"      ));
+
+   QCOMPARE(idx->search(QStringLiteral("hel"  ), 0).size(), 2);
+   QCOMPARE(idx->search(QStringLiteral("hello"), 0).size(), 1);
+   QCOMPARE(idx->search(QStringLiteral("HELP" ), 0).size(), 1);
+   QCOMPARE(idx->search(QStringLiteral("ell"  ), 0).size(), 0);
+   QCOMPARE(idx->search(QStringLiteral("helpx"), 0).size(), 0);
+   QCOMPARE(idx->search(QStringLiteral("!"    ), 0).size(), 0);
+}
+
+///A hit contains all the query words
+void TextSearchIndexTest::intersection()
+{
+   auto idx = index();
+   idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("hello world"   ));
+   idx->addMessage("aaaa", 0, 1, 200, QStringLiteral("hello there"   ));
+   idx->addMessage("bbbb", 1, 2, 300, QStringLiteral("world is there"));
+
+   QVector<TextSearchIndex::Hit> hits = idx->search(QStringLiteral("wor hel"), 0);
+   QCOMPARE(hits.size(), 1);
+   QCOMPARE(hits[0].sha1   , QByteArray("aaaa"));
+   QCOMPARE(hits[0].message, 0);
+
+   hits = idx->search(QStringLiteral("there world"), 0);
+   QCOMPARE(hits.size(), 1);
+   QCOMPARE(hits[0].sha1   , QByteArray("bbbb"));
+   QCOMPARE(hits[0].group  , 1);
+   QCOMPARE(hits[0].message, 2);
+
+   QCOMPARE(idx->search(QStringLiteral("hello nothing"), 0).size(), 0);
+}
+
+void TextSearchIndexTest::recentFirst()
+{
+   auto idx = index();
+
+   for (int i = 0; i < 10; i++)
+      idx->addMessage("aaaa", 0, i, (i * 7) % 10, QStringLiteral("message"));
+
+   const QVector<TextSearchIndex::Hit> hits = idx->search(QStringLiteral("mess"), 4);
+   QCOMPARE(hits.size(), 4);
+
+   for (int i = 0; i < hits.size(); i++)
+      QCOMPARE(hits[i].timestamp, qint64(9 - i));
+}
+
+///A message is only indexed once
+void TextSearchIndexTest::duplicate()
+{
+   auto idx = index();
+   idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("hello"));
+   idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("hello"));
+
+   QCOMPARE(idx->search(QStringLiteral("hello"), 0).size(), 1);
+
+   // Nor logged twice
+   auto other = index();
+   QCOMPARE(other->search(QStringLiteral("hello"), 0).size(), 1);
+   QCOMPARE(other->m_LogRecords, 1);
+}
+
+///The messages added since the last snapshot are read back from the log
+void TextSearchIndexTest::logReplay()
+{
+   {
+      auto idx = index();
+      idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("hello world"));
+      idx->addMessage("bbbb", 3, 4, 200, QStringLiteral("hello there"));
+   }
+
+   QVERIFY(QFile::exists(file("search.log")));
+   QVERIFY(!QFile::exists(file("search.index")));
+
+   auto idx = index();
+   const QVector<TextSearchIndex::Hit> hits = idx->search(QStringLiteral("hello"), 0);
+
+   QCOMPARE(hits.size(), 2);
+   QCOMPARE(hits[0].sha1     , QByteArray("bbbb"));
+   QCOMPARE(hits[0].group    , 3);
+   QCOMPARE(hits[0].message  , 4);
+   QCOMPARE(hits[0].timestamp, qint64(200));
+   QCOMPARE(hits[1].sha1     , QByteArray("aaaa"));
+}
+
+///A record cut by a crash is dropped and the log stays usable
+void TextSearchIndexTest::truncatedLog()
+{
+   {
+      auto idx = index();
+      idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("first"));
+      idx->addMessage("aaaa", 0, 1, 200, QStringLiteral("second"));
+   }
+
+   const qint64 size = QFileInfo(file("search.log")).size();
+   QVERIFY(QFile::resize(file("search.log"), size - 3));
+
+   {
+      auto idx = index();
+      QCOMPARE(idx->search(QStringLiteral("first" ), 0).size(), 1);
+      QCOMPARE(idx->search(QStringLiteral("second"), 0).size(), 0);
+
+      QVERIFY(QFileInfo(file("search.log")).size() < size - 3);
+
+      idx->addMessage("aaaa", 0, 2, 300, QStringLiteral("third"));
+   }
+
+   // Garbage after the last record
+   {
+      QFile log(file("search.log"));
+      QVERIFY(log.open(QIODevice::WriteOnly | QIODevice::Append));
+      QVERIFY(log.write("\x07garbage") > 0);
+   }
+
+   auto idx = index();
+   QCOMPARE(idx->search(QStringLiteral("first" ), 0).size(), 1);
+   QCOMPARE(idx->search(QStringLiteral("third" ), 0).size(), 1);
+   QCOMPARE(idx->search(QStringLiteral("second"), 0).size(), 0);
+}
+
+///The log is merged into the snapshot by a worker
+void TextSearchIndexTest::compaction()
+{
+   const int count = compactionRecords() + 10;
+
+   {
+      auto idx = index();
+
+      for (int i = 0; i < count; i++)
+         idx->addMessage("aaaa", 0, i, i, QStringLiteral("common unique%1").arg(i));
+
+      QTRY_VERIFY(!isWriting(*idx));
+
+      QVERIFY(QFile::exists(file("search.index")));
+      QVERIFY(!QFile::exists(file("search.log.old")));
+
+      // Only the messages added after the compaction are still in the log
+      QVERIFY(idx->m_LogRecords < count);
+
+      QCOMPARE(idx->search(QStringLiteral("common"), 0).size(), count);
+   }
+
+   auto idx = index();
+   QCOMPARE(idx->search(QStringLiteral("common"   ), 0).size(), count);
+   QCOMPARE(idx->search(QStringLiteral("unique0"  ), 0).size(), 1);
+   QCOMPARE(idx->search(QStringLiteral("unique%1").arg(count - 1), 0).size(), 1);
+}
+
+void TextSearchIndexTest::clear()
+{
+   auto idx = index();
+   idx->addMessage("aaaa", 0, 0, 100, QStringLiteral("hello"));
+   idx->clear();
+
+   QCOMPARE(idx->search(QStringLiteral("hello"), 0).size(), 0);
+   QVERIFY(!QFile::exists(file("search.log")));
+
+   auto other = index();
+   QCOMPARE(other->search(QStringLiteral("hello"), 0).size(), 0);
+}
+
+QTEST_GUILESS_MAIN(TextSearchIndexTest)
+
+#include "textsearchindextest.moc"
@@ -0,0 +1,135 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//Qt
+#include <QtTest/QtTest>
+
+//Ring
+#include "uri.h"
+
+/**
+ * Measure the construction of URIs and the access to their sections for the
+ * usual shapes: SIP, Ring hashes, chevrons and attributes.
+ */
+class URIBenchmark : public QObject
+{
+   Q_OBJECT
+
+private:
+   static void uris();
+
+private Q_SLOTS:
+   void cleanup();
+
+   void parse_data();
+   void parse();
+   void parseInterned_data();
+   void parseInterned();
+   void sections_data();
+   void sections();
+   void format_data();
+   void format();
+};
+
+void URIBenchmark::uris()
+{
+   QTest::addColumn<QString>("uri");
+
+   QTest::newRow("sip"       ) << QStringLiteral("sip:1234@example.com");
+   QTest::newRow("sip port"  ) << QStringLiteral("sip:1234@192.168.48.213:5060");
+   QTest::newRow("ring"      ) << QStringLiteral("ring:9ff7a0f3e5b4a3cd8f7b1f5e1a2c3d4e5f607182");
+   QTest::newRow("chevrons"  ) << QStringLiteral("  <sip:alice@example.com>  ");
+   QTest::newRow("attributes") << QStringLiteral("<sip:888@192.168.48.213:5060;transport=TLS;tag=b5c73d9ef>");
+   QTest::newRow("number"    ) << QStringLiteral("5145551234");
+}
+
+void URIBenchmark::cleanup()
+{
+   URI::setInterningEnabled(false);
+}
+
+void URIBenchmark::parse_data()
+{
+   uris();
+}
+
+void URIBenchmark::parse()
+{
+   QFETCH(QString, uri);
+
+   QBENCHMARK {
+      const URI u(uri);
+      Q_UNUSED(u)
+   }
+}
+
+void URIBenchmark::parseInterned_data()
+{
+   uris();
+}
+
+///The same string over and over, like PhoneDirectoryModel does
+void URIBenchmark::parseInterned()
+{
+   QFETCH(QString, uri);
+
+   URI::setInterningEnabled(true);
+
+   QBENCHMARK {
+      const URI u(uri);
+      Q_UNUSED(u)
+   }
+}
+
+void URIBenchmark::sections_data()
+{
+   uris();
+}
+
+void URIBenchmark::sections()
+{
+   QFETCH(QString, uri);
+
+   const URI u(uri);
+
+   QBENCHMARK {
+      u.userinfo();
+      u.hostname();
+      u.port();
+      u.protocolHint();
+   }
+}
+
+void URIBenchmark::format_data()
+{
+   uris();
+}
+
+void URIBenchmark::format()
+{
+   QFETCH(QString, uri);
+
+   const URI u(uri);
+
+   QBENCHMARK {
+      u.full();
+   }
+}
+
+QTEST_APPLESS_MAIN(URIBenchmark)
+
+#include "uribenchmark.moc"
@@ -0,0 +1,243 @@
+/****************************************************************************
+ *   Copyright (C) 2017 by Savoir-faire Linux                               *
+ *                                                                          *
+ *   This library is free software; you can redistribute it and/or          *
+ *   modify it under the terms of the GNU Lesser General Public             *
+ *   License as published by the Free Software Foundation; either           *
+ *   version 2.1 of the License, or (at your option) any later version.     *
+ *                                                                          *
+ *   This library is distributed in the hope that it will be useful,        *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      *
+ *   Lesser General Public License for more details.                        *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+//Qt
+#include <QtTest/QtTest>
+
+//Ring
+#include "private/videoconversion.h"
+
+//libSTDC++
+#include <functional>
+#include <vector>
+
+using namespace Video::Conversion;
+
+Q_DECLARE_METATYPE(Video::Conversion::InstructionSet)
+
+/**
+ * Compare the SIMD kernels with the scalar ones.
+ *
+ * Only the instruction sets supported by the CPU are tested. The widths
+ * cover the sizes smaller than a vector, the exact multiples and the tail
+ * pixels handled by the fallbacks at the end of each row.
+ */
+class VideoConversionTest : public QObject
+{
+   Q_OBJECT
+
+private:
+   using Kernel = std::function<void(const uint8_t*, uint8_t*, int, int)>;
+
+   static std::vector<uint8_t> frame(int width, int height);
+   static bool run(InstructionSet set, const Kernel& kernel, int width, int height,
+                   std::size_t outSize, std::vector<uint8_t>& out);
+   static void compare(const Kernel& kernel, std::size_t outSize);
+
+private Q_SLOTS:
+   void init();
+   void cleanup();
+
+   void swapRedBlue_data();
+   void swapRedBlue();
+   void toI420_data();
+   void toI420();
+   void toNV12_data();
+   void toNV12();
+   void halve_data();
+   void halve();
+
+   void yuvSize();
+
+private:
+   void sizes();
+};
+
+///Deterministic noise, the same for every instruction set
+std::vector<uint8_t> VideoConversionTest::frame(int width, int height)
+{
+   std::vector<uint8_t> ret(static_cast<std::size_t>(4*width*height));
+
+   quint32 seed = static_cast<quint32>(width * 7919 + height);
+   for (auto& c : ret) {
+      seed = seed * 1103515245u + 12345u;
+      c    = static_cast<uint8_t>(seed >> 16);
+   }
+
+   return ret;
+}
+
+///Run the kernel, false if it wrote past outSize
+bool VideoConversionTest::run(InstructionSet set, const Kernel& kernel, int width, int height,
+                              std::size_t outSize, std::vector<uint8_t>& out)
+{
+   const std::vector<uint8_t> src = frame(width, height);
+
+   // Canary bytes after the output to catch tail overruns
+   out.assign(outSize + 64, 0xA5);
+
+   setInstructionSet(set);
+   kernel(src.data(), out.data(), width, height);
+
+   for (std::size_t i = outSize; i < out.size(); ++i) {
+      if (out[i] != 0xA5)
+         return false;
+   }
+
+   out.resize(outSize);
+   return true;
+}
+
+void VideoConversionTest::compare(const Kernel& kernel, std::size_t outSize)
+{
+   QFETCH(InstructionSet, set);
+   QFETCH(int, width );
+   QFETCH(int, height);
+
+   std::vector<uint8_t> expected, actual;
+
+   QVERIFY(run(InstructionSet::SCALAR, kernel, width, height, outSize, expected));
+   QVERIFY(run(set                   , kernel, width, height, outSize, actual  ));
+
+   for (std::size_t i = 0; i < outSize; ++i) {
+      if (actual[i] != expected[i])
+         QFAIL(qPrintable(QString("Byte %1 differs: %2 instead of %3")
+            .arg(i).arg(actual[i]).arg(expected[i])));
+   }
+}
+
+///Every instruction set with odd, exact and tail widths
+void VideoConversionTest::sizes()
+{
+   QTest::addColumn<InstructionSet>("set");
+   QTest::addColumn<int>("width" );
+   QTest::addColumn<int>("height");
+
+   static const int widths [] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 641};
+   static const int heights[] = {1, 2, 3, 5, 6};
+
+   // The scalar rows only check for overruns, but keep the table non empty
+   static const struct { InstructionSet set; const char* name; } sets[] = {
+      {InstructionSet::SCALAR, "scalar"},
+      {InstructionSet::SSE2  , "sse2"  },
+      {InstructionSet::AVX2  , "avx2"  },
+   };
+
+   for (const auto& s : sets) {
+      if (s.set > bestInstructionSet())
+         continue;
+
+      for (int w : widths) {
+         for (int h : heights)
+            QTest::newRow(qPrintable(QString("%1 %2x%3").arg(s.name).arg(w).arg(h)))
+               << s.set << w << h;
+      }
+   }
+}
+
+void VideoConversionTest::init()
+{
+   setInstructionSet(bestInstructionSet());
+}
+
+void VideoConversionTest::cleanup()
+{
+   setInstructionSet(bestInstructionSet());
+}
+
+void VideoConversionTest::swapRedBlue_data()
+{
+   sizes();
+}
+
+void VideoConversionTest::swapRedBlue()
+{
+   QFETCH(int, width );
+   QFETCH(int, height);
+
+   compare([](const uint8_t* src, uint8_t* dst, int w, int h) {
+      Video::Conversion::swapRedBlue(src, dst, static_cast<std::size_t>(w*h));
+   }, static_cast<std::size_t>(4*width*height));
+}
+
+void VideoConversionTest::toI420_data()
+{
+   sizes();
+}
+
+void VideoConversionTest::toI420()
+{
+   QFETCH(int, width );
+   QFETCH(int, height);
+
+   for (const bool rgba : {false, true}) {
+      compare([rgba](const uint8_t* src, uint8_t* dst, int w, int h) {
+         Video::Conversion::toI420(src, dst, w, h, rgba);
+      }, yuv420Size(width, height));
+
+      if (QTest::currentTestFailed())
+         return;
+   }
+}
+
+void VideoConversionTest::toNV12_data()
+{
+   sizes();
+}
+
+void VideoConversionTest::toNV12()
+{
+   QFETCH(int, width );
+   QFETCH(int, height);
+
+   for (const bool rgba : {false, true}) {
+      compare([rgba](const uint8_t* src, uint8_t* dst, int w, int h) {
+         Video::Conversion::toNV12(src, dst, w, h, rgba);
+      }, yuv420Size(width, height));
+
+      if (QTest::currentTestFailed())
+         return;
+   }
+}
+
+void VideoConversionTest::halve_data()
+{
+   sizes();
+}
+
+void VideoConversionTest::halve()
+{
+   QFETCH(int, width );
+   QFETCH(int, height);
+
+   compare([](const uint8_t* src, uint8_t* dst, int w, int h) {
+      Video::Conversion::halve(src, dst, w, h);
+   }, static_cast<std::size_t>(4*(width/2)*(height/2)));
+}
+
+///The chroma planes round up for odd sizes
+void VideoConversionTest::yuvSize()
+{
+   QCOMPARE(yuv420Size(1, 1), std::size_t(3 ));
+   QCOMPARE(yuv420Size(2, 2), std::size_t(6 ));
+   QCOMPARE(yuv420Size(3, 3), std::size_t(17));
+   QCOMPARE(yuv420Size(4, 2), std::size_t(12));
+}
+
+QTEST_APPLESS_MAIN(VideoConversionTest)
+
+#include "videoconversiontest.moc"